@@ -8,6 +8,17 @@
    
    Version 1.0 - 29 February 2020
    Version 1.1 - 15 March 2021    - Trackball/Joystick detection more acurate
+   Version 1.2 - 19 October 2026  - Serial commands, immediate key/button events
+                                   - Keypad matrix bitmap report with ghost detection
+                                   - Controller settling time after CAV transitions
+                                   - Trackball velocity profiling
+                                   - Soak test with fault counters logged to EEPROM
+                                   - Stick linearization table uploaded to EEPROM
+                                   - Timed loops generated for the clock (timing.sh), 4MHz and 20MHz builds
+                                   - Phase profiler in the PROFILE build (make profile)
+                                   - Tick scheduler, each task at its own period and phase
+                                   - Keypad settle time sweep and dwell scan
+                                   - Fire button edge capture on every pot line
 
     This program is free software: you can redistribute it and/or modify
     it under the terms of the GNU General Public License as published by
@@ -35,6 +46,8 @@
 #include <stdbool.h>
 #include <stdio.h>
 
+#include "timing.h" // delay sequences for F_OSC, generated by timing.sh (see makefile)
+
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ///                                                                                                         ///
@@ -44,9 +57,7 @@
 
 
 
-//#use delay(clock=8000000)
-//#fuses INTRC_IO, NOPROTECT, NOBROWNOUT, NOWDT, PUT 
-uint16_t __at _CONFIG configWord = _INTRC_OSC_NOCLKOUT & _CPD_OFF &  _CP_OFF & _LVP_OFF & _WDT_OFF & _PWRTE_ON & _MCLRE_OFF; // watchdog off
+uint16_t __at _CONFIG configWord = OSC_CONFIG & _CPD_OFF &  _CP_OFF & _LVP_OFF & _WDT_OFF & _PWRTE_ON & _MCLRE_OFF; // watchdog off
 
 /*
    PIC16F628A
@@ -61,6 +72,11 @@ CAV_CNTRL    RB0 --|6    13|-- RB7 LINE3 PIN8
     TXD   TX/RB2 --|8    11|-- RB5 LINE1 PIN6
 TOP_BTN      RB3 --|9    10|-- RB4 LINE2 PIN5
                    +-------+  
+
+   External clock builds (EXT_CLOCK, F_OSC above 4MHz): the clock comes in on 
+   RA7, so ROW3 (keypad PIN4) moves to RA2. The comparators then use the 
+   internal Vref (CM=010) and RA2 no longer carries VREF. Board mod: cut 
+   RA7 from PIN4, wire PIN4 to RA2 and feed RA7 from a 20MHz oscillator.
 */
 
 
@@ -72,7 +88,10 @@ TOP_BTN      RB3 --|9    10|-- RB4 LINE2 PIN5
 
 
 
-#define delay5us()        do { __asm__("nop\n nop\n nop\n nop\n nop"); } while (0)
+// Cycles taken by a timed block, for the native simulation build (host/sim). Nothing on the PIC.
+#ifndef simCycles
+#define simCycles(n)
+#endif
 
 #define cavOff() do {TRISB0=1; RB0=0;} while (0)  // CAV OFF
 #define cavOn()  do {RB0=1; TRISB0=0;} while (0)  // CAV ON
@@ -80,12 +99,20 @@ TOP_BTN      RB3 --|9    10|-- RB4 LINE2 PIN5
 #define TRISLIN0 TRISA6
 #define TRISLIN1 TRISA4
 #define TRISLIN2 TRISA3
+#ifdef EXT_CLOCK
+#define TRISLIN3 TRISA2
+#else
 #define TRISLIN3 TRISA7
+#endif
 
 #define RLIN0 RA6
 #define RLIN1 RA4
 #define RLIN2 RA3
+#ifdef EXT_CLOCK
+#define RLIN3 RA2
+#else
 #define RLIN3 RA7
+#endif
 
 
 
@@ -99,7 +126,241 @@ TOP_BTN      RB3 --|9    10|-- RB4 LINE2 PIN5
 static uint8_t rows[4];
 static uint8_t hline = 0; // 
 static uint8_t potx=0,poty=0;
+static bool trackball = false;    // result of last CAV off detection
+
+// Per-axis ViH, as VRCON VR levels (Vref = VR/24 * 5V). With different levels 
+// each line of measurePotentimeters() is split in two slots: the reference is 
+// switched to the level of one axis and left to settle before its comparator 
+// is read. Captures ('b', 'w') read both comparators at the x level.
+#define VIH_DEFAULT 11  // 2.29 Volts, as set in main()
+static uint8_t vihLevel[2] = { VIH_DEFAULT, VIH_DEFAULT };  // x (C2OUT), y (C1OUT)
 uint8_t frameCounter; 
+
+// Key and button events
+// Worst case from an edge to the end of its event frame on the wire: the 
+// longest gap between two event checks in the report mode plus the check's 
+// keypad scan, then one report byte already in the transmitter plus the 5 
+// byte event frame. Each further edge found by the same check adds a frame.
+// In the text and matrix reports the keypad task runs on the tick before the
+// pot task, so scans are one 8 tick frame apart and the pot frame in between 
+// ends inside the last tick; reports are queued and sent between tasks 
+// (txPump()), they never hold a scan back, replies to serial commands do. The
+// measurement modes check between the parts of a cycle that keep their own 
+// timing (see eventGapMs[]).
+#define EVENT_FRAME_MS      7  // (1+5) bytes * 1,04ms @ 9600bps
+#define EVENT_EDGE_MS       6  // 5 bytes for each further edge
+
+#define BTN_TOP 0 // bit 0
+#define BTN_BOT 1 // bit 1
+
+static bool eventMode = false;
+static uint16_t lastKeys = 0;     // keypad bitmap at last event check, 1 = pressed
+static uint8_t lastButtons = 0;   // buttons at last event check, 1 = pressed
+static uint8_t buttonState = 0;   // buttons at the last TASK_BUTTONS sample, 1 = pressed
+
+// Report modes
+#define REPORT_TEXT   0  // printResults()
+#define REPORT_MATRIX 1  // printMatrix()
+#define REPORT_LATENCY 2 // measureCavLatency()
+#define REPORT_VELOCITY 3 // measureVelocity()
+#define REPORT_SOAK     4 // soakCycle()
+#define REPORT_BUTTONS  5 // captureButtons()
+#define REPORT_TRACE    6 // captureTrace()
+
+static uint8_t reportMode = REPORT_TEXT;
+
+// Longest gap between two event checks in each report mode, in ms, the scan 
+// included. The measurement modes check between their cycles and between the
+// parts of a cycle that do not need back to back frames:
+//   text, matrix  one frame between keypad tasks, 16,7ms + 0,5ms
+//   latency       the 16 frames after a CAV transition, 16 * 15,6ms
+//   velocity      the burst, 24 frames * 16,6ms
+//   soak          the detection and the first CAV on frame, plus a summary 
+//                 (~92ms) and its EEPROM writes (~4ms each) once per interval
+//   buttons       a frame, its edge search and two Button lines, 
+//                 15,6ms + 1ms + ~1ms + 2 * 51ms
+//   trace         the Trace line and its block, 78 bytes
+static const uint16_t eventGapMs[] = { 18, 18, 252, 402, 205, 121, 83 };
+
+// Keypad matrix statistics, accumulated between reports
+static uint8_t matrixMaxCount = 0;  // most keys down in a single scan
+static bool matrixGhost = false;    // two lines shared two or more pressed columns
+static bool matrixFault = false;    // COL3 on LIN3 closed, there is no key there
+
+// Buffer shared by the measurement modes
+#define SAMPLE_BUF_SIZE 64
+static uint8_t sampleBuf[SAMPLE_BUF_SIZE];
+
+// Report queue, the text and matrix reports are formatted into sampleBuf[] 
+// (free in those modes) and sent by the scheduler a byte at a time, whenever
+// the transmitter is idle. Output that is not queued waits for the queue first.
+static bool txQueued = false;     // _putc() appends to the queue
+static uint8_t txLen, txSent;     // bytes queued and sent
+#define txPump()  do { if ((txSent!=txLen) && TRMT) TXREG = sampleBuf[txSent++]; } while (0)
+#define txFlush() do { while (txSent!=txLen) _txbyte(sampleBuf[txSent++]); } while (0)
+
+// CAV latency, frames are measured back to back after each CAV transition
+#define LAT_FRAMES      16   // frames measured after a transition, x in sampleBuf[0..15], y in [16..31]
+#define LAT_FRAME_LINES 244  // 228 measured lines + ~1ms discharge
+#define LAT_TOLERANCE   2    // lines, readings within this of the last frame are settled
+
+// Trackball velocity, bursts of frames measured at the 5200 frame rate
+#define VEL_FRAMES 24  // frames per burst, x in sampleBuf[0..23], y in [24..47]
+
+static uint16_t velBurst = 0;
+
+// Fire button capture, both buttons sampled on every line of a frame in place
+// of the comparators, packed into sampleBuf[] as the comparator trace: line n 
+// in sampleBuf[n/4], first line of each byte in the top bits, bottom (RA5) 
+// above top (RB3), 1 = released. The edges are found after the frame and timed
+// in lines on a 16 bit clock kept from Timer1. A burst of edges ends after 
+// BTN_QUIET lines without any; the first edge of a burst times the press or 
+// release. Times that would wrap the clock saturate at BTN_TIME_MAX.
+#define BTN_BYTES    57      // 228 lines, 4 per byte
+#define BTN_QUIET    313     // lines, 20ms
+#define BTN_TIME_MAX 0xF000  // lines, 3,9s, printed as 65535
+#define BTN_LINE_T1  (64000/T1_TICK_NS)  // Timer1 ticks per line
+#define BTN_IDLE 0  // released
+#define BTN_DOWN 1  // press burst
+#define BTN_HELD 2
+#define BTN_UP   3  // release burst
+#define BTN_WAIT 4  // held when the capture started, ignored until released
+
+struct buttonPress {
+	uint8_t state;
+	uint8_t bounces[2];   // edges after the first one, press and release bursts
+	uint16_t downLen;     // press burst length, lines
+	uint16_t first[2];    // first edge of the press and release bursts, btnClock
+	uint16_t last;        // last edge
+};
+
+static uint8_t btnLevel;          // pins at the last line, bit 0 top, bit 1 bottom, 1 = released
+static struct buttonPress btn[2];
+static uint16_t btnClock;         // lines since the capture started, wraps every 4,2s
+static uint16_t btnT1;            // Timer1 at btnClock
+static const uint8_t btnSame[4] = { 0x00, 0x55, 0xAA, 0xFF };  // 4 lines at a btnLevel, no edge
+
+// Comparator trace, both comparator outputs of every line of a frame, sent as 
+// a binary block. Line n is in sampleBuf[n/4], first line of each byte in the
+// top bits, C2OUT (x) above C1OUT (y): 7:x0 6:y0 5:x1 4:y1 3:x2 2:y2 1:x3 0:y3
+#define TRACE_BYTES 57   // 228 lines, 4 per byte
+
+// Soak test, counters saturate at 65535 and are saved to EEPROM at every summary
+#define SOAK_TICKS_PER_MIN T1_OVERFLOWS_PER_MIN  // 114 at 4MHz (524ms each), 0,4% short
+#define SOAK_RANGE_MIN      10  // expected range for a controller
+#define SOAK_RANGE_MAX     190
+#define SOAK_SATURATED     227  // never crossed ViH
+#define SOAK_EE_MAGIC     0x5A  // first EEPROM byte when a log is stored
+#define SOAK_EE_ADDR         1  // log follows the magic byte, then a check byte
+#define SOAK_EE_CHECK (SOAK_EE_ADDR+sizeof(struct soakLog))
+
+struct soakLog {
+	uint16_t minutes;
+	uint16_t frames;   // CAV on frames checked
+	uint16_t range;    // readings outside SOAK_RANGE_MIN..SOAK_RANGE_MAX
+	uint16_t sat;      // readings at SOAK_SATURATED
+	uint16_t flips;    // joystick/trackball detection changes
+	uint16_t glitches; // keys seen down on a single scan
+	uint8_t driftX;    // largest distance from the baseline reading
+	uint8_t driftY;
+};
+
+static struct soakLog soak;
+static uint8_t soakInterval = 1;  // minutes between summaries
+static uint8_t soakMinutes;       // minutes since last summary
+static uint16_t soakTicks;        // Timer1 overflows in this minute
+static bool soakBaseline;         // baseline taken
+static uint8_t soakBaseX, soakBaseY;
+static uint16_t soakKeys[2];      // keypad bitmaps of the last two scans
+
+// Stick linearization, CAL_POINTS readings per axis at positions 0, 32, 64 .. 256, strictly increasing
+#define CAL_EE_MAGIC   0xCA  // at CAL_EE_ADDR when a table is stored
+#define CAL_EE_ADDR    0x20  // magic, x breakpoints, y breakpoints
+#define CAL_POINTS        9
+#define CAL_SIZE       (2*CAL_POINTS)
+#define CAL_RX_WAIT    (5000*CYCLES_PER_US)  // ~50ms for each uploaded byte, after its ack
+
+static bool calMode = false;      // joystick reports positions, PosX/PosY
+
+// Scheduler for the text and matrix reports. Time is counted in ticks of 1/8 
+// console frame (2,09ms) on Timer1; each task runs on the ticks of its period 
+// that match its phase. Tasks are cooperative: one that is due while another 
+// runs starts late, once, and is then back on its own ticks. The pot task 
+// takes 7 of its 8 ticks, so faster keypad or button rates only add samples 
+// in the tick left over and while reports are sent. Pot frames are skipped 
+// while a report is queued: the transmitter would stall during the frame and 
+// a report would take longer than its period. A text report (~50 bytes, 52ms)
+// skips the 3 pot ticks after it, leaving 3 CAV on frames and the 2 detection 
+// frames in each 64 tick cycle. That is enough, reports only carry the last 
+// reading, taken 6 ticks before the report; readings are not used otherwise.
+// With reports on demand ('g') the pots are measured on every pot tick while
+// nothing is being sent, 6 CAV on frames a cycle.
+#define SCHED_TICK_T1  ((uint16_t)((2085400UL + T1_TICK_NS/2)/T1_TICK_NS))  // Timer1 counts per tick
+// Tasks due on the same pass run in this order
+#define TASK_COMMANDS 0  // checkCommands()
+#define TASK_KEYPAD   1  // scanKeyboard(), key events and matrix check
+#define TASK_BUTTONS  2  // fire buttons, button events
+#define TASK_REPORT   3  // printResults() or printMatrix() into the report queue
+#define TASK_DETECT   4  // CAV off, the next DETECT_FRAMES pot measurements detect the controller
+#define TASK_POTS     5  // measurePotentimeters()
+#define TASKS         6
+#define DETECT_FRAMES 2  // the first one lets the controller settle with CAV off
+
+static const uint8_t taskPeriod[TASKS] = { 1, 8, 2, 64, 64, 8 };  // ticks, 8 ticks = 1 frame
+static const uint8_t taskPhase[TASKS]  = { 0, 7, 1, 62, 32, 0 };  // report alone on its tick, detect after it is sent
+static uint16_t taskNext[TASKS];  // tick each task is due next
+static uint16_t schedNow;         // current tick
+static uint16_t schedT1;          // Timer1 at the start of the current tick
+static uint8_t detectFrames;      // CAV off measurements left
+static bool reportOnDemand = false;  // TASK_REPORT only runs when reportWanted
+static bool reportWanted = false;    // 'g' received, report on the next pass
+
+// Keypad settle sweep: each line is sampled KS_FIXED+2+8*n cycles after it is 
+// driven, n = 0..KS_STEPS-1, right after the previous line was selected as in a
+// scan. The settle time of a line is the shortest delay from which every sample
+// matched the reference (the longest delay). Hold a key on each line for a 
+// meaningful result.
+#define KS_STEPS   32   // delays swept, up to 254 cycles
+#define KS_FIXED    4   // break and return out of selectLine(), column read (~2 less on LIN3)
+#define KS_TRIALS  16   // samples at each delay
+#define KS_MARGIN   1   // steps added to the slowest line for the dwell scan
+
+static uint8_t keyDwell;          // loops of the dwell scan, from the last sweep
+static bool dwellScan = false;    // scanKeyboard() waits keyDwell instead of two lines
+static bool dwellValid = false;   // a sweep found keys
+
+// Phase profiler, PROFILE builds only. Phase boundaries are timestamped with 
+// Timer1 outside the timed loops, so the loops keep their cycle counts.
+#ifdef PROFILE
+#define PROF_MEASURE 0  // measurePotentimeters()
+#define PROF_SCAN    1  // scanKeyboard()
+#define PROF_DELAY   2  // _delayms() and the scheduler waiting for the next tick
+#define PROF_TX      3  // _txbyte() waiting for the UART
+#define PROF_OTHER   4  // everything else
+#define PROF_PHASES  5
+#define PROF_SHIFT   3  // profTicks[] count units of 8 Timer1 ticks, 64us @ 4MHz
+#define PROF_FOLD    0x1000  // units counted before they are halved and doubled in length
+#define PROF_FRAME_TICKS   ((uint16_t)(16683UL*1000/T1_TICK_NS))  // one console frame, 262 lines
+
+static uint16_t profTicks[PROF_PHASES];  // units spent in each phase, sum in profTotal
+static uint16_t profTotal;               // under PROF_FOLD, so printProfile() works in 16 bits
+static uint16_t profRest;                // ticks short of a unit, carried to the next phase
+static uint8_t profScale;                // folds, a unit is 1<<(PROF_SHIFT+profScale) ticks
+static uint8_t profCurrent = PROF_OTHER;
+static uint16_t profLast;                // Timer1 at the last phase boundary
+static bool profFrameValid;              // profFrameStart taken
+static uint16_t profFrameStart;          // Timer1 at the last measurePotentimeters()
+static uint16_t profFrames, profOverruns, profMaxFrame;
+
+#define profPhase(p) profSwitch(p)
+#define profFrame()  profFrameMark()
+#else
+#define profPhase(p)
+#define profFrame()
+#endif
+
+// Key names by bitmap position (line * 4 + rows[] bit), '?' is COL3 on LIN3 (no key)
+static const char keyNames[16] = { '7','4','1','*', '8','5','2','0', '9','6','3','#', 'R','P','S','?' };
  
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
 ///                                                                                                         ///
@@ -108,6 +369,7 @@ uint8_t frameCounter;
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 
+void _txbyte (uint8_t c);
 void _putc (uint8_t c);
 void _puts (char *ptr);
 
@@ -117,6 +379,79 @@ void printResults(void);
 void _puts (char *ptr);
 void printNumber( uint8_t n);
 void _delayms(uint8_t n);
+uint16_t readKeys(void);
+uint8_t readButtons(void);
+void sendEvent(char name, bool pressed);
+void pollEvents(void);
+void checkCommands(void);
+void printHex(uint8_t n);
+uint8_t countKeys(uint16_t keys);
+bool ghostKeys(uint16_t keys);
+void checkMatrix(void);
+void printMatrix(void);
+void printNumber16(uint16_t n);
+uint16_t settleLines(uint8_t *v);
+void measureCavTransition(void);
+void measureCavLatency(void);
+void printSigned(int8_t n);
+int8_t velocity(uint8_t pot, uint8_t ref);
+void printVelocityStats(uint8_t axis);
+void measureVelocity(void);
+uint8_t eepromRead(uint8_t addr);
+void eepromWrite(uint8_t addr, uint8_t data);
+void soakCount(uint16_t *counter);
+void soakAxis(uint8_t pot, uint8_t base, uint8_t *drift);
+void soakCheck(void);
+void soakTimer(void);
+void soakStart(void);
+void printSoak(struct soakLog *log);
+void saveSoak(void);
+void printSavedSoak(void);
+void soakCycle(void);
+bool calStored(void);
+uint8_t linearize(uint8_t pot, uint8_t table);
+bool receiveByte(uint8_t *c);
+void uploadCalibration(void);
+void toggleCalibration(void);
+uint16_t timer1Read(void);
+void schedStart(void);
+void schedTick(void);
+void periodicReports(void);
+void potTask(void);
+void keyEvents(void);
+void buttonEvents(uint8_t buttons);
+void selectLine(uint8_t line);
+uint8_t sampleLine(uint8_t line, uint8_t loops);
+void settleSweep(void);
+void toggleDwellScan(void);
+void buttonsStart(void);
+void captureButtons(void);
+void buttonLines(uint16_t start);
+void buttonFrame(uint8_t b, uint16_t end);
+void buttonEdge(struct buttonPress *p, uint8_t level, uint16_t t);
+void printButtonTime(uint16_t lines);
+void printButtonPress(uint8_t b);
+void captureTrace(void);
+void setVih(uint8_t axis);
+#ifdef PROFILE
+void profSwitch(uint8_t phase);
+void profFrameMark(void);
+void printTenths(uint16_t n);
+void printProfile(void);
+#endif
+
+/*
+   Call depth: the PIC16F628A return stack has 8 levels and SDCC pic14 keeps
+   no software stack, a 9th call silently overwrites the oldest return 
+   address. Printing is the deepest, so _putc() and _txbyte() call nothing 
+   but the profiler, and event frames are only sent from the scheduler tasks
+   and the measurement loops. Deepest paths, 6 levels (7 with PROFILE, 
+   profSwitch() under _putc()):
+     captureButtons > buttonFrame > printButtonPress > printButtonTime > printNumber16 > _putc
+     schedTick > checkCommands > printSavedSoak > printSoak > printNumber16 > _putc
+   The SDCC helpers for 16 bit multiply and divide and pointer reads are 
+   leaves, called from at most 5 levels down.
+*/
 
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -133,7 +468,11 @@ void main (void)
 //
 
 // Setup comparators
+#ifdef EXT_CLOCK
+CMCON = _CM1;          // CM<2:0> = 010, CIS=0  RA0 and RA1 against the internal Vref, RA2 free for ROW3
+#else
 CMCON = (_CM1 | _CM0); // CM<2:0> = 011  Two Common Reference Comparators
+#endif
 
 /* Voltage reference, ViH min = 1.9V, ViH max = 2.6V, average ViH = 2.25V
 
@@ -155,7 +494,11 @@ VR3  VR2  VR1  VR0  VR[3..0] VRR=1    VRR=0
  1    1    0    1       13    3,28     2,71
  1    1    1    0       14    3,44     2,92
  1    1    1    1       15    3,59     3,13  */
+#ifdef EXT_CLOCK
+VRCON = _VREN | _VRR | _VR3 | _VR1 | _VR0;         // Vref = (11/24) * 5 = 2.29 Volts, internal only
+#else
 VRCON = _VREN | _VROE | _VRR | _VR3 | _VR1 | _VR0; // Vref = (11/24) * 5 = 2.29 Volts 
+#endif
 
 
 // Setup I/O pins
@@ -171,40 +514,42 @@ BRGH=1;
 TXEN=1;
 SYNC=0;
 SPEN=1;
-SPBRG = 25; // 9600 bps @ 4MHz
+SPBRG = SPBRG_9600; // 9600 bps, 25 @ 4MHz
+CREN=1;     // receive commands
 
 
 // Setup Timer0 
 // reload time 192 for 15,75KHz
 __asm__("clrwdt");
-T0CS=0;   // Timer 0 clocked by internal CPU clock (4MHz)
+T0CS=0;   // Timer 0 clocked by the instruction cycle (F_OSC/4)
 PSA=1;    // prescaler assigned to WDT (timer0 clocked at 1:1)
 TMR0 = 0; // Clear Timer 0
 
+// Setup Timer1, free running time base 
+T1CON = _T1CKPS1 | _T1CKPS0 | _TMR1ON; // 1:8 prescaler, T1_TICK_NS ticks (8us @ 4MHz, overflow every 524ms)
+
 
 //
 // Main loop
 //
 
-  for (;;) {  // TODO check RXbuffer for new commands
-    cavOff(); // TRISB0=1; RB0=0; // CAV OFF
-	measurePotentimeters(); _delayms(2); // complete roughly 1 frame 
-	measurePotentimeters(); _delayms(2); // do it again
-    
-	if ( (potx>220) && (poty>220) ) { // Normal joystick
-       _puts("[Joystick]");	   	
-	} else { // trackball connected
-       _puts("[TrackBall]");	   
-	}
-	
-    cavOn(); //RB0=1; TRISB0=0; // CAV ON
-    
-    for (frameCounter = 4 ; frameCounter > 0 ; frameCounter--) {
-        measurePotentimeters(); 
-        _delayms(1); 
-        scanKeyboard(); // complete roughly 1 frame 
+ schedStart();
+  for (;;) {
+    // text and matrix reports run from the scheduler
+    if (reportMode<=REPORT_MATRIX) {
+        schedTick();
+        continue;
     }
-	printResults(); // roughtly 10 times per second
+    
+    // the measurement modes keep their own timing, events between their cycles (see eventGapMs[])
+    checkCommands();
+    pollEvents();
+    if (reportMode==REPORT_LATENCY) measureCavLatency();
+    else if (reportMode==REPORT_VELOCITY) measureVelocity();
+    else if (reportMode==REPORT_SOAK) soakCycle();
+    else if (reportMode==REPORT_BUTTONS) captureButtons();
+    else if (reportMode==REPORT_TRACE) captureTrace();
+    schedStart(); // fresh schedule when going back to reports
 	
   } // for  
 } // main loop
@@ -217,30 +562,91 @@ TMR0 = 0; // Clear Timer 0
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void measurePotentimeters(void) {
-	uint8_t j;
+	uint8_t j, bits, vrx, vry;
+	profFrame();
+	profPhase(PROF_MEASURE);
 	// Release capacitors to charge
 	TRISA0 = 1;
 	TRISA1 = 1;
 	
 
-	// timed loop, trimmed to 64us  
-	for (hline=0;hline<228;hline++) {  // 7 cycles
-	  if (C1OUT) poty=hline; else __asm__("nop\n nop\n nop\n nop\n nop"); // 9 cycles
-	  if (C2OUT) potx=hline; else __asm__("nop\n nop\n nop\n nop\n nop"); // 9 cycles
+	if (reportMode==REPORT_BUTTONS) {
+	  // the same timed loop, both fire buttons kept on every line in place of
+	  // the comparators (captureButtons()), the pots are not read
+	  bits = 0;
+	  for (hline=0;hline<228;hline++) {  // 7 cycles
+	    bits <<= 2;  // 4 cycles
+	    if (RB3) bits|=1; else __asm__("nop\n nop\n nop\n nop"); // 8 cycles
+	    if (RA5) bits|=2; else __asm__("nop\n nop\n nop\n nop"); // 8 cycles
+	    sampleBuf[hline>>2] = bits;  // 12 cycles, the 4th line of a byte stores it complete
+	    
+	    for (j=0;j<LINE_BTN_LOOPS;j++); // 2+8*1 = 10 cycles @ 4MHz
+	    LINE_BTN_PAD();                 // 7 cycles @ 4MHz
+	    simCycles(LINE_CYCLES);
+	  }
+	} else if (reportMode==REPORT_TRACE) {
+	  // the same timed loop, both comparators kept on every line (captureTrace())
+	  bits = 0;
+	  for (hline=0;hline<228;hline++) {  // 7 cycles
+	    bits <<= 2;  // 4 cycles
+	    if (C1OUT) { poty=hline; bits|=1; } else __asm__("nop\n nop\n nop\n nop\n nop\n nop"); // 10 cycles
+	    if (C2OUT) { potx=hline; bits|=2; } else __asm__("nop\n nop\n nop\n nop\n nop\n nop"); // 10 cycles
+	    sampleBuf[hline>>2] = bits;  // 12 cycles, the 4th line of a byte stores it complete
+	   
+	    for (j=0;j<LINE_TRACE_LOOPS;j++); // 2+8*1 = 10 cycles @ 4MHz
+	    LINE_TRACE_PAD();                 // 3 cycles @ 4MHz
+	    simCycles(LINE_CYCLES);
+	  }
+	} else if (vihLevel[0]!=vihLevel[1]) {
+	  // the same timed loop in two slots, x then y read at their own reference level
+	  vrx = (VRCON & 0xF0) | vihLevel[0];
+	  vry = (VRCON & 0xF0) | vihLevel[1];
+	  for (hline=0;hline<228;hline++) {  // 7 cycles
+	    VRCON = vrx;                      // 4 cycles, 2 more back to bank 0
+	    for (j=0;j<VREF_LOOPS;j++);      // none @ 4MHz
+	    VREF_PAD();                       // 8 cycles @ 4MHz, 10us with the bank switch
+	    simCycles(VREF_CYCLES);
+	    if (C2OUT) potx=hline; else __asm__("nop\n nop\n nop\n nop\n nop"); // 9 cycles
+	    
+	    VRCON = vry;                      // 4 cycles, 2 more back to bank 0
+	    for (j=0;j<VREF_LOOPS;j++);      // none @ 4MHz
+	    VREF_PAD();                       // 8 cycles @ 4MHz, 10us with the bank switch
+	    simCycles(VREF_CYCLES);
+	    if (C1OUT) poty=hline; else __asm__("nop\n nop\n nop\n nop\n nop"); // 9 cycles
+	    
+	    for (j=0;j<LINE_SPLIT_LOOPS;j++); // none @ 4MHz
+	    LINE_SPLIT_PAD();                 // 3 cycles @ 4MHz
+	    simCycles(LINE_CYCLES-2*VREF_CYCLES);
+	  }
+	  VRCON = vrx;
+	} else {
+	  // timed loop, trimmed to 64us (LINE_CYCLES)
+	  for (hline=0;hline<228;hline++) {  // 7 cycles
+	    if (C1OUT) poty=hline; else __asm__("nop\n nop\n nop\n nop\n nop"); // 9 cycles
+	    if (C2OUT) potx=hline; else __asm__("nop\n nop\n nop\n nop\n nop"); // 9 cycles
 	   
-	  for (j=0;j<3;j++); // 2+8*3 = 26 cycles 
-	  __asm__("nop\n nop\n nop\n nop\n nop"); // 5 cycles
+	    for (j=0;j<LINE_LOOPS;j++); // 2+8*3 = 26 cycles @ 4MHz
+	    LINE_PAD();                 // 5 cycles @ 4MHz
+	    simCycles(LINE_CYCLES);
+	  }
 	}
 	
 	// Hold capacitors on discharge
 	TRISA0=0; RA0=0;
 	TRISA1=0; RA1=0;
+	profPhase(PROF_OTHER);
 }
 
 
 
 void scanKeyboard(void) {
 	uint8_t j;
+	profPhase(PROF_SCAN);
+	if (dwellScan) {
+		for (j=0;j<4;j++) rows[j] = sampleLine(j, keyDwell);
+		profPhase(PROF_OTHER);
+		return;
+	}
       
      
 	 
@@ -252,57 +658,87 @@ void scanKeyboard(void) {
 
 //    3  2  1  0  <- COL
 	
-	// Each row remains active by two horizontal lines (128us)
+	// Each row remains active by two horizontal lines (128us), padding from timing.h
 	
 	// Select first line  4+4+50+4+23+42+1 = 128 cycles
 	TRISLIN3 = 1; RLIN3 = 1;          // 4 cycles
 	TRISLIN0 = 0; RLIN0 = 0;          // 4 cycles
-	for (j=0;j<6;j++);               // 2+8*6 = 50 cycles	
-	__asm__("nop\n nop\n nop\n nop"); // 4 cycles
+	for (j=0;j<SETTLE_LOOPS;j++);    // 2+8*6 = 50 cycles @ 4MHz
+	SETTLE_PAD();                     // 4 cycles @ 4MHz
+	simCycles(SETTLE_CYCLES);
 	rows[0] = (PORTB & 0xF0)>>4;     // 23 cycles
-	for (j=0;j<5;j++);               // 2+8*5 = 42 cycles
-	__asm__("nop");                   // 1 cycle
+	for (j=0;j<HOLD_LOOPS;j++);      // 2+8*5 = 42 cycles @ 4MHz
+	simCycles(HOLD_CYCLES);
+	HOLD_PAD();                       // 1 cycle @ 4MHz
 	
 	
 	// Select 2nd line  4+4+50+4+23+42+1 = 128 cycles
 	TRISLIN0 = 1; RLIN0 = 1;          // 4 cycles
 	TRISLIN1 = 0; RLIN1 = 0;          // 4 cycles
-	for (j=0;j<6;j++);               // 2+8*6 = 50 cycles	
-	__asm__("nop\n nop\n nop\n nop"); // 4 cycles
+	for (j=0;j<SETTLE_LOOPS;j++);    // 2+8*6 = 50 cycles @ 4MHz
+	SETTLE_PAD();                     // 4 cycles @ 4MHz
+	simCycles(SETTLE_CYCLES);
 	rows[1] = (PORTB & 0xF0)>>4;     // 23 cycles
-	for (j=0;j<5;j++);               // 2+8*5 = 42 cycles
-	__asm__("nop");                   // 1 cycle	
+	for (j=0;j<HOLD_LOOPS;j++);      // 2+8*5 = 42 cycles @ 4MHz
+	simCycles(HOLD_CYCLES);
+	HOLD_PAD();                       // 1 cycle @ 4MHz	
 	
 	
 
 	// Select third line  4+4+50+4+23+42+1 = 128 cycles
 	TRISLIN1 = 1; RLIN1 = 1;          // 4 cycles
 	TRISLIN2 = 0; RLIN2 = 0;          // 4 cycles
-	for (j=0;j<6;j++);               // 2+8*6 = 50 cycles	
-	__asm__("nop\n nop\n nop\n nop"); // 4 cycles
+	for (j=0;j<SETTLE_LOOPS;j++);    // 2+8*6 = 50 cycles @ 4MHz
+	SETTLE_PAD();                     // 4 cycles @ 4MHz
+	simCycles(SETTLE_CYCLES);
 	rows[2] = (PORTB & 0xF0)>>4;     // 23 cycles
-	for (j=0;j<5;j++);               // 2+8*5 = 42 cycles
-	__asm__("nop");                   // 1 cycle
+	for (j=0;j<HOLD_LOOPS;j++);      // 2+8*5 = 42 cycles @ 4MHz
+	simCycles(HOLD_CYCLES);
+	HOLD_PAD();                       // 1 cycle @ 4MHz
 	
 	// Select fourth line  4+4+50+4+23+42+1 = 128 cycles
 	TRISLIN2 = 1; RLIN2 = 1;          // 4 cycles
 	TRISLIN3 = 0; RLIN3 = 0;          // 4 cycles
-	for (j=0;j<6;j++);               // 2+8*6 = 50 cycles	
-	__asm__("nop\n nop\n nop\n nop"); // 4 cycles
+	for (j=0;j<SETTLE_LOOPS;j++);    // 2+8*6 = 50 cycles @ 4MHz
+	SETTLE_PAD();                     // 4 cycles @ 4MHz
+	simCycles(SETTLE_CYCLES);
 	rows[3] = (PORTB & 0xF0)>>4;     // 23 cycles
-	for (j=0;j<5;j++);               // 2+8*5 = 42 cycles
-	__asm__("nop");                   // 1 cycle
+	for (j=0;j<HOLD_LOOPS;j++);      // 2+8*5 = 42 cycles @ 4MHz
+	simCycles(HOLD_CYCLES);
+	HOLD_PAD();                       // 1 cycle @ 4MHz
 	
-
+	profPhase(PROF_OTHER);
 }
 
 	
-void _putc (uint8_t c) {
-	while (!TRMT); // wait for transmit buffer to be empty
+void _txbyte (uint8_t c) {
+	profPhase(PROF_TX);
+	while (!TRMT) simCycles(3); // wait for transmit buffer to be empty
+	profPhase(PROF_OTHER);
 	TXREG = c;     // send character 
 }
 
 
+// Send a character, or queue it while a report is formatted (txQueued). At the 
+// bottom of every print path, so it waits for the transmitter itself and calls 
+// nothing else (see the call depth note above main()); events are polled by 
+// the scheduler tasks and the measurement loops, not here.
+void _putc (uint8_t c) {
+	if (txQueued) {
+		if (txLen<SAMPLE_BUF_SIZE) sampleBuf[txLen++] = c;
+		return;
+	}
+	profPhase(PROF_TX);
+	while (txSent!=txLen) { // report being sent first
+		while (!TRMT) simCycles(3);
+		TXREG = sampleBuf[txSent++];
+	}
+	while (!TRMT) simCycles(3);
+	profPhase(PROF_OTHER);
+	TXREG = c;
+}
+
+
 void _puts (char *ptr) {
   while (*ptr) {
     _putc (*ptr);
@@ -349,17 +785,27 @@ Pin row | 0 | 1 | 2 |   3   | COL
 
 */
 void printResults(void){
+  // print controller type
+  if (trackball) _puts("[TrackBall]"); else _puts("[Joystick]");
+  
   // print axes information
-  _puts("PotX:");
-  printNumber(potx);
-  _puts(" PotY:");
-  printNumber(poty);
+  if (calMode && !trackball) {
+    _puts("PosX:");
+    printNumber(linearize(potx, CAL_EE_ADDR+1));
+    _puts(" PosY:");
+    printNumber(linearize(poty, CAL_EE_ADDR+1+CAL_POINTS));
+  } else {
+    _puts("PotX:");
+    printNumber(potx);
+    _puts(" PotY:");
+    printNumber(poty);
+  }
   
-  // print buttons
+  // print buttons, as sampled by TASK_BUTTONS
   _puts(" Top:");
-  if (RB3==0) _putc('1'); else _putc('0');
+  if (buttonState & (1<<BTN_TOP)) _putc('1'); else _putc('0');
   _puts(" Bot:");
-  if (RA5==0) _putc('1'); else _putc('0');
+  if (buttonState & (1<<BTN_BOT)) _putc('1'); else _putc('0');
   
   // print Keys
   _puts(" Keys:");
@@ -388,12 +834,1356 @@ void printResults(void){
 
 
 void _delayms(uint8_t n) {
-uint8_t j;
- do {                     // total of = (10+10*j) *n  
-//    __asm__("nop\n");
-    j=99;
-    do { 
-       __asm__("nop\n nop\n"); 
-    } while (--j);
+uint8_t j, k;
+ profPhase(PROF_DELAY);
+ do {                     // total of = (10+10*j) * MS_REPEAT * n  
+    k=MS_REPEAT;
+    do {
+       j=MS_LOOPS;
+       do { 
+          __asm__("nop\n nop\n"); 
+       } while (--j);
+       simCycles(1000);
+    } while (--k);
  } while (--n);
+ profPhase(PROF_OTHER);
+}
+
+
+// Keypad bitmap from last scan, bit (line * 4 + rows[] bit) set when pressed 
+uint16_t readKeys(void) {
+	uint16_t keys;
+	keys = ((uint16_t)rows[3]<<12) | ((uint16_t)rows[2]<<8) | (rows[1]<<4) | rows[0];
+	return ~keys;
+}
+
+
+uint8_t readButtons(void) {
+	uint8_t buttons = 0;
+	if (RB3==0) buttons |= (1<<BTN_TOP);
+	if (RA5==0) buttons |= (1<<BTN_BOT);
+	return buttons;
+}
+
+
+/* 
+   Event frame, 5 bytes:  '!' name state '\n' '\r'
+   name  = key character as in keyNames[] or 'T'/'B' for the top/bottom buttons
+   state = '+' pressed, '-' released
+   Frames may land in the middle of a report line.
+*/
+void sendEvent(char name, bool pressed) {
+	_txbyte('!');
+	_txbyte(name);
+	if (pressed) _txbyte('+'); else _txbyte('-');
+	_txbyte('\n');
+	_txbyte('\r');
+}
+
+
+// Scan keypad and buttons and send one event frame per edge since last call,
+// for the measurement modes (the scheduler runs the keypad and button tasks)
+void pollEvents(void) {
+	if (!eventMode) return;
+	
+	scanKeyboard();
+	keyEvents();
+	buttonEvents(readButtons());
+}
+
+
+// Event frames for the key edges since the last call, from the last scan
+void keyEvents(void) {
+	uint16_t keys, changed, mask;
+	uint8_t i;
+	
+	keys = readKeys();
+	changed = keys ^ lastKeys;
+	if (changed) {
+		mask = 1;
+		for (i=0;i<16;i++) {
+			if (changed & mask) sendEvent(keyNames[i], (keys & mask)!=0);
+			mask <<= 1;
+		}
+	}
+	lastKeys = keys;
+}
+
+
+// Event frames for the button edges since the last call
+void buttonEvents(uint8_t buttons) {
+	if ((buttons ^ lastButtons) & (1<<BTN_TOP)) sendEvent('T', (buttons & (1<<BTN_TOP))!=0);
+	if ((buttons ^ lastButtons) & (1<<BTN_BOT)) sendEvent('B', (buttons & (1<<BTN_BOT))!=0);
+	lastButtons = buttons;
+}
+
+
+/*
+   Serial commands, one character each
+   e - toggle immediate key/button events
+   n - normal text report
+   m - keypad matrix report
+   g - one text or matrix report now, then only on request (n or m go back to periodic reports)
+   l - CAV transition latency report
+   v - trackball velocity report
+   s - start soak test, then 1..9 sets minutes between summaries
+   r - print soak log saved in EEPROM
+   c - upload linearization table, CAL_SIZE bytes and a checksum, one per ack
+   u - toggle linearized joystick positions
+   p - print and restart the phase profile (PROFILE build)
+   k - keypad settle time sweep
+   d - toggle dwell scan, keypad lines held for the swept settle time only
+   b - fire button capture, one line per press with its bounces
+   w - comparator trace, both outputs on every line of a frame as a binary block
+   x, y - set the ViH of the x or y pot input, then a VRCON level 0..9/A..F
+*/
+void checkCommands(void) {
+	uint8_t c;
+	
+	if (OERR) { // receiver overrun, restart it
+		CREN=0;
+		CREN=1;
+	}
+	if (!RCIF) return;
+	c = RCREG;
+	txFlush(); // replies after the report being sent, sampleBuf[] free for the command
+	
+	switch (c) {
+	case 'e':
+		eventMode = !eventMode;
+		if (eventMode) {
+			scanKeyboard();
+			lastKeys = readKeys(); // do not report keys already held
+			lastButtons = readButtons();
+			_puts("[Events] On, max latency:");
+			printNumber16(eventGapMs[reportMode] + EVENT_FRAME_MS);
+			_puts("ms +");
+			printNumber(EVENT_EDGE_MS);
+			_puts("ms per extra edge\n");
+		} else {
+			_puts("[Events] Off\n");
+		}
+		break;
+		
+	case 'n':
+		reportMode = REPORT_TEXT;
+		periodicReports();
+		break;
+		
+	case 'm':
+		reportMode = REPORT_MATRIX;
+		matrixMaxCount = 0;
+		matrixGhost = false;
+		matrixFault = false;
+		periodicReports();
+		break;
+		
+	case 'g':
+		if (reportMode>REPORT_MATRIX) break; // the measurement modes report on their own
+		reportOnDemand = true;
+		reportWanted = true;
+		taskNext[TASK_REPORT] = schedNow; // on this pass, after the commands
+		break;
+		
+	case 'l':
+		reportMode = REPORT_LATENCY;
+		break;
+		
+	case 'v':
+		reportMode = REPORT_VELOCITY;
+		velBurst = 0;
+		break;
+		
+	case 's':
+		soakStart();
+		break;
+		
+	case 'r':
+		printSavedSoak();
+		break;
+		
+	case 'c':
+		uploadCalibration();
+		break;
+		
+	case 'u':
+		toggleCalibration();
+		break;
+		
+	case 'k':
+		settleSweep();
+		break;
+		
+	case 'b':
+		buttonsStart();
+		break;
+		
+	case 'd':
+		toggleDwellScan();
+		break;
+		
+	case 'w':
+		cavOn(); // left off when the scheduler was detecting the controller
+		reportMode = REPORT_TRACE;
+		break;
+		
+	case 'x':
+		setVih(0);
+		break;
+		
+	case 'y':
+		setVih(1);
+		break;
+		
+#ifdef PROFILE
+	case 'p':
+		printProfile();
+		break;
+		
+#endif
+	default:
+		if ((reportMode==REPORT_SOAK) && (c>='1') && (c<='9')) soakInterval = c-'0';
+		break;
+	}
+}
+
+
+void printHex(uint8_t n) {
+	uint8_t digit;
+	
+	digit = (n>>4) + '0';
+	if (digit>'9') digit += 'A'-'9'-1;
+	_putc(digit);
+	
+	digit = (n & 0x0F) + '0';
+	if (digit>'9') digit += 'A'-'9'-1;
+	_putc(digit);
+}
+
+
+uint8_t countKeys(uint16_t keys) {
+	uint8_t count = 0;
+	while (keys) {
+		keys &= keys-1; // clear lowest key
+		count++;
+	}
+	return count;
+}
+
+
+/* 
+   There are no diodes on the keypad, so with three corners of a rectangle 
+   pressed the fourth one reads as pressed too. Any two lines sharing two
+   or more pressed columns is such a rectangle and at least one key of it 
+   may be a ghost.
+*/
+bool ghostKeys(uint16_t keys) {
+	uint8_t line[4];
+	uint8_t a, b, common;
+	
+	line[0] = keys & 0x0F;
+	line[1] = (keys>>4) & 0x0F;
+	line[2] = (keys>>8) & 0x0F;
+	line[3] = (keys>>12) & 0x0F;
+	
+	for (a=0;a<3;a++) {
+		for (b=a+1;b<4;b++) {
+			common = line[a] & line[b];
+			if (common & (common-1)) return true; // two or more bits
+		}
+	}
+	return false;
+}
+
+
+// Accumulate matrix statistics from the last keypad scan 
+void checkMatrix(void) {
+	uint16_t keys;
+	uint8_t count;
+	
+	keys = readKeys();
+	count = countKeys(keys);
+	if (count > matrixMaxCount) matrixMaxCount = count;
+	if (ghostKeys(keys)) matrixGhost = true;
+	if (keys & 0x8000) matrixFault = true;
+}
+
+
+/*
+   Matrix:hhhh Count:nnn Max:nnn Ghost:g Fault:f
+   hhhh  = keypad bitmap from last scan, bit (line * 4 + rows[] bit) set when pressed
+   Count = keys down on last scan, Max = most keys down on a single scan since last report
+   Ghost = 1 when a scan had a pressed rectangle, Fault = 1 when COL3 on LIN3 closed
+*/
+void printMatrix(void) {
+	uint16_t keys;
+	
+	keys = readKeys();
+	_puts("Matrix:");
+	printHex(keys>>8);
+	printHex(keys & 0xFF);
+	_puts(" Count:");
+	printNumber(countKeys(keys));
+	_puts(" Max:");
+	printNumber(matrixMaxCount);
+	_puts(" Ghost:");
+	if (matrixGhost) _putc('1'); else _putc('0');
+	_puts(" Fault:");
+	if (matrixFault) _putc('1'); else _putc('0');
+	_puts("\n");
+	
+	matrixMaxCount = 0;
+	matrixGhost = false;
+	matrixFault = false;
+}
+
+
+void printNumber16(uint16_t n) {
+	uint8_t digit;
+	
+	digit='0';
+	while (n>=10000) {
+		digit++;
+		n=n-10000;
+	}
+	_putc(digit);
+	
+	digit='0';
+	while (n>=1000) {
+		digit++;
+		n=n-1000;
+	}
+	_putc(digit);
+	
+	digit='0';
+	while (n>=100) {
+		digit++;
+		n=n-100;
+	}
+	_putc(digit);
+	
+	digit='0';
+	while (n>=10) {
+		digit++;
+		n=n-10;
+	}
+	_putc(digit);
+	
+	_putc('0'+n);
+}
+
+
+/* 
+   Lines from the CAV transition until the readings in v[0..LAT_FRAMES-1] settle,
+   i.e. the start of the first frame from which all readings stay within 
+   LAT_TOLERANCE of the last one. Resolution is one frame (LAT_FRAME_LINES).
+   Returns 0xFFFF when the last two frames still disagree.
+*/
+uint16_t settleLines(uint8_t *v) {
+	uint8_t last, i, diff;
+	uint16_t lines;
+	
+	last = v[LAT_FRAMES-1];
+	i = LAT_FRAMES-1;
+	do {
+		i--;
+		if (v[i]>last) diff = v[i]-last; else diff = last-v[i];
+		if (diff>LAT_TOLERANCE) break;
+	} while (i);
+	
+	if (diff<=LAT_TOLERANCE) return 0; // settled from the first frame
+	i++;                                // first settled frame
+	if (i==LAT_FRAMES-1) return 0xFFFF; 
+	
+	lines = 0;
+	while (i--) lines += LAT_FRAME_LINES;
+	return lines;
+}
+
+
+// Measure LAT_FRAMES frames back to back right after a CAV transition 
+void measureCavTransition(void) {
+	uint8_t i;
+	
+	for (i=0;i<LAT_FRAMES;i++) {
+		measurePotentimeters();
+		_delayms(1); // discharge
+		sampleBuf[i] = potx;
+		sampleBuf[i+LAT_FRAMES] = poty;
+	}
+}
+
+
+/*
+   Latency Off X:nnnnn Y:nnnnn On X:nnnnn Y:nnnnn
+   Lines (64us) each axis takes to settle after CAV is turned off and on again.
+   A trackball should move its outputs to the steady (~3V) level when CAV falls.
+   65535 means the readings did not settle in LAT_FRAMES frames.
+*/
+void measureCavLatency(void) {
+	uint16_t offX, offY;
+	
+	cavOn();
+	measurePotentimeters(); _delayms(2); // let the controller reach its CAV on state
+	measurePotentimeters(); _delayms(2);
+	pollEvents(); // before each transition, the frames after it stay back to back
+	
+	cavOff();
+	measureCavTransition();
+	offX = settleLines(&sampleBuf[0]);
+	offY = settleLines(&sampleBuf[LAT_FRAMES]);
+	pollEvents();
+	
+	cavOn();
+	measureCavTransition();
+	pollEvents();
+	
+	_puts("Latency Off X:");
+	printNumber16(offX);
+	_puts(" Y:");
+	printNumber16(offY);
+	_puts(" On X:");
+	printNumber16(settleLines(&sampleBuf[0]));
+	_puts(" Y:");
+	printNumber16(settleLines(&sampleBuf[LAT_FRAMES]));
+	_puts("\n");
+}
+
+
+void printSigned(int8_t n) {
+	if (n<0) {
+		_putc('-');
+		printNumber(-n);
+	} else {
+		_putc('+');
+		printNumber(n);
+	}
+}
+
+
+// Signed offset of a reading from the steady reference, clamped to 8 bits 
+int8_t velocity(uint8_t pot, uint8_t ref) {
+	int16_t v;
+	
+	v = (int16_t)pot - ref;
+	if (v>127) v = 127;
+	if (v<-127) v = -127;
+	return v;
+}
+
+
+// " Peak X:snnn Mean X:snnn" for one axis of the burst in sampleBuf[] 
+void printVelocityStats(uint8_t axis) {
+	int8_t v, peak = 0;
+	uint8_t i, mag, peakMag = 0;
+	int16_t sum = 0;
+	
+	for (i=0;i<VEL_FRAMES;i++) {
+		v = sampleBuf[axis+i];
+		sum += v;
+		if (v<0) mag = -v; else mag = v;
+		if (mag>peakMag) {
+			peakMag = mag;
+			peak = v;
+		}
+	}
+	printSigned(peak);
+	_putc('/');
+	printSigned(sum/VEL_FRAMES);
+}
+
+
+/*
+   VelBurst:nnnnn Ref X:nnn Y:nnn
+   Vff snnn snnn      <- one per frame, ff = frame in burst, X and Y offsets from Ref
+   ...
+   VelPeak/Mean X:snnn/snnn Y:snnn/snnn
+   
+   Ref is measured with CAV off (steady trackball), then VEL_FRAMES frames are 
+   measured with CAV on at ~16,6ms each (one 5200 frame) and kept in RAM, so the 
+   samples in a burst are evenly spaced regardless of the serial port speed.
+*/
+void measureVelocity(void) {
+	uint8_t refx, refy, i;
+	
+	cavOff();
+	measurePotentimeters(); _delayms(2);
+	measurePotentimeters(); _delayms(2);
+	refx = potx;
+	refy = poty;
+	pollEvents();
+	
+	cavOn();
+	measurePotentimeters(); _delayms(2); // trackball back to CAV on outputs
+	pollEvents(); // none inside the burst, its frames are evenly spaced
+	for (i=0;i<VEL_FRAMES;i++) {
+		measurePotentimeters(); _delayms(2);
+		sampleBuf[i] = velocity(potx, refx);
+		sampleBuf[i+VEL_FRAMES] = velocity(poty, refy);
+	}
+	pollEvents();
+	
+	_puts("VelBurst:");
+	printNumber16(velBurst++);
+	_puts(" Ref X:");
+	printNumber(refx);
+	_puts(" Y:");
+	printNumber(refy);
+	_puts("\n");
+	
+	for (i=0;i<VEL_FRAMES;i++) {
+		_putc('V');
+		printHex(i);
+		_putc(' ');
+		printSigned(sampleBuf[i]);
+		_putc(' ');
+		printSigned(sampleBuf[i+VEL_FRAMES]);
+		_puts("\n");
+		pollEvents();
+	}
+	
+	_puts("VelPeak/Mean X:");
+	printVelocityStats(0);
+	_puts(" Y:");
+	printVelocityStats(VEL_FRAMES);
+	_puts("\n");
+}
+
+
+uint8_t eepromRead(uint8_t addr) {
+	EEADR = addr;
+	RD = 1;
+	return EEDATA;
+}
+
+
+// Write one byte, skipped when unchanged to spare the EEPROM 
+void eepromWrite(uint8_t addr, uint8_t data) {
+	if (eepromRead(addr)==data) return;
+	EEADR = addr;
+	EEDATA = data;
+	WREN = 1;
+	EECON2 = 0x55; // required sequence, interrupts are never enabled
+	EECON2 = 0xAA;
+	WR = 1;
+	while (WR);    // ~4ms
+	WREN = 0;
+}
+
+
+void soakCount(uint16_t *counter) {
+	if (*counter!=0xFFFF) (*counter)++;
+}
+
+
+void soakAxis(uint8_t pot, uint8_t base, uint8_t *drift) {
+	uint8_t d;
+	
+	if (pot==SOAK_SATURATED) soakCount(&soak.sat);
+	else if ((pot<SOAK_RANGE_MIN) || (pot>SOAK_RANGE_MAX)) soakCount(&soak.range);
+	
+	if (pot>base) d = pot-base; else d = base-pot;
+	if (d>*drift) *drift = d;
+}
+
+
+// Check the last CAV on frame and keypad scan 
+void soakCheck(void) {
+	uint16_t keys, glitch;
+	
+	if (!soakBaseline) { // unit is left at rest, first reading is the baseline
+		soakBaseX = potx;
+		soakBaseY = poty;
+		soakBaseline = true;
+	}
+	soakCount(&soak.frames);
+	soakAxis(potx, soakBaseX, &soak.driftX);
+	soakAxis(poty, soakBaseY, &soak.driftY);
+	
+	// keys down on the previous scan only
+	keys = readKeys();
+	glitch = soakKeys[0] & ~(soakKeys[1] | keys);
+	while (glitch) {
+		glitch &= glitch-1;
+		soakCount(&soak.glitches);
+	}
+	soakKeys[1] = soakKeys[0];
+	soakKeys[0] = keys;
+}
+
+
+// Count minutes on Timer1 overflows, summary and EEPROM save every soakInterval minutes 
+void soakTimer(void) {
+	if (!TMR1IF) return;
+	TMR1IF = 0;
+	if (++soakTicks < SOAK_TICKS_PER_MIN) return;
+	
+	soakTicks = 0;
+	soak.minutes++;
+	if (++soakMinutes < soakInterval) return;
+	
+	soakMinutes = 0;
+	printSoak(&soak);
+	saveSoak();
+}
+
+
+void soakStart(void) {
+	uint8_t i;
+	uint8_t *p;
+	
+	p = (uint8_t *)&soak;
+	for (i=0;i<sizeof(soak);i++) *p++ = 0;
+	soakMinutes = 0;
+	soakTicks = 0;
+	soakBaseline = false;
+	soakKeys[0] = 0;
+	soakKeys[1] = 0;
+	TMR1IF = 0;
+	reportMode = REPORT_SOAK;
+	_puts("[Soak] Start\n");
+}
+
+
+/*
+   Soak Min:nnnnn Frames:nnnnn Range:nnnnn Sat:nnnnn Flip:nnnnn Glitch:nnnnn Drift X:nnn Y:nnn
+*/
+void printSoak(struct soakLog *log) {
+	_puts("Soak Min:");
+	printNumber16(log->minutes);
+	_puts(" Frames:");
+	printNumber16(log->frames);
+	_puts(" Range:");
+	printNumber16(log->range);
+	_puts(" Sat:");
+	printNumber16(log->sat);
+	_puts(" Flip:");
+	printNumber16(log->flips);
+	_puts(" Glitch:");
+	printNumber16(log->glitches);
+	_puts(" Drift X:");
+	printNumber(log->driftX);
+	_puts(" Y:");
+	printNumber(log->driftY);
+	_puts("\n");
+}
+
+
+/*
+   Magic, log, then a check byte that makes the sum of the log and check zero,
+   written last so a save cut short by a power loss reads back as no log. The
+   magic is only written the first time and unchanged log bytes are skipped,
+   so a summary usually costs the minute counters, the changed counters and
+   the check byte.
+*/
+void saveSoak(void) {
+	uint8_t i, sum = 0;
+	uint8_t *p;
+	
+	eepromWrite(0, SOAK_EE_MAGIC);
+	p = (uint8_t *)&soak;
+	for (i=0;i<sizeof(soak);i++) {
+		sum += *p;
+		eepromWrite(SOAK_EE_ADDR+i, *p++);
+	}
+	eepromWrite(SOAK_EE_CHECK, -sum);
+}
+
+
+// Saved log is read into sampleBuf[] 
+void printSavedSoak(void) {
+	uint8_t i, sum;
+	
+	sum = eepromRead(SOAK_EE_CHECK);
+	for (i=0;i<sizeof(struct soakLog);i++) {
+		sampleBuf[i] = eepromRead(SOAK_EE_ADDR+i);
+		sum += sampleBuf[i];
+	}
+	if ((eepromRead(0)!=SOAK_EE_MAGIC) || sum) {
+		_puts("[Soak] No log\n");
+		return;
+	}
+	_puts("[Soak] Saved ");
+	printSoak((struct soakLog *)sampleBuf);
+}
+
+
+// One detection and four CAV on frames with only the discharge delays, for the highest frame rate 
+void soakCycle(void) {
+	bool tb;
+	
+	cavOff();
+	measurePotentimeters(); _delayms(1);
+	measurePotentimeters(); _delayms(1);
+	soakTimer();
+	
+	tb = !( (potx>220) && (poty>220) );
+	if (soakBaseline && (tb!=trackball)) soakCount(&soak.flips);
+	trackball = tb;
+	
+	cavOn();
+	for (frameCounter = 4 ; frameCounter > 0 ; frameCounter--) {
+		measurePotentimeters(); 
+		_delayms(1); 
+		scanKeyboard();
+		pollEvents();
+		soakCheck();
+		soakTimer();
+	}
+}
+
+
+bool calStored(void) {
+	return eepromRead(CAL_EE_ADDR)==CAL_EE_MAGIC;
+}
+
+
+// Reading to position 0..255, piecewise linear between the breakpoints at table
+uint8_t linearize(uint8_t pot, uint8_t table) {
+	uint8_t i, lo, hi;
+	
+	lo = eepromRead(table);
+	if (pot<=lo) return 0;
+	for (i=1;i<CAL_POINTS;i++) {
+		hi = eepromRead(table+i);
+		if (pot<hi) return ((i-1)<<5) + (uint8_t)(((uint16_t)(pot-lo)<<5)/(hi-lo));
+		lo = hi;
+	}
+	return 255;
+}
+
+
+// Wait for a byte of an upload, false on timeout
+bool receiveByte(uint8_t *c) {
+	uint16_t wait;
+	
+	for (wait=0;wait<CAL_RX_WAIT;wait++) {
+		if (OERR) return false;
+		if (RCIF) {
+			*c = RCREG;
+			return true;
+		}
+		simCycles(10);
+	}
+	return false;
+}
+
+
+/* 
+   Table upload: x breakpoints, y breakpoints, then a checksum that makes the sum 
+   of all bytes zero. Received whole in sampleBuf before anything is written, a 
+   broken upload leaves the stored table as it was.
+   The host waits for "[Cal] Load " and then sends one byte per '.' answered, 
+   so the 2 byte receive FIFO can never overrun, whatever the host's latency:
+   [Cal] Load ...................
+*/
+void uploadCalibration(void) {
+	uint8_t i, sum = 0;
+	
+	_puts("[Cal] Load ");
+	for (i=0;i<=CAL_SIZE;i++) {
+		if (!receiveByte(&sampleBuf[i])) {
+			_puts("\n[Cal] Timeout\n");
+			return;
+		}
+		_putc('.');
+		sum += sampleBuf[i];
+	}
+	_puts("\n");
+	for (i=1;i<CAL_SIZE;i++) {
+		if ((i!=CAL_POINTS) && (sampleBuf[i]<=sampleBuf[i-1])) sum = 1; // not increasing
+	}
+	if (sum) {
+		_puts("[Cal] Bad table\n");
+		return;
+	}
+	
+	eepromWrite(CAL_EE_ADDR, 0xFF); // invalid until complete
+	for (i=0;i<CAL_SIZE;i++) eepromWrite(CAL_EE_ADDR+1+i, sampleBuf[i]);
+	eepromWrite(CAL_EE_ADDR, CAL_EE_MAGIC);
+	calMode = true;
+	_puts("[Cal] Saved, positions on\n");
+}
+
+
+void toggleCalibration(void) {
+	if (!calStored()) {
+		calMode = false;
+		_puts("[Cal] No table\n");
+		return;
+	}
+	calMode = !calMode;
+	if (calMode) _puts("[Cal] Positions on\n"); else _puts("[Cal] Positions off\n");
+}
+
+
+// Timer1, high byte read again in case the low byte rolled over
+uint16_t timer1Read(void) {
+	uint8_t h, l;
+	do {
+		h = TMR1H;
+		l = TMR1L;
+	} while (h != TMR1H);
+	return ((uint16_t)h<<8) | l;
+}
+
+
+// Every task due on its first tick, starting now
+void schedStart(void) {
+	uint8_t i;
+	
+	schedT1 = timer1Read();
+	schedNow = 0;
+	for (i=0;i<TASKS;i++) taskNext[i] = taskPhase[i];
+	detectFrames = 0;
+}
+
+
+// Back to a report every 64 ticks, on the ticks of its phase as after schedStart()
+void periodicReports(void) {
+	if (!reportOnDemand) return;
+	reportOnDemand = false;
+	reportWanted = false;
+	taskNext[TASK_REPORT] = schedNow + ((taskPhase[TASK_REPORT] - schedNow) & 63);
+}
+
+
+// Run the tasks due on the current tick, then wait for the next one. Ticks 
+// the tasks overran are skipped, what was due in them runs on the next pass.
+// A pass must be shorter than a Timer1 period (524ms @ 4MHz, 105ms @ 20MHz).
+void schedTick(void) {
+	uint8_t i;
+	
+	for (i=0;i<TASKS;i++) {
+		if ((int16_t)(schedNow - taskNext[i]) < 0) continue;
+		do {
+			taskNext[i] += taskPeriod[i];
+		} while ((int16_t)(schedNow - taskNext[i]) >= 0);
+		
+		switch (i) {
+		case TASK_COMMANDS:
+			checkCommands();
+			if (reportMode>REPORT_MATRIX) return; // measurement mode, leave the scheduler
+			break;
+		case TASK_DETECT:
+			cavOff();
+			detectFrames = DETECT_FRAMES;
+			break;
+		case TASK_POTS:
+			if (txSent!=txLen) break; // report being sent
+			potTask();
+			break;
+		case TASK_KEYPAD:
+			scanKeyboard();
+			if (eventMode) keyEvents();
+			if (reportMode==REPORT_MATRIX) checkMatrix();
+			break;
+		case TASK_BUTTONS:
+			buttonState = readButtons();
+			if (eventMode) buttonEvents(buttonState);
+			break;
+		case TASK_REPORT:
+			if (txSent!=txLen) break; // last one still queued, not at 9600bps
+			if (reportOnDemand) {
+				if (!reportWanted) break;
+				reportWanted = false;
+			}
+			txLen = 0;
+			txSent = 0;
+			txQueued = true;
+			if (reportMode==REPORT_MATRIX) printMatrix(); else printResults();
+			txQueued = false;
+			break;
+		}
+	}
+	
+	profPhase(PROF_DELAY);
+	while ((uint16_t)(timer1Read() - schedT1) < SCHED_TICK_T1) {
+		txPump();
+		simCycles(32); // timer1Read(), compare and txPump()
+	}
+	profPhase(PROF_OTHER);
+	do {
+		schedT1 += SCHED_TICK_T1;
+		schedNow++;
+	} while ((uint16_t)(timer1Read() - schedT1) >= SCHED_TICK_T1);
+}
+
+
+// Drive one keypad line low, the others released, as scanKeyboard() does
+void selectLine(uint8_t line) {
+	TRISLIN0 = 1; RLIN0 = 1;
+	TRISLIN1 = 1; RLIN1 = 1;
+	TRISLIN2 = 1; RLIN2 = 1;
+	TRISLIN3 = 1; RLIN3 = 1;
+	switch (line) {
+	case 0: TRISLIN0 = 0; RLIN0 = 0; break;
+	case 1: TRISLIN1 = 0; RLIN1 = 0; break;
+	case 2: TRISLIN2 = 0; RLIN2 = 0; break;
+	default: TRISLIN3 = 0; RLIN3 = 0; break;
+	}
+}
+
+
+// Columns of a line (rows[] format) KS_FIXED+2+8*loops cycles after driving it
+uint8_t sampleLine(uint8_t line, uint8_t loops) {
+	uint8_t j;
+	selectLine(line);
+	for (j=0;j<loops;j++);  // 2+8*loops cycles
+	simCycles(KS_FIXED+2+8*loops);
+	return (PORTB & 0xF0)>>4;
+}
+
+
+/*
+   Settle Keys:hhhh L0:nnn L1:nnn L2:nnn L3:nnn Dwell:nnn
+   Keys  = keypad bitmap seen at the longest delay
+   Ln    = settle time of each line in instruction cycles after it is driven 
+           (1us @ 4MHz), 255 when samples did not match even at the longest delay
+   Dwell = cycles the dwell scan waits on each line, slowest line plus a margin
+*/
+void settleSweep(void) {
+	uint8_t line, d, t, ref;
+	uint8_t settle[4];
+	uint16_t keys = 0;
+	
+	for (line=0;line<4;line++) {
+		sampleLine((line-1)&3, KS_STEPS-1);  // previous line, as in a scan
+		ref = sampleLine(line, KS_STEPS-1);
+		keys |= (uint16_t)(~ref & 0x0F) << (line*4);
+		settle[line] = 0;
+		for (d=0;d<KS_STEPS;d++) {
+			for (t=0;t<KS_TRIALS;t++) {
+				sampleLine((line-1)&3, KS_STEPS-1);
+				if (sampleLine(line, d)!=ref) settle[line] = d+1;
+			}
+		}
+	}
+	
+	if (keys==0) {
+		_puts("[Settle] No keys held\n");
+		return;
+	}
+	d = 0;
+	for (line=0;line<4;line++) if (settle[line] > d) d = settle[line];
+	d += KS_MARGIN;
+	if (d > KS_STEPS-1) d = KS_STEPS-1;
+	keyDwell = d;
+	dwellValid = true;
+	
+	_puts("Settle Keys:");
+	printHex(keys>>8);
+	printHex(keys & 0xFF);
+	for (line=0;line<4;line++) {
+		_puts(" L");
+		_putc('0'+line);
+		_putc(':');
+		if (settle[line]>=KS_STEPS) printNumber(255); else printNumber(KS_FIXED+2+8*settle[line]);
+	}
+	_puts(" Dwell:");
+	printNumber(KS_FIXED+2+8*keyDwell);
+	_puts("\n");
+}
+
+
+// The dwell scan makes a scan shorter, not more frequent: the keypad task stays
+// at one scan per frame (60Hz). The pot frame holds ticks 0..6, so a keypad 
+// task due inside it runs in tick 7 anyway; a shorter period would only put a
+// second scan in the same free tick, with no gain in key latency. What the
+// dwell scan saves is time in that tick and in the report ticks.
+void toggleDwellScan(void) {
+	if (!dwellValid) {
+		dwellScan = false;
+		_puts("[Settle] Sweep first\n");
+		return;
+	}
+	dwellScan = !dwellScan;
+	if (dwellScan) _puts("[Settle] Dwell scan on\n"); else _puts("[Settle] Dwell scan off\n");
+}
+
+
+// One frame of pot readings. During a detection the readings are taken with 
+// CAV off and only the last one is used: a joystick never charges the 
+// capacitors with CAV off. Reports keep the last CAV on readings.
+void potTask(void) {
+	uint8_t x, y;
+	
+	if (!detectFrames) {
+		measurePotentimeters();
+		return;
+	}
+	x = potx;
+	y = poty;
+	measurePotentimeters();
+	if (--detectFrames==0) {
+		trackball = !( (potx>220) && (poty>220) );
+		cavOn();
+	}
+	potx = x;
+	poty = y;
+}
+
+
+
+void buttonsStart(void) {
+	uint8_t b;
+	
+	btnLevel = 0;
+	if (RB3) btnLevel |= 1;
+	if (RA5) btnLevel |= 2;
+	for (b=0;b<2;b++) btn[b].state = ((btnLevel>>b) & 1) ? BTN_IDLE : BTN_WAIT;
+	btnClock = 0;
+	btnT1 = timer1Read();
+	reportMode = REPORT_BUTTONS;
+	_puts("[Buttons] Capture\n");
+}
+
+
+// One frame back to back with the next, buttons sampled on each line
+void captureButtons(void) {
+	uint16_t lines, start;
+	
+	lines = (uint16_t)(timer1Read() - btnT1)/BTN_LINE_T1;  // whole lines, the rest counts next time
+	btnT1 += lines*BTN_LINE_T1;
+	btnClock += lines;
+	start = btnClock;
+	
+	measurePotentimeters();
+	_delayms(1); // discharge, edges in here are seen on the first line of the next frame
+	
+	buttonLines(start);
+	buttonFrame(0, start+228);
+	buttonFrame(1, start+228);
+}
+
+
+// Edges of both buttons in line order, from the samples of the frame that started at start
+void buttonLines(uint16_t start) {
+	uint8_t i, k, bits, level;
+	
+	for (i=0;i<BTN_BYTES;i++) {
+		bits = sampleBuf[i];
+		if (bits==btnSame[btnLevel]) { // no edge in these 4 lines
+			start += 4;
+			continue;
+		}
+		for (k=0;k<4;k++) {
+			level = bits>>6;
+			bits <<= 2;
+			if ((level ^ btnLevel) & 1) buttonEdge(&btn[0], level & 1, start);
+			if ((level ^ btnLevel) & 2) buttonEdge(&btn[1], level>>1, start);
+			btnLevel = level;
+			start++;
+		}
+	}
+}
+
+
+// Close a burst that has gone quiet by the end of a frame
+void buttonFrame(uint8_t b, uint16_t end) {
+	struct buttonPress *p = &btn[b];
+	uint8_t level = (btnLevel>>b) & 1;
+	
+	// the start of what is being timed follows the clock once it is 
+	// BTN_TIME_MAX old, so the times saturate instead of wrapping
+	switch (p->state) {
+	case BTN_DOWN:
+	case BTN_HELD:
+		if ((uint16_t)(end - p->first[0]) > BTN_TIME_MAX) p->first[0] = end - BTN_TIME_MAX;
+		break;
+	case BTN_UP:
+		if ((uint16_t)(end - p->first[1]) > BTN_TIME_MAX) p->first[1] = end - BTN_TIME_MAX;
+		if ((uint16_t)(p->first[1] - p->first[0]) > BTN_TIME_MAX) p->first[0] = p->first[1] - BTN_TIME_MAX;
+		break;
+	}
+	if ((uint16_t)(end - p->last) > BTN_TIME_MAX) p->last = end - BTN_TIME_MAX;
+	
+	if ((uint16_t)(end - p->last) < BTN_QUIET) return;
+	switch (p->state) {
+	case BTN_DOWN:
+		p->downLen = p->last - p->first[0];
+		if (level==0) {
+			p->state = BTN_HELD;
+			break;
+		}
+		p->first[1] = p->last; // released inside the burst
+		p->bounces[1] = 0;
+		printButtonPress(b);
+		break;
+	case BTN_UP:
+		if (level==0) { // chatter while held, still pressed
+			p->state = BTN_HELD;
+			break;
+		}
+		printButtonPress(b);
+		break;
+	case BTN_WAIT:
+		if (level) p->state = BTN_IDLE;
+		break;
+	}
+}
+
+
+// level = pin after the edge, 0 = pressed
+void buttonEdge(struct buttonPress *p, uint8_t level, uint16_t t) {
+	switch (p->state) {
+	case BTN_IDLE:
+		if (level) break;
+		p->state = BTN_DOWN;
+		p->first[0] = t;
+		p->bounces[0] = 0;
+		break;
+	case BTN_HELD:
+		if (!level) break;
+		p->state = BTN_UP;
+		p->first[1] = t;
+		p->bounces[1] = 0;
+		break;
+	case BTN_DOWN:
+		if (p->bounces[0] < 255) p->bounces[0]++;
+		break;
+	case BTN_UP:
+		if (p->bounces[1] < 255) p->bounces[1]++;
+		break;
+	}
+	p->last = t;
+}
+
+
+// Lines as 0,1ms (16/25 each), 65535 from BTN_TIME_MAX
+void printButtonTime(uint16_t lines) {
+	if (lines >= BTN_TIME_MAX) lines = 0xFFFF;
+	else lines = (lines/25)*16 + ((lines%25)*16)/25;
+	printNumber16(lines);
+}
+
+
+/*
+   Button T Held:nnnnn Down:nnnnn/nnn Up:nnnnn/nnn
+   Held = first press edge to first release edge
+   Down = press bounce, first to last edge of the burst / edges after the first
+   Up   = the same for the release
+   Times in 0,1ms, to the line (64us).
+*/
+void printButtonPress(uint8_t b) {
+	struct buttonPress *p = &btn[b];
+	
+	_puts("Button ");
+	_putc(b ? 'B' : 'T');
+	_puts(" Held:");
+	printButtonTime(p->first[1] - p->first[0]);
+	_puts(" Down:");
+	printButtonTime(p->downLen);
+	_putc('/');
+	printNumber(p->bounces[0]);
+	_puts(" Up:");
+	printButtonTime(p->last - p->first[1]);
+	_putc('/');
+	printNumber(p->bounces[1]);
+	_puts("\n");
+	p->state = BTN_IDLE;
+}
+
+
+/*
+   Trace X:nnn Y:nnn\n\r followed by TRACE_BYTES raw bytes, then \n\r
+   X, Y = readings of the traced frame, last line with each comparator high
+   From the header's \n to the end of the block everything goes out with 
+   _txbyte(), no event frames inside; events are sent before the header and 
+   right after the block.
+*/
+void captureTrace(void) {
+	uint8_t i;
+	
+	measurePotentimeters(); // discharge while the block is sent, ~80ms
+	pollEvents();
+	_puts("Trace X:");
+	printNumber(potx);
+	_puts(" Y:");
+	printNumber(poty);
+	_txbyte('\n');
+	_txbyte('\r');
+	for (i=0;i<TRACE_BYTES;i++) _txbyte(sampleBuf[i]);
+	_txbyte('\n');
+	_txbyte('\r');
+	pollEvents();
+}
+
+
+/*
+   x or y followed by a level 0-9/A-F sets the ViH of that axis, VRCON VR level
+   [ViH] X:nnn/nnnnnmV Y:nnn/nnnnnmV
+   nnn = VR level, nnnnn = Vref with a 5V supply
+*/
+void setVih(uint8_t axis) {
+	uint8_t c;
+	
+	if (!receiveByte(&c)) {
+		_puts("[ViH] Timeout\n");
+		return;
+	}
+	if (c>='0' && c<='9') c -= '0';
+	else if (c>='A' && c<='F') c -= 'A'-10;
+	else if (c>='a' && c<='f') c -= 'a'-10;
+	else {
+		_puts("[ViH] Bad level\n");
+		return;
+	}
+	vihLevel[axis] = c;
+	VRCON = (VRCON & 0xF0) | vihLevel[0]; // split per line when the levels differ
+	
+	_puts("[ViH] X:");
+	printNumber(vihLevel[0]);
+	_putc('/');
+	printNumber16((uint16_t)vihLevel[0]*625/3);
+	_puts("mV Y:");
+	printNumber(vihLevel[1]);
+	_putc('/');
+	printNumber16((uint16_t)vihLevel[1]*625/3);
+	_puts("mV\n");
+}
+
+#ifdef PROFILE
+
+// Close the current phase and start another. Phases do not nest, each ends 
+// back in PROF_OTHER. Marks must come less than one Timer1 period apart 
+// (524ms @ 4MHz, 105ms @ 20MHz).
+// The phase gets whole units, the ticks left over go with the next phase, 
+// so the total stays exact and no phase loses its short marks. When the 
+// total reaches PROF_FOLD all counts are halved and the unit doubled, up to 
+// units of 32768 ticks; the profile then stops (after ~18min @ 4MHz, 
+// ~3.5min @ 20MHz, well after Ms saturates).
+void profSwitch(uint8_t phase) {
+	uint8_t h, l, shift, i;
+	uint16_t now, d, units;
+	
+	do {            // timer1Read() inline, _putc() calls this at the bottom of the print paths
+		h = TMR1H;
+		l = TMR1L;
+	} while (h != TMR1H);
+	now = ((uint16_t)h<<8) | l;
+	d = now - profLast;
+	profLast = now;
+	shift = PROF_SHIFT + profScale;
+	if (profTotal < PROF_FOLD) {
+		units = d >> shift;
+		profRest += d & ((1U<<shift)-1);
+		units += profRest >> shift;
+		profRest &= (1U<<shift)-1;
+		profTicks[profCurrent] += units;
+		profTotal += units;
+		while ((profTotal >= PROF_FOLD) && (PROF_SHIFT+profScale < 15)) {
+			profTotal = 0;
+			for (i=0;i<PROF_PHASES;i++) {
+				profTicks[i] >>= 1;
+				profTotal += profTicks[i];
+			}
+			profRest >>= 1;
+			profScale++;
+		}
+	}
+	profCurrent = phase;
+}
+
+
+// Frame length from one pot measurement to the next, overrun when longer than a console frame
+void profFrameMark(void) {
+	uint16_t now, len;
+	
+	now = timer1Read();
+	if (profFrameValid) {
+		len = now - profFrameStart;
+		if (profFrames < 0xFFFF) profFrames++;
+		if ((len > PROF_FRAME_TICKS) && (profOverruns < 0xFFFF)) profOverruns++;
+		if (len > profMaxFrame) profMaxFrame = len;
+	}
+	profFrameStart = now;
+	profFrameValid = true;
+}
+
+
+// Share of the profile in tenths of a percent, 3 digits of long division (n <= profTotal)
+uint16_t profPermille(uint16_t n) {
+	uint16_t pm = 0;
+	uint8_t i;
+	
+	if (profTotal==0) return 0;
+	for (i=0;i<3;i++) {
+		n *= 10;    // under 10*PROF_FOLD
+		pm = pm*10 + n/profTotal;
+		n %= profTotal;
+	}
+	return pm;
+}
+
+
+// nnn.n  from tenths, up to 255.9
+void printTenths(uint16_t n) {
+	printNumber(n/10);
+	_putc('.');
+	_putc('0'+(n%10));
+}
+
+
+/*
+   Profile Ms:nnnnn Meas:nnn.n Scan:nnn.n Delay:nnn.n Tx:nnn.n Other:nnn.n Frames:nnnnn Over:nnnnn Max:nnn.n
+   Ms     = time since the last print (saturates at 65535)
+   phases = percent of that time
+   Frames = pot measurements, Over = frames longer than a console frame, Max = longest frame in ms
+   Counters are copied and restarted first, the time spent printing goes to the next profile.
+*/
+void printProfile(void) {
+	uint16_t pm[PROF_PHASES];
+	uint16_t ms, rest, frames, overruns, maxFrame;
+	uint8_t i;
+	
+	profSwitch(PROF_OTHER);
+	for (i=0;i<PROF_PHASES;i++) {
+		pm[i] = profPermille(profTicks[i]);
+		profTicks[i] = 0;
+	}
+	// 125*CYCLES_PER_US ticks to the ms, the units doubled into ticks one bit at a time to stay in 16 bits
+	ms = profTotal/(125*CYCLES_PER_US);
+	rest = profTotal%(125*CYCLES_PER_US);
+	for (i=0;i<PROF_SHIFT+profScale;i++) {
+		ms = (ms > 0x7FFF) ? 0xFFFF : ms<<1;
+		rest <<= 1;
+		if (rest >= 125*CYCLES_PER_US) {
+			rest -= 125*CYCLES_PER_US;
+			if (ms < 0xFFFF) ms++;
+		}
+	}
+	profTotal = 0;
+	profRest = 0;
+	profScale = 0;
+	// 25*CYCLES_PER_US ticks to the 0,1ms
+	maxFrame = (profMaxFrame/(25*CYCLES_PER_US))*2 + ((profMaxFrame%(25*CYCLES_PER_US))*2)/(25*CYCLES_PER_US);
+	if (maxFrame > 2559) maxFrame = 2559;
+	frames = profFrames;
+	overruns = profOverruns;
+	profFrames = 0;
+	profOverruns = 0;
+	profMaxFrame = 0;
+	profFrameValid = false;
+	
+	_puts("Profile Ms:");
+	printNumber16(ms);
+	_puts(" Meas:");
+	printTenths(pm[PROF_MEASURE]);
+	_puts(" Scan:");
+	printTenths(pm[PROF_SCAN]);
+	_puts(" Delay:");
+	printTenths(pm[PROF_DELAY]);
+	_puts(" Tx:");
+	printTenths(pm[PROF_TX]);
+	_puts(" Other:");
+	printTenths(pm[PROF_OTHER]);
+	_puts(" Frames:");
+	printNumber16(frames);
+	_puts(" Over:");
+	printNumber16(overruns);
+	_puts(" Max:");
+	printTenths(maxFrame);
+	_puts("\n");
 }
+#endif
@@ -0,0 +1,122 @@
+#!/bin/sh
+#
+# Atari 5200 Joystick Port Emulator
+#
+# Generates timing.h, the delay sequences of the timed loops, for a clock.
+#
+#   sh timing.sh F_OSC > timing.h
+#
+# Every timed block is a delay loop of 2+8n cycles plus 0..7 nops, padded
+# to a target in microseconds. The fixed cycles of each block (the code
+# around the padding) were measured on the 4MHz build, where the original
+# hand trimmed sequences come out unchanged. F_OSC must be a multiple of
+# 4MHz; 4MHz runs on the internal oscillator, anything else on an external
+# clock on RA7 (EC mode, see main.c).
+
+set -e
+
+F_OSC=${1:?usage: timing.sh F_OSC}
+if [ $((F_OSC % 4000000)) -ne 0 ] || [ "$F_OSC" -lt 4000000 ] || [ "$F_OSC" -gt 20000000 ]; then
+	echo "timing.sh: F_OSC must be 4, 8, 12, 16 or 20MHz" >&2
+	exit 1
+fi
+CPU=$((F_OSC / 4000000))          # instruction cycles per microsecond
+
+LINE_US=64                        # pot input line period, as POKEY
+LINE_FIXED=33                     # comparator tests and loop control
+BUTTON_FIXED=14                   # bit shift, button tests and byte store, less the comparator tests (button capture)
+TRACE_FIXED=18                    # bit shift, two bit sets and the trace byte store (comparator trace)
+VREF_US=10                        # Vref settling after a VRCON write, datasheet maximum (per-axis ViH)
+VRCON_FIXED=12                    # two VRCON writes, 4 cycles each and 2 to switch back to bank 0
+VREF_LEAD=2                       # that bank switch, already part of the Vref settling
+SETTLE_US=62                      # keypad line selected to columns read
+SETTLE_FIXED=8                    # line select
+HOLD_US=66                        # columns read to next line
+HOLD_FIXED=23                     # columns read
+
+# nops N -> "nop\n nop\n ... nop"
+nops() {
+	asm="nop"
+	i=1
+	while [ "$i" -lt "$1" ]; do
+		asm="$asm\\n nop"
+		i=$((i + 1))
+	done
+	printf '%s' "$asm"
+}
+
+# pad NAME CYCLES -> NAME_LOOPS and NAME_PAD(), nops only when a loop does not fit
+pad() {
+	loops=$((($2 - 2) / 8))
+	if [ "$2" -lt 10 ]; then
+		loops=0
+	fi
+	if [ "$loops" -gt 255 ]; then
+		echo "timing.sh: $1 needs $loops loops" >&2
+		exit 1
+	fi
+	nops=$(($2 - 2 - 8 * loops))
+	if [ "$loops" -eq 0 ]; then
+		nops=$2
+	fi
+	if [ "$nops" -lt 0 ]; then
+		echo "timing.sh: $1 is $((-nops)) cycles over" >&2
+		exit 1
+	fi
+	if [ "$loops" -eq 0 ]; then
+		printf '#define %-22s %-5d // %d cycles: %d nop, no loop\n' "${1}_LOOPS" 0 "$2" "$nops"
+	else
+		printf '#define %-22s %-5d // %d cycles: 2+8*%d loop + %d nop\n' "${1}_LOOPS" "$loops" "$2" "$loops" "$nops"
+	fi
+	if [ "$nops" -eq 0 ]; then
+		printf '#define %-22s do { } while (0)\n' "${1}_PAD()"
+	else
+		printf '#define %-22s __asm__("%s")\n' "${1}_PAD()" "$(nops "$nops")"
+	fi
+}
+
+echo "/* timing.h - generated by timing.sh for F_OSC = $F_OSC, do not edit */"
+echo
+echo "#ifndef TIMING_H"
+echo "#define TIMING_H"
+echo
+printf '#define %-22s %dUL\n' F_OSC "$F_OSC"
+printf '#define %-22s %d\n' CYCLES_PER_US "$CPU"
+if [ "$F_OSC" -eq 4000000 ]; then
+	printf '#define %-22s _INTRC_OSC_NOCLKOUT\n' OSC_CONFIG
+else
+	printf '#define %-22s _EXTCLK_OSC  // clock in on RA7\n' OSC_CONFIG
+	printf '#define EXT_CLOCK\n'
+fi
+echo
+echo "// measurePotentimeters(), one line"
+printf '#define %-22s %d\n' LINE_CYCLES $((LINE_US * CPU))
+pad LINE $((LINE_US * CPU - LINE_FIXED))
+echo "// the same line with the fire buttons sampled (button capture)"
+pad LINE_BTN $((LINE_US * CPU - LINE_FIXED - BUTTON_FIXED))
+echo "// the same line with both comparators kept (comparator trace)"
+pad LINE_TRACE $((LINE_US * CPU - LINE_FIXED - TRACE_FIXED))
+echo "// the same line in two slots, Vref switched and settled before each comparator (per-axis ViH)"
+printf '#define %-22s %d\n' VREF_CYCLES $((VREF_US * CPU))
+pad VREF $((VREF_US * CPU - VREF_LEAD))
+pad LINE_SPLIT $((LINE_US * CPU - LINE_FIXED - VRCON_FIXED - 2 * (VREF_US * CPU - VREF_LEAD)))
+echo
+echo "// scanKeyboard(), each line selected for two pot lines"
+printf '#define %-22s %d\n' SETTLE_CYCLES $((SETTLE_US * CPU))
+pad SETTLE $((SETTLE_US * CPU - SETTLE_FIXED))
+printf '#define %-22s %d\n' HOLD_CYCLES $((HOLD_US * CPU))
+pad HOLD $((HOLD_US * CPU - HOLD_FIXED))
+echo
+echo "// _delayms(), inner loop of 10 cycles per count, repeated for a millisecond"
+printf '#define %-22s %d\n' MS_LOOPS 99
+printf '#define %-22s %d\n' MS_REPEAT "$CPU"
+echo
+echo "// 5us"
+printf '#define %-22s do { __asm__("%s"); } while (0)\n' "delay5us()" "$(nops $((5 * CPU)))"
+echo
+echo "// UART 9600bps with BRGH=1, Timer1 overflows (1:8 prescaler) per minute"
+printf '#define %-22s %d\n' SPBRG_9600 $(((F_OSC + 8 * 9600) / (16 * 9600) - 1))
+printf '#define %-22s %d\n' T1_TICK_NS $((8000 / CPU))
+printf '#define %-22s %d\n' T1_OVERFLOWS_PER_MIN $((60000000 * CPU / 524288))
+echo
+echo "#endif // TIMING_H"
@@ -0,0 +1,179 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   Stick linearization table, see calibration.h
+*/
+
+#include "calibration.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace a5200 {
+
+uint8_t CalTable::position(int a, uint8_t reading) const
+{
+    const uint8_t *t = axis[a];
+    uint8_t lo = t[0];
+    if (reading <= lo) return 0;
+    for (int i = 1; i < kCalPoints; ++i) {
+        uint8_t hi = t[i];
+        if (reading < hi) return static_cast<uint8_t>(((i - 1) << 5) + ((reading - lo) << 5) / (hi - lo));
+        lo = hi;
+    }
+    return 255;
+}
+
+bool CalTable::valid() const
+{
+    for (int a = 0; a < 2; ++a)
+        for (int i = 1; i < kCalPoints; ++i)
+            if (axis[a][i] <= axis[a][i - 1]) return false;
+    return true;
+}
+
+std::string CalTable::upload() const
+{
+    std::string s = "c";
+    uint8_t sum = 0;
+    for (int a = 0; a < 2; ++a)
+        for (int i = 0; i < kCalPoints; ++i) {
+            s += static_cast<char>(axis[a][i]);
+            sum += axis[a][i];
+        }
+    s += static_cast<char>(static_cast<uint8_t>(-sum));
+    return s;
+}
+
+bool CalTable::save(const std::string &path) const
+{
+    FILE *f = std::fopen(path.c_str(), "w");
+    if (!f) return false;
+    std::fprintf(f, "# Atari 5200 stick linearization, readings at positions 0, 32 .. 256\n");
+    for (int a = 0; a < 2; ++a) {
+        std::fputc(a ? 'y' : 'x', f);
+        for (int i = 0; i < kCalPoints; ++i) std::fprintf(f, " %u", axis[a][i]);
+        std::fputc('\n', f);
+    }
+    return std::fclose(f) == 0;
+}
+
+bool CalTable::load(const std::string &path, std::string &error)
+{
+    std::ifstream in(path);
+    if (!in) {
+        error = path + ": cannot open";
+        return false;
+    }
+    bool seen[2] = {false, false};
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream s(line);
+        std::string name;
+        if (!(s >> name) || name[0] == '#') continue;
+        int a = name == "x" ? 0 : name == "y" ? 1 : -1;
+        for (int i = 0; a >= 0 && i < kCalPoints; ++i) {
+            unsigned v;
+            if (!(s >> v) || v > 255) a = -1;
+            else axis[a][i] = static_cast<uint8_t>(v);
+        }
+        if (a < 0) {
+            error = path + ": bad line '" + line + "'";
+            return false;
+        }
+        seen[a] = true;
+    }
+    if (!seen[0] || !seen[1] || !valid()) {
+        error = path + ": incomplete or not increasing";
+        return false;
+    }
+    return true;
+}
+
+
+void CalFit::addSweep(const Report &r)
+{
+    if (r.controller != Controller::Joystick || r.linear) return;
+    sweep_[0].push_back(r.potx);
+    sweep_[1].push_back(r.poty);
+}
+
+void CalFit::addPoint(int axis, double percent, double reading)
+{
+    points_[axis].push_back(CalAnchor{reading, percent * 2.56});
+}
+
+// Ends and center of a sweep; the second lowest and highest readings, so one glitch is ignored
+bool CalFit::sweepAnchors(int axis, std::vector<CalAnchor> &out, std::string &error) const
+{
+    const std::vector<uint8_t> &v = sweep_[axis];
+    const char *name = axis ? "y" : "x";
+    if (v.size() < kCalCenterReports + 10) {
+        error = std::string(name) + ": sweep too short";
+        return false;
+    }
+    std::vector<uint8_t> center(v.begin(), v.begin() + kCalCenterReports);
+    std::nth_element(center.begin(), center.begin() + kCalCenterReports / 2, center.end());
+    std::vector<uint8_t> all;
+    for (uint8_t r : v)
+        if (r < kCalSaturated) all.push_back(r);
+    if (all.size() < 4) {
+        error = std::string(name) + ": saturated";
+        return false;
+    }
+    std::sort(all.begin(), all.end());
+    double low = all[1], mid = center[kCalCenterReports / 2], high = all[all.size() - 2];
+    if (!(low < mid && mid < high)) {
+        error = std::string(name) + ": stick not released at the start or not swept both ways";
+        return false;
+    }
+    out = {{low, 0}, {mid, 128}, {high, 256}};
+    return true;
+}
+
+bool CalFit::fit(CalTable &table, std::string &error) const
+{
+    for (int a = 0; a < 2; ++a) {
+        std::vector<CalAnchor> &anchors = anchors_[a];
+        if (points_[a].size() >= 2) {
+            anchors = points_[a];
+        } else if (!sweepAnchors(a, anchors, error)) {
+            return false;
+        }
+        std::sort(anchors.begin(), anchors.end(),
+                  [](const CalAnchor &x, const CalAnchor &y) { return x.reading < y.reading; });
+
+        // position of every reading, linear in pot resistance between anchors
+        std::vector<double> r(anchors.size());
+        for (size_t i = 0; i < anchors.size(); ++i) r[i] = model_.joystickResistance(anchors[i].reading, cav_);
+        for (size_t i = 1; i < anchors.size(); ++i)
+            if (!(r[i] > r[i - 1]) || anchors[i].position <= anchors[i - 1].position) {
+                error = std::string(a ? "y" : "x") + ": anchors not increasing";
+                return false;
+            }
+        auto position = [&](int reading) {
+            double rr = model_.joystickResistance(reading, cav_);
+            size_t i = 1;
+            while (i + 1 < anchors.size() && rr > r[i]) ++i;
+            const CalAnchor &p = anchors[i - 1], &q = anchors[i];
+            return p.position + (q.position - p.position) * (rr - r[i - 1]) / (r[i] - r[i - 1]);
+        };
+
+        // first reading at each breakpoint position, strictly increasing
+        int reading = 0;
+        for (int k = 0; k < kCalPoints; ++k) {
+            while (reading < kCalSaturated - 1 && position(reading) < k * kCalStep) ++reading;
+            int prev = k ? table.axis[a][k - 1] : -1;
+            table.axis[a][k] = static_cast<uint8_t>(std::max(reading, prev + 1));
+        }
+        if (table.axis[a][kCalPoints - 1] >= kCalSaturated) {
+            error = std::string(a ? "y" : "x") + ": range too narrow for the table";
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace a5200
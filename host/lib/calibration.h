@@ -0,0 +1,84 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   Stick linearization table.
+
+   The table holds, per axis, the readings at which the stick position reaches
+   0, 32, 64 .. 256, strictly increasing. A reading maps to a position 0..255 
+   by linear interpolation between the two breakpoints around it, with the 
+   same integer arithmetic as linearize() in the firmware, so host tools and a
+   board with the table uploaded (serial command 'c') give identical positions.
+
+   The table is fitted from anchor points, readings at known positions. A
+   guided sweep gives three per axis (both ends and the released center); a 
+   jig gives as many as it has stops. Between anchors the position is taken as
+   linear in pot resistance, which the pot model recovers from the reading, 
+   and the breakpoints are the readings where each position is reached.
+*/
+
+#ifndef A5200_CALIBRATION_H
+#define A5200_CALIBRATION_H
+
+#include "decoder.h"
+#include "potmodel.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace a5200 {
+
+constexpr int kCalPoints = 9;            // breakpoints per axis, CAL_POINTS in the firmware
+constexpr int kCalStep = 32;             // positions between breakpoints
+constexpr int kCalCenterReports = 10;    // released stick at the start of a sweep
+constexpr uint8_t kCalSaturated = 227;   // never crossed ViH, not a position
+
+struct CalTable {
+    uint8_t axis[2][kCalPoints];         // 0 = x, 1 = y
+
+    uint8_t position(int a, uint8_t reading) const;
+    bool valid() const;
+
+    // Serial bytes for the firmware: 'c', x, y, checksum
+    std::string upload() const;
+
+    // Text file, one line per axis: "x r0 r1 .. r8"
+    bool save(const std::string &path) const;
+    bool load(const std::string &path, std::string &error);
+};
+
+struct CalAnchor {
+    double reading;
+    double position;     // 0..256
+};
+
+class CalFit {
+public:
+    explicit CalFit(const PotModel &model = PotModel(), double cav = 5.0) : model_(model), cav_(cav) {}
+
+    // Guided sweep: joystick reports, stick released for the first kCalCenterReports
+    void addSweep(const Report &r);
+    size_t sweepReports() const { return sweep_[0].size(); }
+
+    // Jig: reading at a known position, percent of the travel
+    void addPoint(int axis, double percent, double reading);
+
+    // Fit both axes, false with error set when an axis lacks anchors
+    bool fit(CalTable &table, std::string &error) const;
+
+    // Anchors used for an axis, after fit()
+    const std::vector<CalAnchor> &anchors(int axis) const { return anchors_[axis]; }
+
+private:
+    bool sweepAnchors(int axis, std::vector<CalAnchor> &out, std::string &error) const;
+
+    PotModel model_;
+    double cav_;
+    std::vector<uint8_t> sweep_[2];
+    std::vector<CalAnchor> points_[2];
+    mutable std::vector<CalAnchor> anchors_[2];
+};
+
+} // namespace a5200
+
+#endif // A5200_CALIBRATION_H
@@ -0,0 +1,285 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   Line parsers for the emulator serial output, see decoder.h
+*/
+
+#include "decoder.h"
+
+namespace a5200 {
+
+namespace {
+
+// Cursor over a line, every match advances it
+struct Cursor {
+    const char *p, *end;
+
+    bool literal(const char *s)
+    {
+        size_t n = std::strlen(s);
+        if (static_cast<size_t>(end - p) < n || std::memcmp(p, s, n) != 0) return false;
+        p += n;
+        return true;
+    }
+
+    // fixed width decimal, as printNumber()/printNumber16()
+    bool number(int digits, uint16_t &v)
+    {
+        if (end - p < digits) return false;
+        uint32_t n = 0;
+        for (int i = 0; i < digits; ++i) {
+            unsigned d = static_cast<unsigned char>(p[i]) - '0';
+            if (d > 9) return false;
+            n = n * 10 + d;
+        }
+        if (n > 0xFFFF) return false;
+        p += digits;
+        v = static_cast<uint16_t>(n);
+        return true;
+    }
+
+    bool number8(uint8_t &v)
+    {
+        uint16_t n;
+        if (!number(3, n) || n > 255) return false;
+        v = static_cast<uint8_t>(n);
+        return true;
+    }
+
+    // sign followed by 3 digits, as printSigned()
+    bool signedNumber(int16_t &v)
+    {
+        if (p == end || (*p != '+' && *p != '-')) return false;
+        bool negative = (*p++ == '-');
+        uint16_t n;
+        if (!number(3, n)) return false;
+        v = negative ? -static_cast<int16_t>(n) : static_cast<int16_t>(n);
+        return true;
+    }
+
+    bool hex(int digits, uint16_t &v)
+    {
+        if (end - p < digits) return false;
+        uint16_t n = 0;
+        for (int i = 0; i < digits; ++i) {
+            char c = p[i];
+            unsigned d;
+            if (c >= '0' && c <= '9') d = c - '0';
+            else if (c >= 'A' && c <= 'F') d = c - 'A' + 10;
+            else return false;
+            n = static_cast<uint16_t>((n << 4) | d);
+        }
+        p += digits;
+        v = n;
+        return true;
+    }
+
+    // nnn.n as tenths
+    bool tenths(uint16_t &v)
+    {
+        uint16_t whole, fraction;
+        if (!(number(3, whole) && literal(".") && number(1, fraction))) return false;
+        v = static_cast<uint16_t>(whole * 10 + fraction);
+        return true;
+    }
+
+    bool flag(bool &v)
+    {
+        if (p == end || (*p != '0' && *p != '1')) return false;
+        v = (*p++ == '1');
+        return true;
+    }
+
+    bool done() const { return p == end; }
+};
+
+
+bool parseReport(Cursor c, Controller controller, Report &r)
+{
+    r.controller = controller;
+    r.linear = c.literal("PosX:");
+    if (!((r.linear || c.literal("PotX:")) && c.number8(r.potx) && c.literal(r.linear ? " PosY:" : " PotY:") &&
+          c.number8(r.poty) && c.literal(" Top:") && c.flag(r.top) && c.literal(" Bot:") && c.flag(r.bottom) &&
+          c.literal(" Keys:")))
+        return false;
+
+    r.keys = 0;
+    while (!c.done()) {
+        int bit = keyBit(*c.p++);
+        if (bit < 0) return false;
+        r.keys |= 1u << bit;
+    }
+    return true;
+}
+
+
+bool parseMatrix(Cursor c, Matrix &m)
+{
+    uint16_t count, max;
+    if (!(c.hex(4, m.keys) && c.literal(" Count:") && c.number(3, count) && c.literal(" Max:") &&
+          c.number(3, max) && c.literal(" Ghost:") && c.flag(m.ghost) && c.literal(" Fault:") &&
+          c.flag(m.fault) && c.done()))
+        return false;
+    m.count = static_cast<uint8_t>(count);
+    m.max = static_cast<uint8_t>(max);
+    return true;
+}
+
+
+bool parseSoak(Cursor c, Soak &s)
+{
+    return c.number(5, s.minutes) && c.literal(" Frames:") && c.number(5, s.frames) &&
+           c.literal(" Range:") && c.number(5, s.range) && c.literal(" Sat:") && c.number(5, s.sat) &&
+           c.literal(" Flip:") && c.number(5, s.flips) && c.literal(" Glitch:") && c.number(5, s.glitches) &&
+           c.literal(" Drift X:") && c.number8(s.driftX) && c.literal(" Y:") && c.number8(s.driftY) &&
+           c.done();
+}
+
+
+bool parseProfile(Cursor c, Profile &p)
+{
+    return c.number(5, p.ms) && c.literal(" Meas:") && c.tenths(p.permille[PhaseMeasure]) &&
+           c.literal(" Scan:") && c.tenths(p.permille[PhaseScan]) && c.literal(" Delay:") &&
+           c.tenths(p.permille[PhaseDelay]) && c.literal(" Tx:") && c.tenths(p.permille[PhaseTx]) &&
+           c.literal(" Other:") && c.tenths(p.permille[PhaseOther]) && c.literal(" Frames:") &&
+           c.number(5, p.frames) && c.literal(" Over:") && c.number(5, p.overruns) && c.literal(" Max:") &&
+           c.tenths(p.maxFrame) && c.done();
+}
+
+
+bool parseSettle(Cursor c, Settle &s)
+{
+    if (!c.hex(4, s.keys)) return false;
+    for (int l = 0; l < 4; ++l) {
+        const char name[] = { ' ', 'L', static_cast<char>('0' + l), ':', '\0' };
+        if (!(c.literal(name) && c.number8(s.lines[l]))) return false;
+    }
+    return c.literal(" Dwell:") && c.number8(s.dwell) && c.done();
+}
+
+
+bool parseButton(Cursor c, ButtonPress &b)
+{
+    if (c.p == c.end || (*c.p != 'T' && *c.p != 'B')) return false;
+    b.name = *c.p++;
+    return c.literal(" Held:") && c.number(5, b.held) && c.literal(" Down:") && c.number(5, b.down) &&
+           c.literal("/") && c.number8(b.downEdges) && c.literal(" Up:") && c.number(5, b.up) &&
+           c.literal("/") && c.number8(b.upEdges) && c.done();
+}
+
+} // namespace
+
+
+int keyBit(char name)
+{
+    for (int i = 0; i < 16; ++i)
+        if (kKeyNames[i] == name) return i;
+    return -1;
+}
+
+
+bool parseLine(std::string_view line, Record &out)
+{
+    Cursor c{line.data(), line.data() + line.size()};
+    out.text = line;
+    out.type = RecordType::Unknown;
+    if (line.empty()) return false;
+
+    switch (*c.p) {
+    case '[':
+        if (c.literal("[Joystick]")) {
+            out.type = RecordType::Report;
+            if (parseReport(c, Controller::Joystick, out.report)) return true;
+        } else if (c.literal("[TrackBall]")) {
+            out.type = RecordType::Report;
+            if (parseReport(c, Controller::Trackball, out.report)) return true;
+        } else if (c.literal("[Soak] Saved Soak Min:")) {
+            out.type = RecordType::Soak;
+            out.soak.saved = true;
+            if (parseSoak(c, out.soak)) return true;
+        } else {
+            out.type = RecordType::Status;
+            return true;
+        }
+        break;
+
+    case 'M':
+        if (c.literal("Matrix:")) {
+            out.type = RecordType::Matrix;
+            if (parseMatrix(c, out.matrix)) return true;
+        }
+        break;
+
+    case 'L': {
+        Latency &l = out.latency;
+        out.type = RecordType::Latency;
+        if (c.literal("Latency Off X:") && c.number(5, l.offX) && c.literal(" Y:") && c.number(5, l.offY) &&
+            c.literal(" On X:") && c.number(5, l.onX) && c.literal(" Y:") && c.number(5, l.onY) && c.done())
+            return true;
+        break;
+    }
+
+    case 'V':
+        if (c.literal("VelBurst:")) {
+            VelocityBurst &b = out.burst;
+            out.type = RecordType::VelocityBurst;
+            if (c.number(5, b.burst) && c.literal(" Ref X:") && c.number8(b.refx) && c.literal(" Y:") &&
+                c.number8(b.refy) && c.done())
+                return true;
+        } else if (c.literal("VelPeak/Mean X:")) {
+            VelocityStats &s = out.stats;
+            out.type = RecordType::VelocityStats;
+            if (c.signedNumber(s.peakX) && c.literal("/") && c.signedNumber(s.meanX) && c.literal(" Y:") &&
+                c.signedNumber(s.peakY) && c.literal("/") && c.signedNumber(s.meanY) && c.done())
+                return true;
+        } else {
+            VelocitySample &v = out.sample;
+            uint16_t frame;
+            out.type = RecordType::VelocitySample;
+            if (c.literal("V") && c.hex(2, frame) && c.literal(" ") && c.signedNumber(v.x) && c.literal(" ") &&
+                c.signedNumber(v.y) && c.done()) {
+                v.frame = static_cast<uint8_t>(frame);
+                return true;
+            }
+        }
+        break;
+
+    case 'S':
+        if (c.literal("Soak Min:")) {
+            out.type = RecordType::Soak;
+            out.soak.saved = false;
+            if (parseSoak(c, out.soak)) return true;
+        } else if (c.literal("Settle Keys:")) {
+            out.type = RecordType::Settle;
+            if (parseSettle(c, out.settle)) return true;
+        }
+        break;
+
+    case 'B':
+        if (c.literal("Button ")) {
+            out.type = RecordType::Button;
+            if (parseButton(c, out.button)) return true;
+        }
+        break;
+
+    case 'T':
+        if (c.literal("Trace X:")) {
+            Trace &t = out.trace;
+            out.type = RecordType::Trace;
+            if (c.number8(t.potx) && c.literal(" Y:") && c.number8(t.poty) && c.done()) return true;
+        }
+        break;
+
+    case 'P':
+        if (c.literal("Profile Ms:")) {
+            out.type = RecordType::Profile;
+            if (parseProfile(c, out.profile)) return true;
+        }
+        break;
+    }
+
+    out.type = RecordType::Unknown;
+    return false;
+}
+
+} // namespace a5200
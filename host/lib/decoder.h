@@ -0,0 +1,365 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   Streaming decoder for the emulator serial output.
+
+   Decodes the exact byte stream sent by the firmware (printResults() reports,
+   event frames and the measurement mode reports) into Record structs. The 
+   decoder keeps a single fixed line buffer: complete lines inside a chunk are
+   parsed in place and only a line split across chunks, or interrupted by an 
+   event frame, is copied. No memory is allocated per record.
+
+   A Trace line is followed by a binary block (the comparator trace), which
+   is collected and delivered with it as a single record. The block starts
+   after the line's '\n\r'; an event frame found in place of the '\r' is
+   decoded as an event, never taken as block data.
+*/
+
+#ifndef A5200_DECODER_H
+#define A5200_DECODER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace a5200 {
+
+// Key names by bitmap position (line * 4 + rows[] bit), as keyNames[] in the firmware
+constexpr char kKeyNames[16] = { '7','4','1','*', '8','5','2','0', '9','6','3','#', 'R','P','S','?' };
+
+// Bitmap bit of a key character, -1 if not a keypad key
+int keyBit(char name);
+
+enum class Controller : uint8_t { Unknown, Joystick, Trackball };
+
+enum class RecordType : uint8_t {
+    Report,         // [Joystick]PotX:nnn PotY:nnn Top:n Bot:n Keys:...
+    Event,          // !k+  key or button edge
+    Matrix,         // Matrix:hhhh Count:nnn Max:nnn Ghost:g Fault:f
+    Latency,        // Latency Off X:nnnnn Y:nnnnn On X:nnnnn Y:nnnnn
+    VelocityBurst,  // VelBurst:nnnnn Ref X:nnn Y:nnn
+    VelocitySample, // Vff snnn snnn
+    VelocityStats,  // VelPeak/Mean X:snnn/snnn Y:snnn/snnn
+    Soak,           // Soak Min:nnnnn ...  ([Soak] Saved Soak ... when read from EEPROM)
+    Profile,        // Profile Ms:nnnnn Meas:nnn.n ... (PROFILE firmware build)
+    Settle,         // Settle Keys:hhhh L0:nnn L1:nnn L2:nnn L3:nnn Dwell:nnn
+    Button,         // Button T Held:nnnnn Down:nnnnn/nnn Up:nnnnn/nnn
+    Trace,          // Trace X:nnn Y:nnn + kTraceBytes binary
+    Status,         // other [..] lines, e.g. [Events] Off
+    Unknown
+};
+
+struct Report {
+    Controller controller;
+    uint8_t potx, poty;
+    bool top, bottom;
+    uint16_t keys;        // bitmap, bit set when pressed
+    bool linear;          // PosX/PosY, positions through the calibration table (calibration.h)
+};
+
+struct Event {
+    char name;            // key character or 'T'/'B' for top/bottom button
+    bool pressed;
+};
+
+struct Matrix {
+    uint16_t keys;
+    uint8_t count, max;
+    bool ghost, fault;
+};
+
+struct Latency {
+    uint16_t offX, offY, onX, onY;   // lines, 65535 = not settled
+};
+
+struct VelocityBurst {
+    uint16_t burst;
+    uint8_t refx, refy;
+};
+
+struct VelocitySample {
+    uint8_t frame;
+    int16_t x, y;
+};
+
+struct VelocityStats {
+    int16_t peakX, meanX, peakY, meanY;
+};
+
+struct Soak {
+    uint16_t minutes, frames, range, sat, flips, glitches;
+    uint8_t driftX, driftY;
+    bool saved;           // read back from EEPROM
+};
+
+enum ProfilePhase : uint8_t { PhaseMeasure, PhaseScan, PhaseDelay, PhaseTx, PhaseOther, kProfilePhases };
+
+struct Profile {
+    uint16_t ms;                        // time profiled
+    uint16_t permille[kProfilePhases];  // share of each phase
+    uint16_t frames, overruns;
+    uint16_t maxFrame;                  // longest frame, 0.1 ms
+};
+
+struct Settle {
+    uint16_t keys;        // keys held during the sweep
+    uint8_t lines[4];     // settle time of each keypad line in cycles, 255 = never settled
+    uint8_t dwell;        // cycles per line of the dwell scan
+};
+
+struct ButtonPress {
+    char name;                    // 'T' top, 'B' bottom
+    uint16_t held, down, up;      // press duration and bounce lengths, 0.1 ms
+    uint8_t downEdges, upEdges;   // edges after the first one in each bounce
+};
+
+constexpr int kTraceLines = 228;
+constexpr int kTraceBytes = kTraceLines / 4;
+
+struct Trace {
+    uint8_t potx, poty;       // readings of the traced frame
+    uint8_t edgesX, edgesY;   // comparator transitions along the frame, 1 for a clean ramp
+    const uint8_t *bits;      // the block as sent, valid only during the callback (nullptr from parseLine())
+};
+
+// Comparator output on a line of a trace block, axis 0 = x (C2OUT), 1 = y (C1OUT)
+inline bool traceBit(const uint8_t *bits, int line, int axis)
+{
+    return (bits[line >> 2] >> (7 - 2 * (line & 3) - axis)) & 1;
+}
+
+struct Record {
+    RecordType type;
+    union {
+        Report report;
+        Event event;
+        Matrix matrix;
+        Latency latency;
+        VelocityBurst burst;
+        VelocitySample sample;
+        VelocityStats stats;
+        Soak soak;
+        Profile profile;
+        Settle settle;
+        ButtonPress button;
+        Trace trace;
+    };
+    std::string_view text;  // the line without terminator, valid only during the callback
+    uint64_t end;           // stream offset just past the record's last byte ('\n' or end of block)
+};
+
+// Parse one complete line (without "\n\r"), false when the line is not recognized
+bool parseLine(std::string_view line, Record &out);
+
+class Decoder {
+public:
+    static constexpr size_t kMaxLine = 128;
+
+    // Decode a chunk of the stream, calling onRecord(const Record &) for each record
+    template <class F>
+    void feed(const char *data, size_t size, F &&onRecord);
+
+    void reset() { lineLen_ = 0; eventState_ = EventNone; blockState_ = BlockNone; discard_ = false; }
+
+    uint64_t offset() const { return fed_; }   // bytes fed so far
+    uint64_t records() const { return records_; }
+    uint64_t unknown() const { return unknown_; }
+    uint64_t overflows() const { return overflows_; }
+
+private:
+    enum FrameState : uint8_t { EventNone, EventName, EventSign, EventEnd, EventCr };
+    enum BlockState : uint8_t { BlockNone, BlockCr, BlockData };
+
+    template <class F>
+    void emit(std::string_view line, const char *end, F &onRecord);
+
+    template <class F>
+    void eventByte(const char *p, F &onRecord);
+
+    template <class F>
+    const char *blockBytes(const char *p, const char *end, F &onRecord);
+
+    void append(const char *p, size_t n);
+
+    // stream offset of a position in the chunk being fed
+    uint64_t at(const char *p) const { return fed_ + static_cast<uint64_t>(p - chunk_); }
+
+    const char *chunk_ = nullptr;
+    uint64_t fed_ = 0;          // offset of chunk_
+    char line_[kMaxLine];
+    size_t lineLen_ = 0;
+    bool discard_ = false;      // line overflowed, skip until its end
+    FrameState eventState_ = EventNone;
+    Event event_{};
+    BlockState blockState_ = BlockNone;
+    Trace trace_{};             // header of the block being collected
+    size_t blockLen_ = 0;
+    uint8_t block_[kTraceBytes];
+    uint64_t records_ = 0, unknown_ = 0, overflows_ = 0;
+};
+
+
+// Line ending just before end ('\n')
+template <class F>
+void Decoder::emit(std::string_view line, const char *end, F &onRecord)
+{
+    while (!line.empty() && line.front() == '\r') line.remove_prefix(1);
+    while (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    if (line.empty()) return;
+
+    Record r{};
+    bool ok = parseLine(line, r);
+    if (ok && r.type == RecordType::Trace) {   // record sent once the block is in
+        trace_ = r.trace;
+        blockState_ = BlockCr;
+        blockLen_ = 0;
+        return;
+    }
+    if (!ok) ++unknown_;
+    r.end = at(end + 1);
+    ++records_;
+    onRecord(static_cast<const Record &>(r));
+}
+
+
+template <class F>
+void Decoder::eventByte(const char *p, F &onRecord)
+{
+    char c = *p;
+    switch (eventState_) {
+    case EventName:
+        event_.name = c;
+        eventState_ = EventSign;
+        break;
+    case EventSign:
+        event_.pressed = (c == '+');
+        eventState_ = EventEnd;
+        break;
+    case EventEnd: {     // '\n', frame complete
+        Record r{};
+        r.type = RecordType::Event;
+        r.event = event_;
+        r.text = std::string_view();
+        r.end = at(p + 1);
+        ++records_;
+        onRecord(static_cast<const Record &>(r));
+        eventState_ = EventCr;
+        break;
+    }
+    default:
+        eventState_ = EventNone;
+        break;
+    }
+}
+
+
+// Collect trace block bytes, returns where the block ended in the chunk
+template <class F>
+const char *Decoder::blockBytes(const char *p, const char *end, F &onRecord)
+{
+    if (blockState_ == BlockCr) {   // '\r' ending the Trace line, or an event frame before it
+        if (*p == '!') {
+            eventState_ = EventName;
+            return p + 1;
+        }
+        blockState_ = BlockData;
+        if (*p == '\r') return p + 1;
+    }
+    size_t n = std::min(static_cast<size_t>(end - p), kTraceBytes - blockLen_);
+    std::memcpy(block_ + blockLen_, p, n);
+    blockLen_ += n;
+    if (blockLen_ < static_cast<size_t>(kTraceBytes)) return p + n;
+
+    blockState_ = BlockNone;
+    Record r{};
+    r.type = RecordType::Trace;
+    r.trace = trace_;
+    r.trace.bits = block_;
+    r.trace.edgesX = r.trace.edgesY = 0;
+    for (int l = 1; l < kTraceLines; ++l) {
+        r.trace.edgesX += traceBit(block_, l, 0) != traceBit(block_, l - 1, 0);
+        r.trace.edgesY += traceBit(block_, l, 1) != traceBit(block_, l - 1, 1);
+    }
+    r.text = std::string_view();
+    r.end = at(p + n);
+    ++records_;
+    onRecord(static_cast<const Record &>(r));
+    return p + n;
+}
+
+
+template <class F>
+void Decoder::feed(const char *data, size_t size, F &&onRecord)
+{
+    const char *p = data;
+    const char *end = data + size;
+    chunk_ = data;
+
+    while (p < end) {
+        if (eventState_ != EventNone) {
+            if (eventState_ == EventCr) {   // optional '\r' closing the frame
+                eventState_ = EventNone;
+                if (*p == '\r') ++p;
+                continue;
+            }
+            eventByte(p++, onRecord);
+            continue;
+        }
+
+        if (blockState_ != BlockNone) {
+            p = blockBytes(p, end, onRecord);
+            continue;
+        }
+
+        // next line end or event frame start
+        const char *q = p;
+        while (q < end && *q != '\n' && *q != '!') ++q;
+
+        if (q == end) {              // line continues in the next chunk
+            append(p, q - p);
+            break;
+        }
+
+        if (*q == '!') {             // event frame, possibly inside a line
+            append(p, q - p);
+            eventState_ = EventName;
+            p = q + 1;
+            continue;
+        }
+
+        // *q == '\n'
+        if (discard_) {
+            discard_ = false;
+            lineLen_ = 0;
+        } else if (lineLen_ == 0) {  // whole line inside this chunk, parse in place
+            emit(std::string_view(p, q - p), q, onRecord);
+        } else {
+            append(p, q - p);
+            if (!discard_) emit(std::string_view(line_, lineLen_), q, onRecord);
+            discard_ = false;
+            lineLen_ = 0;
+        }
+        p = q + 1;
+    }
+    fed_ += size;
+}
+
+
+inline void Decoder::append(const char *p, size_t n)
+{
+    if (discard_ || n == 0) return;
+    if (lineLen_ + n > kMaxLine) {
+        discard_ = true;
+        lineLen_ = 0;
+        ++overflows_;
+        return;
+    }
+    std::memcpy(line_ + lineLen_, p, n);
+    lineLen_ += n;
+}
+
+} // namespace a5200
+
+#endif // A5200_DECODER_H
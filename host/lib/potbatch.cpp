@@ -0,0 +1,38 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   Vectorizable batch form of the pot input model, see potmodel.h.
+   Built with -O3 -ffast-math (see makefile) so logf() maps to the vector math library.
+*/
+
+#include "potmodel.h"
+
+#include <cmath>
+
+namespace a5200 {
+
+void potReadings(const PotModel &m, const float *__restrict source, const float *__restrict r,
+                 const float *__restrict vih, const float *__restrict capScale, uint8_t *__restrict out,
+                 size_t n)
+{
+    const float cap = static_cast<float>(m.timingCap + m.inputCap);
+    const float seriesTau = static_cast<float>(m.seriesR * m.inputCap);
+    const float invLine = static_cast<float>(1.0 / m.linePeriod);
+    const float offset = static_cast<float>(m.sampleOffset);
+    const float last = static_cast<float>(m.lines - 1);
+
+    for (size_t i = 0; i < n; ++i) {
+        float s = source[i];
+        float v = vih[i];
+        float tau = r[i] * cap * capScale[i] + seriesTau * capScale[i];
+        float ratio = s / (s - v);                        // > 1 only when ViH is reached
+        float t = tau * logf(ratio > 1.0f ? ratio : 1.0f);
+        float h = ceilf((t - offset) * invLine) - 1.0f;
+        h = h < 0.0f ? 0.0f : h;
+        h = h > last ? last : h;
+        h = s > v ? h : last;                             // never charges up to ViH
+        out[i] = static_cast<uint8_t>(h);
+    }
+}
+
+} // namespace a5200
@@ -0,0 +1,48 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   POKEY pot input model, see potmodel.h
+*/
+
+#include "potmodel.h"
+
+#include <cmath>
+
+namespace a5200 {
+
+double PotModel::crossingTime(double source, double r) const
+{
+    if (source <= vih || r < 0) return -1;
+    return tau(r) * std::log(source / (source - vih));
+}
+
+
+int PotModel::reading(double source, double r) const
+{
+    double t = crossingTime(source, r);
+    if (t < 0) return lines - 1;
+    // samples at h * linePeriod + sampleOffset, h = 0..lines-1; last one below ViH
+    double h = std::ceil((t - sampleOffset) / linePeriod) - 1;
+    if (h < 0) return 0;
+    if (h > lines - 1) return lines - 1;
+    return static_cast<int>(h);
+}
+
+
+double PotModel::joystickResistance(double reading, double cav) const
+{
+    if (cav <= vih) return -1;
+    double t = (reading + 0.5) * linePeriod + sampleOffset;
+    double tauNeeded = t / std::log(cav / (cav - vih));
+    return (tauNeeded - seriesR * inputCap) / (timingCap + inputCap);
+}
+
+
+double PotModel::trackballVolts(double reading, double outputR) const
+{
+    double t = (reading + 0.5) * linePeriod + sampleOffset;
+    double k = std::exp(-t / tau(outputR));  // V(t) = Vs (1 - k) = ViH
+    return vih / (1 - k);
+}
+
+} // namespace a5200
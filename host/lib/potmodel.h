@@ -0,0 +1,71 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   RC charge time model of the POKEY pot inputs, as measured by the 
+   emulator's measurePotentimeters().
+
+   The source (CAV through the joystick pot, or the trackball output voltage
+   through its output resistance) charges the 47nF timing capacitor; the 
+   comparator sees it through the 1k8 series resistor and the 1nF input 
+   capacitor. That second pole is only 1,8us, so it is folded into a single
+   time constant:
+
+       tau = R * (47nF + 1nF) + 1k8 * 1nF
+       V(t) = Vs * (1 - exp(-t / tau))
+
+   The firmware starts with the capacitors discharged and keeps the last line
+   whose sample was still below ViH, so the reading is the number of whole 
+   lines before the crossing minus one, and 227 when ViH is never reached.
+   An input already above ViH at the first sample updates nothing and the 
+   firmware repeats the previous frame's reading; the model, which has no 
+   previous frame, gives 0 for it. That is what the firmware reports when 
+   the input gets there gradually (the frames before read 0), not after a 
+   jump from elsewhere within one frame.
+*/
+
+#ifndef A5200_POTMODEL_H
+#define A5200_POTMODEL_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace a5200 {
+
+struct PotModel {
+    double vih = 2.29;            // comparator threshold, VRCON VR=11
+    double timingCap = 47e-9;
+    double inputCap = 1e-9;
+    double seriesR = 1800;
+    double linePeriod = 64e-6;
+    double sampleOffset = 8e-6;   // comparator sample inside each line
+    int lines = 228;
+
+    double tau(double r) const { return r * (timingCap + inputCap) + seriesR * inputCap; }
+
+    // Seconds until the input reaches ViH, negative when it never does
+    double crossingTime(double source, double r) const;
+
+    // measurePotentimeters() line count, 0..227 (0 also for a crossing before the first sample)
+    int reading(double source, double r) const;
+
+    int joystick(double potR, double cav) const { return reading(cav, potR); }
+    int trackball(double volts, double outputR) const { return reading(volts, outputR); }
+
+    // Pot resistance giving a reading (centre of its line), the inverse of joystick()
+    double joystickResistance(double reading, double cav) const;
+
+    // Trackball source voltage giving a reading, the inverse of trackball()
+    double trackballVolts(double reading, double outputR) const;
+};
+
+/*
+   Batch form for Monte Carlo runs: out[i] = reading of source[i] through r[i], 
+   with threshold vih[i] and the capacitors scaled by capScale[i]. Arrays of 
+   floats and no branches in the loop, so the compiler vectorizes it.
+*/
+void potReadings(const PotModel &m, const float *source, const float *r, const float *vih,
+                 const float *capScale, uint8_t *out, size_t n);
+
+} // namespace a5200
+
+#endif // A5200_POTMODEL_H
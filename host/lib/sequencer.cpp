@@ -0,0 +1,266 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   Production test sequencer, see sequencer.h
+*/
+
+#include "sequencer.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace a5200 {
+
+namespace {
+
+constexpr int kSteadyReports = 3;   // detect, release and center need this many reports in a row
+
+bool parseKeys(const std::string &s, uint16_t &keys)
+{
+    keys = 0;
+    for (char c : s) {
+        int bit = keyBit(c);
+        if (bit < 0 || bit == 15) return false;
+        keys |= 1u << bit;
+    }
+    return !s.empty();
+}
+
+std::string keyList(uint16_t keys)
+{
+    std::string s;
+    for (int i = 0; i < 16; ++i)
+        if (keys & (1u << i)) s += kKeyNames[i];
+    return s;
+}
+
+} // namespace
+
+const char *stepName(StepKind kind)
+{
+    switch (kind) {
+    case StepKind::Detect: return "detect";
+    case StepKind::Release: return "release";
+    case StepKind::Keys: return "keys";
+    case StepKind::Buttons: return "buttons";
+    case StepKind::Sweep: return "sweep";
+    case StepKind::Center: return "center";
+    }
+    return "?";
+}
+
+bool TestScript::load(const std::string &path)
+{
+    std::ifstream in(path);
+    if (!in) {
+        error = path + ": cannot open";
+        return false;
+    }
+    std::stringstream text;
+    text << in.rdbuf();
+    if (!parse(text.str())) {
+        error = path + ":" + error;
+        return false;
+    }
+    return true;
+}
+
+bool TestScript::parse(const std::string &text)
+{
+    std::istringstream lines(text);
+    std::string line;
+    int number = 0;
+    steps.clear();
+
+    while (std::getline(lines, line)) {
+        ++number;
+        std::istringstream in(line);
+        std::string verb;
+        if (!(in >> verb) || verb[0] == '#') continue;   // '#' is also a key, comments are whole lines
+        if (verb == "model") {
+            in >> model;
+            continue;
+        }
+
+        TestStep s{};
+        std::string arg;
+        int low = 0, high = 0;
+        bool ok = true;
+        if (verb == "detect") {
+            s.kind = StepKind::Detect;
+            ok = static_cast<bool>(in >> arg) && (arg == "joystick" || arg == "trackball");
+            s.controller = arg == "trackball" ? Controller::Trackball : Controller::Joystick;
+        } else if (verb == "release") {
+            s.kind = StepKind::Release;
+        } else if (verb == "keys") {
+            s.kind = StepKind::Keys;
+            ok = static_cast<bool>(in >> arg) && parseKeys(arg, s.keys);
+        } else if (verb == "buttons") {
+            s.kind = StepKind::Buttons;
+            ok = static_cast<bool>(in >> arg) && arg.find_first_not_of("TB") == std::string::npos;
+            s.top = arg.find('T') != std::string::npos;
+            s.bottom = arg.find('B') != std::string::npos;
+        } else if (verb == "sweep") {
+            s.kind = StepKind::Sweep;
+            ok = static_cast<bool>(in >> arg >> low >> high) && arg.find_first_not_of("xy") == std::string::npos;
+            s.x = arg.find('x') != std::string::npos;
+            s.y = arg.find('y') != std::string::npos;
+        } else if (verb == "center") {
+            s.kind = StepKind::Center;
+            ok = static_cast<bool>(in >> low >> high);
+        } else {
+            ok = false;
+        }
+        ok = ok && (in >> s.timeout) && s.timeout > 0 && low >= 0 && high <= 255 && low <= high;
+        if (!ok) {
+            error = std::to_string(number) + ": bad step '" + line + "'";
+            return false;
+        }
+        s.low = static_cast<uint8_t>(low);
+        s.high = static_cast<uint8_t>(high);
+        std::getline(in >> std::ws, s.prompt);
+        steps.push_back(s);
+    }
+    if (steps.empty()) {
+        error = " no steps";
+        return false;
+    }
+    return true;
+}
+
+
+void Sequencer::startUnit(double t)
+{
+    unit_ = UnitResult{++units_, t, 0, true, {}};
+    state_ = State::Running;
+    step_ = 0;
+    startStep(t);
+}
+
+void Sequencer::startStep(double t)
+{
+    stepStart_ = t;
+    keysSeen_ = 0;
+    topSeen_ = bottomSeen_ = false;
+    minX_ = minY_ = 255;
+    maxX_ = maxY_ = 0;
+    inRow_ = 0;
+    lastController_ = Controller::Unknown;
+    if (onPrompt) onPrompt(unit_.unit, script_.steps[step_]);
+}
+
+void Sequencer::finishStep(double t, bool pass, std::string detail)
+{
+    StepResult r{pass, t - stepStart_, std::move(detail)};
+    if (onStep) onStep(unit_.unit, script_.steps[step_], r);
+    unit_.steps.push_back(std::move(r));
+    unit_.pass = unit_.pass && pass;
+
+    if (pass && ++step_ < script_.steps.size()) {
+        startStep(t);
+        return;
+    }
+    // a failed step ends the unit, the rest cannot be trusted
+    unit_.seconds = t - unit_.start;
+    if (unit_.pass) ++passed_;
+    state_ = State::Done;
+    if (onUnit) onUnit(unit_);
+}
+
+std::string Sequencer::missing() const
+{
+    const TestStep &s = script_.steps[step_];
+    char buf[64];
+    switch (s.kind) {
+    case StepKind::Detect:
+        return lastController_ == Controller::Trackball ? "seen as trackball"
+             : lastController_ == Controller::Joystick ? "seen as joystick" : "no report";
+    case StepKind::Release:
+        return "key or button held";
+    case StepKind::Keys:
+        return "missing " + keyList(s.keys & ~keysSeen_);
+    case StepKind::Buttons:
+        return std::string("missing") + (s.top && !topSeen_ ? " T" : "") + (s.bottom && !bottomSeen_ ? " B" : "");
+    case StepKind::Sweep:
+    case StepKind::Center:
+        if (maxX_ < minX_) return "no report";
+        std::snprintf(buf, sizeof buf, "X %u..%u Y %u..%u", minX_, maxX_, minY_, maxY_);
+        return buf;
+    }
+    return "";
+}
+
+// Update the running step, true when it is done
+bool Sequencer::progress(const Record &r)
+{
+    const TestStep &s = script_.steps[step_];
+
+    if (r.type == RecordType::Event && r.event.pressed) {
+        if (r.event.name == 'T') topSeen_ = true;
+        else if (r.event.name == 'B') bottomSeen_ = true;
+        else if (keyBit(r.event.name) >= 0) keysSeen_ |= 1u << keyBit(r.event.name);
+    }
+    if (r.type == RecordType::Report) {
+        const Report &p = r.report;
+        keysSeen_ |= p.keys;
+        topSeen_ = topSeen_ || p.top;
+        bottomSeen_ = bottomSeen_ || p.bottom;
+        if (p.potx < minX_) minX_ = p.potx;
+        if (p.potx > maxX_) maxX_ = p.potx;
+        if (p.poty < minY_) minY_ = p.poty;
+        if (p.poty > maxY_) maxY_ = p.poty;
+        lastController_ = p.controller;
+
+        bool steady = false;
+        if (s.kind == StepKind::Detect) steady = p.controller == s.controller;
+        else if (s.kind == StepKind::Release) steady = !p.keys && !p.top && !p.bottom;
+        else if (s.kind == StepKind::Center)
+            steady = p.potx >= s.low && p.potx <= s.high && p.poty >= s.low && p.poty <= s.high;
+        inRow_ = steady ? inRow_ + 1 : 0;
+    }
+
+    switch (s.kind) {
+    case StepKind::Detect:
+    case StepKind::Release:
+    case StepKind::Center:
+        return inRow_ >= kSteadyReports;
+    case StepKind::Keys:
+        return (keysSeen_ & s.keys) == s.keys;
+    case StepKind::Buttons:
+        return (topSeen_ || !s.top) && (bottomSeen_ || !s.bottom);
+    case StepKind::Sweep:
+        return (!s.x || (minX_ < s.low && maxX_ > s.high)) && (!s.y || (minY_ < s.low && maxY_ > s.high));
+    }
+    return false;
+}
+
+void Sequencer::record(double t, const Record &r)
+{
+    if (r.type == RecordType::Report) {
+        bool empty = r.report.potx > kUnplugged && r.report.poty > kUnplugged;
+        plugged_ = empty ? 0 : plugged_ + 1;
+        unplugged_ = empty ? unplugged_ + 1 : 0;
+    }
+
+    switch (state_) {
+    case State::Empty:
+        if (plugged_ >= kPlugReports) startUnit(t);
+        break;
+    case State::Running:
+        if (unplugged_ >= kPlugReports) finishStep(t, false, "unplugged");
+        else if (progress(r)) finishStep(t, true, "");
+        break;
+    case State::Done:
+        if (unplugged_ >= kPlugReports) state_ = State::Empty;
+        break;
+    }
+}
+
+void Sequencer::tick(double t)
+{
+    if (state_ == State::Running && t - stepStart_ > script_.steps[step_].timeout)
+        finishStep(t, false, "timeout, " + missing());
+}
+
+} // namespace a5200
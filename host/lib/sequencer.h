@@ -0,0 +1,124 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   Production test sequencer.
+
+   A test script lists the steps an operator goes through for one controller
+   model. The sequencer follows the decoded records of one station: a unit 
+   starts when a controller is plugged in, each step passes as soon as the
+   records show it done or fails at its timeout, and the unit ends after the
+   last step. The next unit starts once this one is unplugged.
+
+   Script, one step per line, lines starting with '#' are comments:
+
+     model CX52                                      name in the reports
+     detect   joystick|trackball   TIMEOUT PROMPT    detected as that controller
+     release                       TIMEOUT PROMPT    no key or button held
+     keys     KEYS                 TIMEOUT PROMPT    each key seen pressed, 0-9 * # S P R
+     buttons  T|B|TB               TIMEOUT PROMPT    each fire button seen pressed
+     sweep    x|y|xy LOW HIGH      TIMEOUT PROMPT    axis seen below LOW and above HIGH
+     center   LOW HIGH             TIMEOUT PROMPT    both axes back within LOW..HIGH
+
+   TIMEOUT is in seconds from the start of the step; PROMPT is the rest of the
+   line, shown to the operator when the step starts.
+
+   Nothing plugged in reads 227 on both axes (the timing caps never charge), 
+   so a station counts as empty after kPlugReports reports above 220 on both.
+*/
+
+#ifndef A5200_SEQUENCER_H
+#define A5200_SEQUENCER_H
+
+#include "decoder.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace a5200 {
+
+constexpr int kPlugReports = 3;      // reports in a row to see a unit plugged or unplugged
+constexpr uint8_t kUnplugged = 220;
+
+enum class StepKind : uint8_t { Detect, Release, Keys, Buttons, Sweep, Center };
+
+struct TestStep {
+    StepKind kind;
+    Controller controller = Controller::Unknown;   // detect
+    uint16_t keys = 0;                             // keys
+    bool top = false, bottom = false;              // buttons
+    bool x = false, y = false;                     // sweep
+    uint8_t low = 0, high = 0;                     // sweep, center
+    double timeout = 0;
+    std::string prompt;
+};
+
+const char *stepName(StepKind kind);
+
+struct TestScript {
+    std::string model;
+    std::vector<TestStep> steps;
+
+    bool load(const std::string &path);    // false with error set
+    bool parse(const std::string &text);
+    std::string error;
+};
+
+struct StepResult {
+    bool pass;
+    double seconds;
+    std::string detail;   // what was missing on a failure
+};
+
+struct UnitResult {
+    int unit;
+    double start, seconds;
+    bool pass;
+    std::vector<StepResult> steps;
+};
+
+class Sequencer {
+public:
+    explicit Sequencer(const TestScript &script) : script_(script) {}
+
+    // Feed every decoded record of the station, with the time it arrived
+    void record(double t, const Record &r);
+
+    // Fail the running step when its timeout has passed; call at least a few times per second
+    void tick(double t);
+
+    std::function<void(int unit, const TestStep &)> onPrompt;
+    std::function<void(int unit, const TestStep &, const StepResult &)> onStep;
+    std::function<void(const UnitResult &)> onUnit;
+
+    enum class State : uint8_t { Empty, Running, Done };
+    State state() const { return state_; }
+    int units() const { return units_; }
+    int passed() const { return passed_; }
+
+private:
+    void startUnit(double t);
+    void startStep(double t);
+    void finishStep(double t, bool pass, std::string detail);
+    bool progress(const Record &r);
+    std::string missing() const;
+
+    const TestScript &script_;
+    State state_ = State::Empty;
+    int plugged_ = 0, unplugged_ = 0;   // reports in a row
+    int units_ = 0, passed_ = 0;
+    UnitResult unit_{};
+    size_t step_ = 0;
+    double stepStart_ = 0;
+
+    // progress of the running step
+    uint16_t keysSeen_ = 0;
+    bool topSeen_ = false, bottomSeen_ = false;
+    uint8_t minX_ = 255, maxX_ = 0, minY_ = 255, maxY_ = 0;
+    int inRow_ = 0;
+    Controller lastController_ = Controller::Unknown;
+};
+
+} // namespace a5200
+
+#endif // A5200_SEQUENCER_H
@@ -0,0 +1,56 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   Serial port setup, see serial.h
+*/
+
+#include "serial.h"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/serial.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace a5200 {
+
+int openSerial(const char *path)
+{
+    int fd = ::open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) return -1;
+
+    termios tio;
+    if (tcgetattr(fd, &tio) < 0) {
+        int e = errno;
+        ::close(fd);
+        errno = e;
+        return -1;
+    }
+    cfmakeraw(&tio);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tio.c_cflag &= ~(CSTOPB | PARENB | CRTSCTS);
+    tio.c_cc[VMIN] = 1;
+    tio.c_cc[VTIME] = 0;
+    cfsetispeed(&tio, B9600);
+    cfsetospeed(&tio, B9600);
+    // pseudo terminals ignore the speed, real adapters must accept it
+    if (tcsetattr(fd, TCSANOW, &tio) < 0) {
+        int e = errno;
+        ::close(fd);
+        errno = e;
+        return -1;
+    }
+    tcflush(fd, TCIFLUSH);
+    return fd;
+}
+
+bool setLowLatency(int fd)
+{
+    serial_struct ss;
+    if (ioctl(fd, TIOCGSERIAL, &ss) < 0) return false;
+    ss.flags |= ASYNC_LOW_LATENCY;
+    return ioctl(fd, TIOCSSERIAL, &ss) == 0;
+}
+
+} // namespace a5200
@@ -0,0 +1,25 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   Serial port setup for the emulator link, 9600 8-N-1, raw.
+*/
+
+#ifndef A5200_SERIAL_H
+#define A5200_SERIAL_H
+
+namespace a5200 {
+
+constexpr int kBaudRate = 9600;
+constexpr double kByteSeconds = 10.0 / kBaudRate;   // start + 8 data + stop bits
+
+// Open a tty in raw mode, non blocking. Returns the descriptor or -1 with errno set.
+int openSerial(const char *path);
+
+// Ask the driver to pass received bytes on at once (ASYNC_LOW_LATENCY; USB 
+// adapters drop their latency timer from ~16ms to 1ms). False when the 
+// device does not support it, e.g. a pseudo terminal.
+bool setLowLatency(int fd);
+
+} // namespace a5200
+
+#endif // A5200_SERIAL_H
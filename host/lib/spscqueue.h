@@ -0,0 +1,63 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   Lock-free single producer / single consumer ring buffer.
+   push() is called only by the producer thread and pop() only by the consumer.
+*/
+
+#ifndef A5200_SPSCQUEUE_H
+#define A5200_SPSCQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+namespace a5200 {
+
+template <class T, size_t Capacity>
+class SpscQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    // false when full, the item is not queued
+    bool push(const T &item)
+    {
+        size_t head = head_.load(std::memory_order_relaxed);
+        if (head - tailCache_ == Capacity) {
+            tailCache_ = tail_.load(std::memory_order_acquire);
+            if (head - tailCache_ == Capacity) return false;
+        }
+        items_[head & (Capacity - 1)] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // false when empty
+    bool pop(T &item)
+    {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == headCache_) {
+            headCache_ = head_.load(std::memory_order_acquire);
+            if (tail == headCache_) return false;
+        }
+        item = items_[tail & (Capacity - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const
+    {
+        return tail_.load(std::memory_order_acquire) == head_.load(std::memory_order_acquire);
+    }
+
+private:
+    // producer and consumer indexes on their own cache lines
+    alignas(64) std::atomic<size_t> head_{0};
+    size_t tailCache_ = 0;
+    alignas(64) std::atomic<size_t> tail_{0};
+    size_t headCache_ = 0;
+    alignas(64) T items_[Capacity];
+};
+
+} // namespace a5200
+
+#endif // A5200_SPSCQUEUE_H
@@ -0,0 +1,67 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   Firmware output formatting, see synthetic.h
+*/
+
+#include "synthetic.h"
+
+namespace a5200 {
+
+namespace {
+
+void appendNumber(std::string &s, unsigned n)
+{
+    s += static_cast<char>('0' + n / 100 % 10);
+    s += static_cast<char>('0' + n / 10 % 10);
+    s += static_cast<char>('0' + n % 10);
+}
+
+} // namespace
+
+
+void appendReport(std::string &s, const Report &r)
+{
+    // key order of printResults()
+    static const char order[] = "#3690258*147SPR";
+
+    s += (r.controller == Controller::Trackball) ? "[TrackBall]" : "[Joystick]";
+    s += r.linear ? "PosX:" : "PotX:";
+    appendNumber(s, r.potx);
+    s += r.linear ? " PosY:" : " PotY:";
+    appendNumber(s, r.poty);
+    s += " Top:";
+    s += r.top ? '1' : '0';
+    s += " Bot:";
+    s += r.bottom ? '1' : '0';
+    s += " Keys:";
+    for (int i = 0; i < 15; ++i)
+        if (r.keys & (1u << keyBit(order[i]))) s += order[i];
+    s += "\n\r";
+}
+
+
+void appendEvent(std::string &s, const Event &e)
+{
+    s += '!';
+    s += e.name;
+    s += e.pressed ? '+' : '-';
+    s += "\n\r";
+}
+
+
+Report randomReport(std::mt19937 &rng)
+{
+    Report r{};
+    r.controller = (rng() & 1) ? Controller::Trackball : Controller::Joystick;
+    r.potx = static_cast<uint8_t>(rng() % 228);
+    r.poty = static_cast<uint8_t>(rng() % 228);
+    r.top = (rng() & 31) == 0;
+    r.bottom = (rng() & 31) == 0;
+    r.keys = 0;
+    for (int i = 0; i < 15; ++i)
+        if ((rng() & 31) == 0) r.keys |= 1u << i;
+    return r;
+}
+
+} // namespace a5200
@@ -0,0 +1,29 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   Formats records with the same bytes the firmware sends, for benchmarks
+   and self tests that run without the hardware.
+*/
+
+#ifndef A5200_SYNTHETIC_H
+#define A5200_SYNTHETIC_H
+
+#include "decoder.h"
+
+#include <random>
+#include <string>
+
+namespace a5200 {
+
+// As printResults(), including the "\n\r" sent by _puts()
+void appendReport(std::string &s, const Report &r);
+
+// As sendEvent()
+void appendEvent(std::string &s, const Event &e);
+
+// Random report: pots anywhere in 0..227, each button and key down ~3% of the time
+Report randomReport(std::mt19937 &rng);
+
+} // namespace a5200
+
+#endif // A5200_SYNTHETIC_H
@@ -0,0 +1,167 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   Binary trace files, see trace.h
+*/
+
+#include "trace.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace a5200 {
+
+namespace {
+
+const char kMagic[8] = { 'A','5','2','T','R','A','C','E' };
+
+TraceHeader makeHeader(uint64_t count)
+{
+    TraceHeader h{};
+    std::memcpy(h.magic, kMagic, sizeof kMagic);
+    h.version = kTraceVersion;
+    h.recordSize = sizeof(TraceRecord);
+    h.recordCount = count;
+    h.indexOffset = sizeof(TraceHeader) + count * sizeof(TraceRecord);
+    h.blockRecords = kTraceBlockRecords;
+    return h;
+}
+
+} // namespace
+
+
+TraceRecord toTraceRecord(const Report &r, uint64_t timeUs)
+{
+    TraceRecord t{};
+    t.timeUs = timeUs;
+    t.controller = static_cast<uint8_t>(r.controller);
+    t.potx = r.potx;
+    t.poty = r.poty;
+    t.buttons = (r.top ? kTraceTop : 0) | (r.bottom ? kTraceBottom : 0);
+    t.keys = r.keys;
+    t.flags = r.linear ? kTraceLinear : 0;
+    return t;
+}
+
+
+bool TraceWriter::open(const std::string &path)
+{
+    close();
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) return false;
+    std::setvbuf(file_, nullptr, _IOFBF, 1 << 20);
+    count_ = 0;
+    blocks_.clear();
+    TraceHeader h = makeHeader(0);   // rewritten by close()
+    return std::fwrite(&h, sizeof h, 1, file_) == 1;
+}
+
+
+bool TraceWriter::append(const TraceRecord &r)
+{
+    if (count_ % kTraceBlockRecords == 0) {
+        TraceBlock b{};
+        b.firstTimeUs = r.timeUs;
+        b.minPotx = b.minPoty = 255;
+        blocks_.push_back(b);
+    }
+    TraceBlock &b = blocks_.back();
+    b.minPotx = std::min(b.minPotx, r.potx);
+    b.maxPotx = std::max(b.maxPotx, r.potx);
+    b.minPoty = std::min(b.minPoty, r.poty);
+    b.maxPoty = std::max(b.maxPoty, r.poty);
+    b.keys |= r.keys;
+    b.buttons |= r.buttons;
+    b.controllers |= 1u << (r.controller & 7);
+
+    ++count_;
+    return std::fwrite(&r, sizeof r, 1, file_) == 1;
+}
+
+
+bool TraceWriter::close()
+{
+    if (!file_) return true;
+    bool ok = std::fwrite(blocks_.data(), sizeof(TraceBlock), blocks_.size(), file_) == blocks_.size();
+    TraceHeader h = makeHeader(count_);
+    ok = ok && std::fseek(file_, 0, SEEK_SET) == 0 && std::fwrite(&h, sizeof h, 1, file_) == 1;
+    ok = (std::fclose(file_) == 0) && ok;
+    file_ = nullptr;
+    return ok;
+}
+
+
+bool TraceReader::open(const std::string &path)
+{
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error_ = path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(TraceHeader)) {
+        ::close(fd);
+        error_ = path + ": not a trace file";
+        return false;
+    }
+    size_ = st.st_size;
+    map_ = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map_ == MAP_FAILED) {
+        map_ = nullptr;
+        error_ = path + ": " + std::strerror(errno);
+        return false;
+    }
+    madvise(map_, size_, MADV_SEQUENTIAL);
+
+    const TraceHeader *h = static_cast<const TraceHeader *>(map_);
+    uint64_t blocks = (h->recordCount + kTraceBlockRecords - 1) / kTraceBlockRecords;
+    if (std::memcmp(h->magic, kMagic, sizeof kMagic) != 0 || h->version != kTraceVersion ||
+        h->recordSize != sizeof(TraceRecord) || h->blockRecords != kTraceBlockRecords ||
+        h->indexOffset != sizeof(TraceHeader) + h->recordCount * sizeof(TraceRecord) ||
+        h->indexOffset + blocks * sizeof(TraceBlock) > size_) {
+        close();
+        error_ = path + ": not a trace file or truncated";
+        return false;
+    }
+
+    const char *base = static_cast<const char *>(map_);
+    records_ = reinterpret_cast<const TraceRecord *>(base + sizeof(TraceHeader));
+    count_ = h->recordCount;
+    blocks_ = reinterpret_cast<const TraceBlock *>(base + h->indexOffset);
+    blockCount_ = blocks;
+    return true;
+}
+
+
+void TraceReader::close()
+{
+    if (map_) munmap(map_, size_);
+    map_ = nullptr;
+    size_ = 0;
+    records_ = nullptr;
+    blocks_ = nullptr;
+    count_ = blockCount_ = 0;
+}
+
+
+uint64_t TraceReader::lowerBound(uint64_t timeUs) const
+{
+    // block index first, then inside the block
+    const TraceBlock *b = std::upper_bound(blocks_, blocks_ + blockCount_, timeUs,
+                                           [](uint64_t t, const TraceBlock &blk) { return t < blk.firstTimeUs; });
+    uint64_t block = (b == blocks_) ? 0 : (b - blocks_) - 1;
+    const TraceRecord *first = records_ + block * kTraceBlockRecords;
+    const TraceRecord *last = records_ + std::min<uint64_t>(count_, (block + 1) * kTraceBlockRecords);
+    const TraceRecord *r = std::lower_bound(first, last, timeUs,
+                                            [](const TraceRecord &rec, uint64_t t) { return rec.timeUs < t; });
+    return r - records_;
+}
+
+} // namespace a5200
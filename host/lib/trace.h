@@ -0,0 +1,115 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   Binary trace files.
+
+   Layout: TraceHeader, recordCount TraceRecords of 16 bytes, then one
+   TraceBlock per kTraceBlockRecords records. Each block entry holds the time 
+   of its first record and the range of every field inside the block, so a 
+   query can seek by time with a binary search and skip blocks that cannot 
+   match. All fields are little endian.
+*/
+
+#ifndef A5200_TRACE_H
+#define A5200_TRACE_H
+
+#include "decoder.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace a5200 {
+
+constexpr uint32_t kTraceVersion = 2;
+constexpr uint32_t kTraceBlockRecords = 4096;
+
+// TraceRecord::buttons
+constexpr uint8_t kTraceTop = 0x01;
+constexpr uint8_t kTraceBottom = 0x02;
+
+// TraceRecord::flags
+constexpr uint8_t kTraceLinear = 0x01;   // potx/poty are positions (Report::linear)
+
+struct TraceHeader {
+    char magic[8];            // "A52TRACE"
+    uint32_t version;
+    uint32_t recordSize;      // sizeof(TraceRecord)
+    uint64_t recordCount;
+    uint64_t indexOffset;     // first TraceBlock
+    uint32_t blockRecords;
+    uint32_t reserved;
+};
+
+struct TraceRecord {
+    uint64_t timeUs;          // from the start of the capture
+    uint8_t controller;       // Controller
+    uint8_t potx, poty;
+    uint8_t buttons;          // kTraceTop | kTraceBottom
+    uint16_t keys;            // bitmap as Report::keys
+    uint8_t flags;            // kTraceLinear
+    uint8_t reserved;
+};
+
+struct TraceBlock {
+    uint64_t firstTimeUs;
+    uint8_t minPotx, maxPotx, minPoty, maxPoty;
+    uint16_t keys;            // OR of the keys of every record
+    uint8_t buttons;          // OR of the buttons
+    uint8_t controllers;      // bit (1 << Controller) for each controller seen
+};
+
+static_assert(sizeof(TraceHeader) == 40, "trace header layout");
+static_assert(sizeof(TraceRecord) == 16, "trace record layout");
+static_assert(sizeof(TraceBlock) == 16, "trace block layout");
+
+TraceRecord toTraceRecord(const Report &r, uint64_t timeUs);
+
+class TraceWriter {
+public:
+    ~TraceWriter() { close(); }
+
+    bool open(const std::string &path);
+    bool append(const TraceRecord &r);
+    bool close();              // writes the block index and the final header
+
+    uint64_t count() const { return count_; }
+
+private:
+    FILE *file_ = nullptr;
+    uint64_t count_ = 0;
+    std::vector<TraceBlock> blocks_;
+};
+
+// Read only view of a trace through mmap
+class TraceReader {
+public:
+    ~TraceReader() { close(); }
+
+    bool open(const std::string &path);  // false with error() set
+    void close();
+
+    const TraceRecord *records() const { return records_; }
+    uint64_t count() const { return count_; }
+    const TraceBlock *blocks() const { return blocks_; }
+    uint64_t blockCount() const { return blockCount_; }
+
+    // Index of the first record at or after timeUs
+    uint64_t lowerBound(uint64_t timeUs) const;
+
+    const std::string &error() const { return error_; }
+
+private:
+    void *map_ = nullptr;
+    size_t size_ = 0;
+    const TraceRecord *records_ = nullptr;
+    uint64_t count_ = 0;
+    const TraceBlock *blocks_ = nullptr;
+    uint64_t blockCount_ = 0;
+    std::string error_;
+};
+
+} // namespace a5200
+
+#endif // A5200_TRACE_H
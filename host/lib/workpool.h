@@ -0,0 +1,90 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   Work-stealing thread pool for batches of independent tasks of very
+   different sizes (captures of a few KB next to day long burn-in logs).
+
+   Tasks are indexes 0..n-1, dealt round robin to one queue per worker, so
+   tasks given in decreasing size start with the largest ones spread over
+   all workers. A worker takes tasks from the front of its own queue and,
+   once it is empty, steals from the back of the others, where the smallest
+   ones are. Tasks are coarse, so each queue is a plain locked deque.
+*/
+
+#ifndef A5200_WORKPOOL_H
+#define A5200_WORKPOOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace a5200 {
+
+class WorkPool {
+public:
+    explicit WorkPool(unsigned threads) : queues_(threads ? threads : 1) {}
+
+    unsigned threads() const { return static_cast<unsigned>(queues_.size()); }
+    uint64_t steals() const { return steals_; }
+
+    // Call task(index, worker) for every index, returns when all are done
+    template <class F>
+    void run(size_t n, F &&task)
+    {
+        for (size_t i = 0; i < n; ++i) queues_[i % queues_.size()].tasks.push_back(i);
+
+        std::vector<std::thread> workers;
+        for (unsigned w = 1; w < threads(); ++w) workers.emplace_back([this, w, &task] { work(w, task); });
+        work(0, task);
+        for (auto &t : workers) t.join();
+    }
+
+private:
+    struct Queue {
+        std::mutex lock;
+        std::deque<size_t> tasks;
+    };
+
+    bool take(unsigned w, size_t &task)
+    {
+        Queue &q = queues_[w];
+        std::lock_guard<std::mutex> hold(q.lock);
+        if (q.tasks.empty()) return false;
+        task = q.tasks.front();
+        q.tasks.pop_front();
+        return true;
+    }
+
+    bool steal(unsigned w, size_t &task)
+    {
+        for (unsigned k = 1; k < threads(); ++k) {
+            Queue &q = queues_[(w + k) % threads()];
+            std::lock_guard<std::mutex> hold(q.lock);
+            if (q.tasks.empty()) continue;
+            task = q.tasks.back();
+            q.tasks.pop_back();
+            ++steals_;
+            return true;
+        }
+        return false;
+    }
+
+    // No task is ever added while running, so empty queues everywhere means done
+    template <class F>
+    void work(unsigned w, F &task)
+    {
+        size_t i;
+        while (take(w, i) || steal(w, i)) task(i, w);
+    }
+
+    std::vector<Queue> queues_;
+    std::atomic<uint64_t> steals_{0};
+};
+
+} // namespace a5200
+
+#endif // A5200_WORKPOOL_H
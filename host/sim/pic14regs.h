@@ -0,0 +1,199 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   Native build of the firmware: stands in for SDCC's <pic14regs.h> so that
+   firmware/main.c compiles unchanged with the host C compiler. Every special
+   function register the firmware uses is a field of one SimRegs struct 
+   reached through simRegs(), which first brings the inputs (comparators, 
+   keypad columns, buttons, UART, Timer1, EEPROM) up to the simulator's 
+   current virtual time. Registers that are only ever read are functions.
+
+   Virtual time only advances where the firmware marks its timed blocks with
+   simCycles(n), while waiting for the UART and while writing the EEPROM; 
+   everything else runs in zero time.
+*/
+
+#ifndef A5200_SIM_PIC14REGS_H
+#define A5200_SIM_PIC14REGS_H
+
+// system headers first, their declarations use __asm__
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef union {
+    uint8_t reg;
+    struct {
+        unsigned b0:1, b1:1, b2:1, b3:1, b4:1, b5:1, b6:1, b7:1;
+    } bits;
+} SimReg;
+
+typedef struct {
+    SimReg porta, portb, trisa, trisb;
+    SimReg cmcon, vrcon, t1con, txsta, rcsta, pir1, eecon1, option, intcon;
+    uint16_t txreg;       // 0xFFFF until the firmware writes a byte
+    uint8_t spbrg, tmr0, eeadr, eedata, eecon2;
+    uint8_t tmr1l, tmr1h; // count since Timer1 was switched on
+} SimRegs;
+
+SimRegs *simRegs(void);       // registers updated to the current virtual time
+void simCyclesHook(uint32_t n);
+uint8_t simRCREG(void);
+uint8_t simRCIF(void);
+uint8_t simOERR(void);
+uint8_t simTRMT(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+// timed blocks and inline assembly
+#define simCycles(n) simCyclesHook(n)
+#define __asm__(s) ((void)0)
+
+// configuration word
+#define __at
+#define _CONFIG
+#define _INTRC_OSC_NOCLKOUT 0x3FFC
+#define _HS_OSC             0x3FEE
+#define _EXTCLK_OSC         0x3FEF
+#define _WDT_OFF            0x3FFB
+#define _PWRTE_ON           0x3FF7
+#define _MCLRE_OFF          0x3FDF
+#define _BOREN_OFF          0x3FBF
+#define _LVP_OFF            0x3F7F
+#define _CPD_OFF            0x3FFF
+#define _CP_OFF             0x3FFF
+
+// whole registers
+#define PORTA   (simRegs()->porta.reg)
+#define PORTB   (simRegs()->portb.reg)
+#define TRISA   (simRegs()->trisa.reg)
+#define TRISB   (simRegs()->trisb.reg)
+#define CMCON   (simRegs()->cmcon.reg)
+#define VRCON   (simRegs()->vrcon.reg)
+#define T1CON   (simRegs()->t1con.reg)
+#define TXSTA   (simRegs()->txsta.reg)
+#define RCSTA   (simRegs()->rcsta.reg)
+#define PIR1    (simRegs()->pir1.reg)
+#define EECON1  (simRegs()->eecon1.reg)
+#define TXREG   (simRegs()->txreg)
+#define SPBRG   (simRegs()->spbrg)
+#define TMR0    (simRegs()->tmr0)
+#define TMR1L   (simRegs()->tmr1l)
+#define TMR1H   (simRegs()->tmr1h)
+#define EEADR   (simRegs()->eeadr)
+#define EEDATA  (simRegs()->eedata)
+#define EECON2  (simRegs()->eecon2)
+#define RCREG   (simRCREG())
+
+// PORTA / PORTB
+#define RA0 (simRegs()->porta.bits.b0)
+#define RA1 (simRegs()->porta.bits.b1)
+#define RA2 (simRegs()->porta.bits.b2)
+#define RA3 (simRegs()->porta.bits.b3)
+#define RA4 (simRegs()->porta.bits.b4)
+#define RA5 (simRegs()->porta.bits.b5)
+#define RA6 (simRegs()->porta.bits.b6)
+#define RA7 (simRegs()->porta.bits.b7)
+#define RB0 (simRegs()->portb.bits.b0)
+#define RB1 (simRegs()->portb.bits.b1)
+#define RB2 (simRegs()->portb.bits.b2)
+#define RB3 (simRegs()->portb.bits.b3)
+#define RB4 (simRegs()->portb.bits.b4)
+#define RB5 (simRegs()->portb.bits.b5)
+#define RB6 (simRegs()->portb.bits.b6)
+#define RB7 (simRegs()->portb.bits.b7)
+#define _RB0 0x01
+#define _RB1 0x02
+#define _RB2 0x04
+#define _RB3 0x08
+#define _RB4 0x10
+#define _RB5 0x20
+#define _RB6 0x40
+#define _RB7 0x80
+
+// TRISA / TRISB
+#define TRISA0 (simRegs()->trisa.bits.b0)
+#define TRISA1 (simRegs()->trisa.bits.b1)
+#define TRISA2 (simRegs()->trisa.bits.b2)
+#define TRISA3 (simRegs()->trisa.bits.b3)
+#define TRISA4 (simRegs()->trisa.bits.b4)
+#define TRISA5 (simRegs()->trisa.bits.b5)
+#define TRISA6 (simRegs()->trisa.bits.b6)
+#define TRISA7 (simRegs()->trisa.bits.b7)
+#define TRISB0 (simRegs()->trisb.bits.b0)
+#define TRISB1 (simRegs()->trisb.bits.b1)
+#define TRISB2 (simRegs()->trisb.bits.b2)
+#define TRISB3 (simRegs()->trisb.bits.b3)
+#define _TRISB0 0x01
+
+// CMCON
+#define CM0   (simRegs()->cmcon.bits.b0)
+#define CM1   (simRegs()->cmcon.bits.b1)
+#define CM2   (simRegs()->cmcon.bits.b2)
+#define CIS   (simRegs()->cmcon.bits.b3)
+#define C1INV (simRegs()->cmcon.bits.b4)
+#define C2INV (simRegs()->cmcon.bits.b5)
+#define C1OUT (simRegs()->cmcon.bits.b6)
+#define C2OUT (simRegs()->cmcon.bits.b7)
+#define _CM0   0x01
+#define _CM1   0x02
+#define _CM2   0x04
+#define _CIS   0x08
+#define _C1INV 0x10
+#define _C2INV 0x20
+
+// VRCON
+#define VR0  (simRegs()->vrcon.bits.b0)
+#define VR1  (simRegs()->vrcon.bits.b1)
+#define VR2  (simRegs()->vrcon.bits.b2)
+#define VR3  (simRegs()->vrcon.bits.b3)
+#define VRR  (simRegs()->vrcon.bits.b5)
+#define VROE (simRegs()->vrcon.bits.b6)
+#define VREN (simRegs()->vrcon.bits.b7)
+#define _VR0  0x01
+#define _VR1  0x02
+#define _VR2  0x04
+#define _VR3  0x08
+#define _VRR  0x20
+#define _VROE 0x40
+#define _VREN 0x80
+
+// T1CON / PIR1
+#define TMR1ON  (simRegs()->t1con.bits.b0)
+#define T1CKPS0 (simRegs()->t1con.bits.b4)
+#define T1CKPS1 (simRegs()->t1con.bits.b5)
+#define _TMR1ON  0x01
+#define _TMR1CS  0x02
+#define _T1CKPS0 0x10
+#define _T1CKPS1 0x20
+#define TMR1IF (simRegs()->pir1.bits.b0)
+#define TXIF   (simRegs()->pir1.bits.b4)
+#define RCIF   (simRCIF())
+
+// USART
+#define BRGH (simRegs()->txsta.bits.b2)
+#define SYNC (simRegs()->txsta.bits.b4)
+#define TXEN (simRegs()->txsta.bits.b5)
+#define TRMT (simTRMT())
+#define CREN (simRegs()->rcsta.bits.b4)
+#define SPEN (simRegs()->rcsta.bits.b7)
+#define OERR (simOERR())
+
+// EEPROM
+#define RD   (simRegs()->eecon1.bits.b0)
+#define WR   (simRegs()->eecon1.bits.b1)
+#define WREN (simRegs()->eecon1.bits.b2)
+
+// OPTION_REG / INTCON
+#define PSA       (simRegs()->option.bits.b3)
+#define T0CS      (simRegs()->option.bits.b5)
+#define NOT_RBPU  (simRegs()->option.bits.b7)
+#define GIE       (simRegs()->intcon.bits.b7)
+
+#endif // A5200_SIM_PIC14REGS_H
@@ -0,0 +1,214 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   Scripted stimulus, see scenario.h
+*/
+
+#include "scenario.h"
+
+#include "decoder.h"
+#include "serial.h"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <sstream>
+
+namespace a5200 {
+
+bool Scenario::load(const std::string &path)
+{
+    std::ifstream in(path);
+    if (!in) {
+        error_ = path + ": cannot open";
+        return false;
+    }
+    std::stringstream text;
+    text << in.rdbuf();
+    if (!parse(text.str())) {
+        error_ = path + ":" + error_;
+        return false;
+    }
+    return true;
+}
+
+
+bool Scenario::parseKeys(const std::string &s, Action &a)
+{
+    a.keys = 0;
+    a.top = a.bottom = false;
+    for (char c : s) {
+        if (c == 'T') a.top = true;
+        else if (c == 'B') a.bottom = true;
+        else {
+            int bit = keyBit(c);
+            if (bit < 0 || bit == 15) return false;
+            a.keys |= 1u << bit;
+        }
+    }
+    return true;
+}
+
+
+bool Scenario::parse(const std::string &text)
+{
+    std::istringstream lines(text);
+    std::string line;
+    int number = 0;
+    actions_.clear();
+    commands_.clear();
+    end_ = 0;
+
+    while (std::getline(lines, line)) {
+        ++number;
+        size_t first = line.find_first_not_of(" \t");
+        if (first == std::string::npos || line[first] == '#') continue;   // '#' is also a key, comments are whole lines
+        std::istringstream in(line);
+        std::string verb;
+        Action a{};
+        if (!(in >> a.t)) continue;
+        a.t /= 1000.0;
+        if (!(in >> verb)) {
+            error_ = std::to_string(number) + ": missing action";
+            return false;
+        }
+
+        bool ok = true;
+        if (verb == "joystick" || verb == "trackball" || verb == "none") {
+            a.op = Op::Controller;
+            a.kind = verb == "joystick" ? ControllerKind::Joystick
+                   : verb == "trackball" ? ControllerKind::Trackball : ControllerKind::None;
+        } else if (verb == "stick") {
+            a.op = Op::Stick;
+            ok = static_cast<bool>(in >> a.a >> a.b);
+        } else if (verb == "sweep") {
+            a.op = Op::Sweep;
+            ok = static_cast<bool>(in >> a.ms >> a.a >> a.b >> a.c >> a.d);
+        } else if (verb == "spin") {
+            a.op = Op::Spin;
+            ok = static_cast<bool>(in >> a.ms >> a.a >> a.b);
+        } else if (verb == "press" || verb == "release" || verb == "tap") {
+            std::string keys;
+            ok = static_cast<bool>(in >> keys) && parseKeys(keys, a);
+            a.op = verb == "release" ? Op::Release : Op::Press;
+            if (ok && verb == "tap") {
+                ok = static_cast<bool>(in >> a.ms);
+                Action up = a;
+                up.op = Op::Release;
+                up.t += a.ms / 1000.0;
+                actions_.push_back(up);
+            }
+        } else if (verb == "bounce") {
+            std::string keys;
+            int n = 0;
+            ok = static_cast<bool>(in >> keys >> a.ms >> n) && parseKeys(keys, a) && n > 0;
+            a.op = Op::Toggle;
+            for (int i = 1; ok && i < 2 * n; ++i) {
+                Action edge = a;
+                edge.t += a.ms / 1000.0 * i / (2 * n - 1);
+                actions_.push_back(edge);
+            }
+        } else if (verb == "send") {
+            a.op = Op::Send;
+            std::getline(in >> std::ws, a.text);
+            double t = a.t;
+            for (size_t i = 0; i < a.text.size(); ++i) {
+                int c = static_cast<uint8_t>(a.text[i]);
+                if (c == '\\' && a.text.compare(i + 1, 1, "x") == 0) {
+                    std::string hex = a.text.substr(i + 2, 2);
+                    ok = hex.size() == 2 && std::isxdigit(static_cast<uint8_t>(hex[0]))
+                         && std::isxdigit(static_cast<uint8_t>(hex[1]));
+                    if (!ok) break;
+                    c = std::stoi(hex, nullptr, 16);
+                    i += 3;
+                }
+                t += kByteSeconds;              // received at the end of its stop bit
+                commands_.emplace_back(t, static_cast<uint8_t>(c));
+            }
+        } else if (verb == "end") {
+            a.op = Op::End;
+            end_ = a.t;
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            error_ = std::to_string(number) + ": bad action '" + line + "'";
+            return false;
+        }
+        actions_.push_back(a);
+    }
+
+    std::stable_sort(actions_.begin(), actions_.end(), [](const Action &x, const Action &y) { return x.t < y.t; });
+    std::stable_sort(commands_.begin(), commands_.end());
+    if (end_ == 0 && !actions_.empty()) end_ = actions_.back().t + 1.0;
+    next_ = 0;
+    nextCommand_ = 0;
+    return true;
+}
+
+
+void Scenario::inputs(double t, Inputs &in)
+{
+    for (; next_ < actions_.size() && actions_[next_].t <= t; ++next_) {
+        const Action &a = actions_[next_];
+        switch (a.op) {
+        case Op::Controller:
+            in.kind = a.kind;
+            ramp_.active = false;
+            in.x = in.y = a.kind == ControllerKind::Trackball ? 0 : 114;
+            break;
+        case Op::Stick:
+            ramp_.active = false;
+            in.x = a.a;
+            in.y = a.b;
+            break;
+        case Op::Sweep:
+            ramp_ = Ramp{a.t, a.t + a.ms / 1000.0, a.a, a.b, a.c, a.d, true};
+            break;
+        case Op::Spin:
+            ramp_ = Ramp{a.t, a.t + a.ms / 1000.0, a.a, a.b, 0, 0, true};
+            break;
+        case Op::Press:
+            in.keys |= a.keys;
+            in.top = in.top || a.top;
+            in.bottom = in.bottom || a.bottom;
+            break;
+        case Op::Release:
+            in.keys &= ~a.keys;
+            in.top = in.top && !a.top;
+            in.bottom = in.bottom && !a.bottom;
+            break;
+        case Op::Toggle:
+            in.keys ^= a.keys;
+            in.top = in.top != a.top;
+            in.bottom = in.bottom != a.bottom;
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (!ramp_.active) return;
+    if (t >= ramp_.t1) {
+        ramp_.active = false;
+        in.x = ramp_.x1;
+        in.y = ramp_.y1;
+    } else if (in.kind == ControllerKind::Trackball) {   // spin: constant speed
+        in.x = ramp_.x0;
+        in.y = ramp_.y0;
+    } else {
+        double f = (t - ramp_.t0) / (ramp_.t1 - ramp_.t0);
+        in.x = ramp_.x0 + (ramp_.x1 - ramp_.x0) * f;
+        in.y = ramp_.y0 + (ramp_.y1 - ramp_.y0) * f;
+    }
+}
+
+
+int Scenario::command(double t)
+{
+    if (nextCommand_ < commands_.size() && commands_[nextCommand_].first <= t)
+        return commands_[nextCommand_++].second;
+    return -1;
+}
+
+} // namespace a5200
@@ -0,0 +1,79 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   Scripted stimulus for the simulator.
+
+   One action per line, starting with its time in milliseconds:
+
+     0     joystick | trackball | none     plug in a controller (hot-swap at any time)
+     0     stick X Y                       joystick position, as readings
+     500   sweep MS X0 Y0 X1 Y1            move the stick linearly over MS milliseconds
+     0     spin MS VX VY                   trackball speed for MS milliseconds, then at rest
+     1000  press KEYS                      keys 0-9 * # S P R and T/B for the fire buttons
+     1200  release KEYS
+     1500  tap KEYS MS                     press, release MS milliseconds later
+     1500  bounce KEYS MS N                contacts open and close again N times over MS
+                                           milliseconds, ending as they were
+     0     send TEXT                       serial commands to the firmware, at 9600bps,
+                                           \xHH for any byte
+     3000  end                             end of the scenario
+
+   Lines starting with '#' are comments. Actions on the same time apply in file order.
+*/
+
+#ifndef A5200_SCENARIO_H
+#define A5200_SCENARIO_H
+
+#include "simulator.h"
+
+#include <string>
+#include <vector>
+
+namespace a5200 {
+
+class Scenario : public Stimulus {
+public:
+    // Parse a script, false with error() set on a bad line
+    bool load(const std::string &path);
+    bool parse(const std::string &text);
+
+    void inputs(double t, Inputs &in) override;
+    int command(double t) override;
+
+    double duration() const { return end_; }
+    const std::string &error() const { return error_; }
+
+private:
+    enum class Op : uint8_t { Controller, Stick, Sweep, Spin, Press, Release, Toggle, Send, End };
+
+    struct Action {
+        double t;
+        Op op;
+        ControllerKind kind;
+        double ms;
+        double a, b, c, d;
+        uint16_t keys;
+        bool top, bottom;
+        std::string text;
+    };
+
+    struct Ramp {
+        double t0 = 0, t1 = 0;
+        double x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+        bool active = false;
+    };
+
+    bool parseKeys(const std::string &s, Action &a);
+
+    std::vector<Action> actions_;
+    size_t next_ = 0;
+    Ramp ramp_;                  // stick sweep or trackball spin
+    std::vector<std::pair<double, uint8_t>> commands_;
+    size_t nextCommand_ = 0;
+    double end_ = 0;
+    std::string error_;
+};
+
+} // namespace a5200
+
+#endif // A5200_SCENARIO_H
@@ -0,0 +1,366 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   Virtual emulator board, see simulator.h
+*/
+
+#include "simulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <csetjmp>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "pic14regs.h"
+#undef __asm__
+
+extern "C" void firmwareMain(void);
+
+// the firmware's statics, in sections of their own (see makefile)
+extern "C" char __start_firmware_data[], __stop_firmware_data[];
+extern "C" char __start_firmware_bss[], __stop_firmware_bss[];
+
+namespace a5200 {
+
+namespace {
+
+Simulator *sim = nullptr;
+SimRegs regs;
+SimRegs refreshed;       // regs as the last refresh left them
+jmp_buf finished;
+
+// initial values of the firmware's initialized statics, taken before any run
+const std::vector<char> firmwareData(__start_firmware_data, __stop_firmware_data);
+
+constexpr uint64_t kNever = ~0ull;
+constexpr double kNominalCav = 5.0;   // stick positions are readings on this console
+
+} // namespace
+
+
+Simulator::Simulator(const SimConfig &config, Stimulus &stimulus, ByteSink sink)
+    : config_(config), stimulus_(stimulus), sink_(std::move(sink)),
+      vrefSettle_(static_cast<uint64_t>(std::llround(config.vrefSettle * config.cycleHz))),
+      keySettle_(static_cast<uint64_t>(std::llround(config.keySettle * config.cycleHz))),
+      keyRecover_(static_cast<uint64_t>(std::llround(config.keyRecover * config.cycleHz)))
+{
+    if (sim) throw std::logic_error("one Simulator at a time");
+    sim = this;
+    std::memset(eeprom, 0xFF, sizeof eeprom);
+}
+
+
+Simulator::~Simulator() { sim = nullptr; }
+
+
+void Simulator::run(double seconds)
+{
+    // firmware statics as loaded, so every run starts from the same state
+    std::copy(firmwareData.begin(), firmwareData.end(), __start_firmware_data);
+    std::fill(__start_firmware_bss, __stop_firmware_bss, 0);
+
+    // power on reset state
+    std::memset(&regs, 0, sizeof regs);
+    regs.trisa.reg = 0xFF;
+    regs.trisb.reg = 0xFF;
+    regs.txreg = 0xFFFF;
+    vrcon_ = vrconBefore_ = 0;
+    linePins_ = 0xFF;
+    std::fill(std::begin(lineDriven_), std::end(lineDriven_), false);
+    for (Channel &c : channels_) c.released = false;
+    timer1On_ = false;
+    rx_.clear();
+    overrun_ = false;
+    fresh_ = false;
+
+    end_ = cycles_ + static_cast<uint64_t>(seconds * config_.cycleHz);
+    stimulus_.inputs(now(), inputs_);
+    if (setjmp(finished) == 0) firmwareMain();
+}
+
+
+void Simulator::advance(uint64_t n)
+{
+    updateLines();                   // lines and Vref written since the last refresh change now
+    updateVref();
+    cycles_ += n;
+    fresh_ = false;
+    double t = now();
+    stimulus_.inputs(t, inputs_);
+    for (int c; (c = stimulus_.command(t)) >= 0;) {
+        // a byte completed with the 2 byte FIFO full is lost and stops the receiver
+        if (!(regs.rcsta.reg & 0x10) || overrun_) continue;   // CREN off or OERR
+        if (rx_.size() == 2) overrun_ = true;
+        else rx_.push_back(static_cast<uint8_t>(c));
+    }
+    if (cycles_ >= end_) longjmp(finished, 1);
+}
+
+
+// VRCON seen by the comparators, the previous level until the new one settles
+uint8_t Simulator::vrconSettled() const
+{
+    return cycles_ - vrconChangedAt_ >= vrefSettle_ ? vrcon_ : vrconBefore_;
+}
+
+
+double Simulator::vref(uint8_t vrcon) const
+{
+    double vr = vrcon & 0x0F;
+    if (!(vrcon & _VREN)) return 0;
+    if (vrcon & _VRR) return vr / 24.0 * config_.vdd;
+    return config_.vdd / 4.0 + vr / 32.0 * config_.vdd;
+}
+
+
+void Simulator::updateVref()
+{
+    if (regs.vrcon.reg == vrcon_) return;
+    vrconBefore_ = vrcon_;
+    vrcon_ = regs.vrcon.reg;
+    vrconChangedAt_ = cycles_;
+}
+
+
+bool Simulator::cavOn() const
+{
+    return !regs.trisb.bits.b0 && regs.portb.bits.b0;
+}
+
+
+// Source voltage and resistance charging an axis, axis 0 = Y, 1 = X
+double Simulator::source(int axis, double &r) const
+{
+    const PotModel &m = config_.model;
+    double pos = axis ? inputs_.x : inputs_.y;
+
+    switch (inputs_.kind) {
+    case ControllerKind::Joystick:
+        r = m.joystickResistance(std::min(std::max(pos, 0.0), 226.0), kNominalCav);
+        return cav_ ? config_.cav : 0.0;
+
+    case ControllerKind::Trackball: {
+        r = config_.trackballR;
+        bool on = (cycles_ - cavChangedAt_ >= config_.trackballDelay * config_.cycleHz) ? cav_ : cavBefore_;
+        if (!on) return config_.trackballSteady;
+        double steady = m.trackball(config_.trackballSteady, r);
+        double reading = std::min(std::max(steady + pos, 0.0), 226.0);
+        return m.trackballVolts(reading, r);
+    }
+
+    default:
+        r = 0;
+        return 0;
+    }
+}
+
+
+// Comparator output, 1 while the input is below Vref. The crossing is worked
+// out again whenever the reference changes (per-axis ViH switches it twice a line).
+bool Simulator::comparator(Channel &c, int axis, bool released)
+{
+    if (!released) {
+        c.released = false;
+        return true;       // held discharged
+    }
+    if (!c.released) {     // start of a charge
+        c.released = true;
+        c.releasedAt = cycles_;
+        double r;
+        c.vs = source(axis, r);
+        c.tau = config_.model.tau(r);
+        c.vrcon = -1;
+    }
+    uint8_t vrcon = vrconSettled();
+    if (vrcon != c.vrcon) {
+        c.vrcon = vrcon;
+        double v = vref(vrcon);
+        double t = -1;
+        if (c.vs > v) t = c.tau * std::log(c.vs / (c.vs - v));
+        c.crossing = t < 0 ? kNever : static_cast<uint64_t>(t * config_.cycleHz);
+    }
+    return cycles_ - c.releasedAt < c.crossing;
+}
+
+
+// Keypad lines driven low, with the time each one changed
+void Simulator::updateLines()
+{
+    // lines LIN0..3 on RA6, RA4, RA3, RA7 (RA2 with an external clock on RA7)
+#ifdef EXT_CLOCK
+    static const int linePin[4] = { 6, 4, 3, 2 };
+#else
+    static const int linePin[4] = { 6, 4, 3, 7 };
+#endif
+    uint8_t pins = regs.trisa.reg | regs.porta.reg;   // bit clear = pin driven low
+    if (pins == linePins_) return;
+    linePins_ = pins;
+    for (int l = 0; l < 4; ++l) {
+        bool d = !((pins >> linePin[l]) & 1);
+        if (d != lineDriven_[l]) {
+            lineDriven_[l] = d;
+            lineChangedAt_[l] = cycles_;
+        }
+    }
+}
+
+
+// Keypad columns (PORTB<7:4>), low when connected to a driven line through pressed keys.
+// Columns follow a line keySettle after it is driven and keyRecover after it is released.
+uint8_t Simulator::columns() const
+{
+    if (!inputs_.keys) return 0xF0;   // nothing pressed, the common case
+
+    bool driven[4];
+    for (int l = 0; l < 4; ++l) {
+        uint64_t since = cycles_ - lineChangedAt_[l];
+        driven[l] = lineDriven_[l] ? since >= keySettle_ : since < keyRecover_;
+    }
+
+    uint16_t keys = inputs_.keys;
+    uint8_t low = 0;
+    if (!config_.ghosting) {
+        for (int l = 0; l < 4; ++l)
+            if (driven[l]) low |= (keys >> (l * 4)) & 0x0F;
+    } else {
+        // lines reached through closed contacts, until nothing changes
+        bool reached[4] = { driven[0], driven[1], driven[2], driven[3] };
+        for (bool grew = true; grew;) {
+            grew = false;
+            uint8_t cols = 0;
+            for (int l = 0; l < 4; ++l)
+                if (reached[l]) cols |= (keys >> (l * 4)) & 0x0F;
+            for (int l = 0; l < 4; ++l)
+                if (!reached[l] && ((keys >> (l * 4)) & cols)) reached[l] = grew = true;
+            low = cols;
+        }
+    }
+    return static_cast<uint8_t>(~(low << 4)) & 0xF0;
+}
+
+
+// Bring the registers up to the current time. Nothing changes between two 
+// calls at the same time unless the firmware wrote a register in between, 
+// which is most of the calls (every bit access goes through simRegs()).
+inline void Simulator::refresh()
+{
+    if (!fresh_ || std::memcmp(&regs, &refreshed, sizeof regs) != 0) update();
+}
+
+
+void Simulator::update()
+{
+    // UART, the byte starts shifting out as it is written
+    if (regs.txreg != 0xFFFF) {
+        uint8_t byte = static_cast<uint8_t>(regs.txreg);
+        regs.txreg = 0xFFFF;
+        double fosc = config_.cycleHz * 4;
+        double baud = fosc / ((regs.txsta.reg & 0x04 ? 16.0 : 64.0) * (regs.spbrg + 1));
+        uint64_t start = std::max(cycles_, txIdleAt_);
+        txIdleAt_ = start + static_cast<uint64_t>(10.0 / baud * config_.cycleHz);
+        if (sink_) sink_(txIdleAt_ / config_.cycleHz, byte);
+    }
+
+    // UART receiver, clearing CREN clears OERR
+    if (!(regs.rcsta.reg & 0x10)) overrun_ = false;
+
+    // EEPROM
+    if (regs.eecon1.bits.b0) {          // RD
+        regs.eedata = eeprom[regs.eeadr & 0x7F];
+        regs.eecon1.bits.b0 = 0;
+    }
+    if (regs.eecon1.bits.b1) {          // WR
+        regs.eecon1.bits.b1 = 0;
+        if (regs.eecon1.bits.b2) eeprom[regs.eeadr & 0x7F] = regs.eedata;
+        advance(static_cast<uint64_t>(4e-3 * config_.cycleHz));
+    }
+
+    // Timer1, internal clock with prescaler
+    bool on = regs.t1con.bits.b0;
+    int prescale = (regs.t1con.reg >> 4) & 3;
+    if (on && !timer1On_) {
+        timer1Start_ = cycles_;
+        timer1Overflow_ = cycles_ + (65536ull << prescale);
+    }
+    timer1On_ = on;
+    if (on) {
+        uint64_t count = (cycles_ - timer1Start_) >> prescale;
+        regs.tmr1l = static_cast<uint8_t>(count);
+        regs.tmr1h = static_cast<uint8_t>(count >> 8);
+        if (cycles_ >= timer1Overflow_) {
+            uint64_t period = 65536ull << prescale;
+            timer1Overflow_ += (cycles_ - timer1Overflow_) / period * period + period;
+            regs.pir1.bits.b0 = 1;      // TMR1IF
+        }
+    }
+
+    // CAV
+    bool cav = cavOn();
+    if (cav != cav_) {
+        cavBefore_ = cav_;
+        cav_ = cav;
+        cavChangedAt_ = cycles_;
+    }
+
+    // comparators, C1 on RA0 (PotY), C2 on RA1 (PotX)
+    updateVref();
+    regs.cmcon.bits.b6 = comparator(channels_[0], 0, regs.trisa.bits.b0);
+    regs.cmcon.bits.b7 = comparator(channels_[1], 1, regs.trisa.bits.b1);
+
+    // keypad columns and buttons
+    updateLines();
+    regs.portb.reg = (regs.portb.reg & 0x07) | columns() | (inputs_.top ? 0 : 0x08);
+    regs.porta.bits.b5 = !inputs_.bottom;
+    refreshed = regs;
+    fresh_ = true;
+}
+
+
+bool Simulator::transmitterIdle()
+{
+    refresh();
+    return cycles_ >= txIdleAt_;
+}
+
+
+bool Simulator::received()
+{
+    refresh();
+    return !rx_.empty();
+}
+
+
+uint8_t Simulator::receive()
+{
+    refresh();
+    if (rx_.empty()) return 0;
+    uint8_t c = rx_.front();
+    rx_.pop_front();
+    return c;
+}
+
+
+bool Simulator::overrun()
+{
+    refresh();
+    return overrun_;
+}
+
+} // namespace a5200
+
+
+// C hooks used by sim/pic14regs.h
+
+extern "C" SimRegs *simRegs(void)
+{
+    a5200::sim->refresh();
+    return &a5200::regs;
+}
+
+extern "C" void simCyclesHook(uint32_t n) { a5200::sim->advance(n); }
+extern "C" uint8_t simTRMT(void) { return a5200::sim->transmitterIdle(); }
+extern "C" uint8_t simRCIF(void) { return a5200::sim->received(); }
+extern "C" uint8_t simRCREG(void) { return a5200::sim->receive(); }
+extern "C" uint8_t simOERR(void) { return a5200::sim->overrun(); }
@@ -0,0 +1,141 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   Virtual emulator board for the native firmware build.
+
+   firmware/main.c is compiled for the host against sim/pic14regs.h and runs 
+   against this model of the board: the pot inputs follow the RC model of 
+   potmodel.h, the keypad is a diode-less matrix (so ghosting happens as on 
+   a real keypad), the buttons pull RB3/RA5 low, and the UART, Timer1 and 
+   EEPROM behave as on the PIC16F628A (the UART keeps 2 received bytes, one 
+   more sets OERR and is lost, as is everything after it until CREN is 
+   cleared). What the controller and the user do is supplied by a Stimulus, 
+   sampled whenever virtual time advances.
+*/
+
+#ifndef A5200_SIMULATOR_H
+#define A5200_SIMULATOR_H
+
+#include "potmodel.h"
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+// Oscillator of the firmware build, from the generated timing.h (see makefile)
+#ifndef F_OSC
+#define F_OSC 4000000
+#endif
+
+namespace a5200 {
+
+enum class ControllerKind : uint8_t { None, Joystick, Trackball };
+
+struct Inputs {
+    ControllerKind kind = ControllerKind::Joystick;
+    double x = 114, y = 114;     // joystick: stick position, as the reading it gives on a nominal console
+                                 // trackball: speed, as the offset from the steady reading
+    uint16_t keys = 0;           // bitmap as Report::keys
+    bool top = false, bottom = false;
+};
+
+class Stimulus {
+public:
+    virtual ~Stimulus() = default;
+
+    // Update the inputs for virtual time t (seconds), called as time advances
+    virtual void inputs(double t, Inputs &in) = 0;
+
+    // Next serial byte for the firmware that is due by time t, -1 if none
+    virtual int command(double) { return -1; }
+};
+
+struct SimConfig {
+    double cycleHz = F_OSC / 4.0;    // instruction cycles per second, Fosc/4
+    double vdd = 5.0;
+    double cav = 5.0;                // console CAV
+    double trackballR = 100e3;       // trackball output resistance
+    double trackballSteady = 3.0;    // trackball output with CAV off
+    double trackballDelay = 0.5e-3;  // trackball response to a CAV change
+    bool ghosting = true;            // keypad has no diodes
+    double keySettle = 3e-6;         // a driven line pulls pressed columns low after this
+    double keyRecover = 6e-6;        // and keeps them low this long after it is released
+    double vrefSettle = 10e-6;       // Vref follows a VRCON write after this (datasheet maximum)
+    PotModel model;                  // nominal console, maps positions to resistance/voltage
+};
+
+class Simulator {
+public:
+    // Called for every byte the firmware sends, with the time its stop bit ends
+    using ByteSink = std::function<void(double t, uint8_t byte)>;
+
+    Simulator(const SimConfig &config, Stimulus &stimulus, ByteSink sink);
+    ~Simulator();
+
+    // Run the firmware from reset for the given virtual time. The firmware's
+    // statics are put back to their initial values first, so a process can 
+    // run one Simulator after another; a second run() of the same one is a 
+    // power cycle, virtual time and the EEPROM carry on.
+    void run(double seconds);
+
+    // End the run at the next advance of virtual time, from a sink or stimulus
+    void stop() { end_ = cycles_; }
+
+    double now() const { return cycles_ / config_.cycleHz; }
+    uint64_t cycles() const { return cycles_; }
+
+    uint8_t eeprom[128];
+
+    // hooks behind sim/pic14regs.h
+    void refresh();
+    void advance(uint64_t n);
+    bool transmitterIdle();
+    bool received();
+    uint8_t receive();
+    bool overrun();
+
+private:
+    struct Channel {
+        bool released = false;
+        uint64_t releasedAt = 0;
+        double vs = 0, tau = 0;      // source and time constant of the charge
+        int vrcon = -1;              // VRCON the crossing was computed for
+        uint64_t crossing = 0;       // cycles after release to reach its Vref, ~0 = never
+    };
+
+    uint8_t vrconSettled() const;
+    double vref(uint8_t vrcon) const;
+    void updateVref();
+    bool cavOn() const;
+    double source(int axis, double &r) const;
+    bool comparator(Channel &c, int axis, bool released);
+    void updateLines();
+    uint8_t columns() const;
+    void update();
+
+    SimConfig config_;
+    Stimulus &stimulus_;
+    ByteSink sink_;
+    Inputs inputs_;
+    uint64_t cycles_ = 0, end_ = 0;
+    bool fresh_ = false;             // registers refreshed at cycles_, see refresh()
+    uint64_t txIdleAt_ = 0;
+    uint64_t timer1Start_ = 0, timer1Overflow_ = 0;   // when it was switched on, next TMR1IF
+    bool timer1On_ = false;
+    bool cav_ = false, cavBefore_ = false;
+    uint64_t cavChangedAt_ = 0;
+    Channel channels_[2];            // 0 = RA0/C1/PotY, 1 = RA1/C2/PotX
+    uint8_t linePins_ = 0xFF;        // TRISA | PORTA the lines were worked out from
+    bool lineDriven_[4] = {};        // keypad lines LIN0..3 driven low
+    uint64_t lineChangedAt_[4] = {};
+    uint8_t vrcon_ = 0, vrconBefore_ = 0;   // VRCON level and the one it replaced
+    uint64_t vrconChangedAt_ = 0;
+    uint64_t vrefSettle_;                   // config_.vrefSettle in cycles
+    uint64_t keySettle_, keyRecover_;       // config_.keySettle and keyRecover in cycles
+    std::deque<uint8_t> rx_;                // receive FIFO, 2 bytes as on the PIC
+    bool overrun_ = false;                  // OERR
+};
+
+} // namespace a5200
+
+#endif // A5200_SIMULATOR_H
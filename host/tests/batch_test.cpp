@@ -0,0 +1,170 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   batch_test - the work-stealing pool and a5200batch
+
+   The pool must run every task exactly once whatever the thread count, and 
+   idle workers must steal from one held up by slow tasks. a5200batch then 
+   summarizes an archive of synthetic captures, two units of two captures 
+   each, whose counters are known: the CSV must give them, the same for any
+   -j, and the filters and --anomalies must list only the unit they match.
+*/
+
+#include "check.h"
+#include "synthetic.h"
+#include "workpool.h"
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace a5200;
+namespace fs = std::filesystem;
+
+static void testPool()
+{
+    for (unsigned threads : {0u, 1u, 3u, 8u}) {
+        WorkPool pool(threads);
+        CHECK(pool.threads() == (threads ? threads : 1));
+        const size_t n = 1000;
+        std::vector<std::atomic<int>> runs(n);
+        std::atomic<bool> badWorker{false};
+        pool.run(n, [&](size_t i, unsigned w) {
+            ++runs[i];
+            if (w >= pool.threads()) badWorker = true;
+        });
+        bool once = true;
+        for (auto &r : runs) once = once && r == 1;
+        CHECK(once);
+        CHECK(!badWorker);
+    }
+
+    // worker 0's tasks are slow, the others finish theirs and steal
+    WorkPool pool(4);
+    std::atomic<int> done{0};
+    pool.run(64, [&](size_t i, unsigned) {
+        if (i % 4 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        ++done;
+    });
+    CHECK(done == 64);
+    CHECK(pool.steals() > 0);
+}
+
+static std::string readFile(const std::string &path)
+{
+    std::ifstream in(path);
+    std::stringstream s;
+    s << in.rdbuf();
+    return s.str();
+}
+
+// CSV rows by unit, each as its columns by header name
+static std::map<std::string, std::map<std::string, std::string>> parseCsv(const std::string &text)
+{
+    std::map<std::string, std::map<std::string, std::string>> rows;
+    std::istringstream in(text);
+    std::string line, cell;
+    std::vector<std::string> header;
+    while (std::getline(in, line)) {
+        std::vector<std::string> cells;
+        std::istringstream l(line);
+        while (std::getline(l, cell, ',')) cells.push_back(cell);
+        if (!line.empty() && line.back() == ',') cells.push_back("");
+        if (header.empty()) {
+            header = cells;
+            continue;
+        }
+        auto &row = rows[cells[0]];
+        for (size_t i = 0; i < cells.size() && i < header.size(); ++i) row[header[i]] = cells[i];
+    }
+    return rows;
+}
+
+static void testBatch(const char *argv0)
+{
+    fs::path dir = checkTempPath("batch_test");
+    fs::remove_all(dir);
+    fs::create_directories(dir / "unitA");
+    fs::create_directories(dir / "unitB" / "day2");
+
+    // unit A, a good joystick: readings 20..200 on x, 30..129 on y, '5' pressed twice, top once
+    std::string a1, a2;
+    for (int i = 0; i < 100; ++i) {
+        Report r{Controller::Joystick, static_cast<uint8_t>(20 + i * 180 / 99), static_cast<uint8_t>(30 + i % 151),
+                 i == 40, false, static_cast<uint16_t>(i == 10 || i == 60 ? 1u << keyBit('5') : 0), false};
+        appendReport(i < 50 ? a1 : a2, r);
+    }
+    // unit B: a trackball that once reads as a joystick, one saturated reading and a line that does not decode
+    std::string b1, b2;
+    for (int i = 0; i < 60; ++i) {
+        Report r{i == 30 ? Controller::Joystick : Controller::Trackball, 100, static_cast<uint8_t>(i == 20 ? 227 : 210),
+                 false, false, 0, false};
+        appendReport(i < 40 ? b1 : b2, r);
+    }
+    b2 += "garbage\n\r";
+    std::ofstream(dir / "unitA" / "a1.txt") << a1;
+    std::ofstream(dir / "unitA" / "a2.txt") << a2;
+    std::ofstream(dir / "unitB" / "b1.txt") << b1;
+    std::ofstream(dir / "unitB" / "day2" / "b2.txt") << b2;
+
+    // --by-dir takes the directory holding each capture as the unit
+    std::string out = checkTempPath("batch_test.csv");
+    std::string unitA = (dir / "unitA").string(), unitB = (dir / "unitB").string();
+    std::string unitB2 = (dir / "unitB" / "day2").string();
+    auto batch = [&](const std::string &options) {
+        return checkTool(argv0, "a5200batch --csv" + options + " " + unitA + " " + unitB + " 2> /dev/null", out);
+    };
+    if (!CHECK(batch(" -j 1") == 0)) return;
+    std::string serial = readFile(out);
+    auto rows = parseCsv(serial);
+    CHECK(rows.size() == 4);
+    if (CHECK(rows.count(unitA + "/a1.txt") && rows.count(unitB2 + "/b2.txt"))) {
+        auto &r = rows[unitA + "/a1.txt"];
+        CHECK(r["joystick"] == "50" && r["trackball"] == "0");
+        CHECK(r["jx_min"] == "20" && r["key_5"] == "1" && r["top"] == "1");
+        CHECK(rows[unitB2 + "/b2.txt"]["unknown"] == "1");
+    }
+
+    CHECK(batch(" --by-dir -j 4") == 0);
+    rows = parseCsv(readFile(out));
+    CHECK(rows.size() == 3);
+    if (CHECK(rows.count(unitA) && rows.count(unitB))) {
+        auto &a = rows[unitA];
+        CHECK(a["files"] == "2" && a["records"] == "100" && a["joystick"] == "100");
+        CHECK(a["jx_min"] == "20" && a["jx_max"] == "200" && a["jy_min"] == "30" && a["jy_max"] == "129");
+        CHECK(a["key_5"] == "2" && a["top"] == "1" && a["flips"] == "0" && a["saturated"] == "0");
+        auto &b = rows[unitB];
+        CHECK(b["files"] == "1" && b["trackball"] == "39" && b["joystick"] == "1");
+        CHECK(b["flips"] == "2" && b["saturated"] == "1");
+        CHECK(b["tx_min"] == "100" && b["ty_max"] == "227");
+    }
+
+    // the same summaries on any number of threads
+    CHECK(batch(" -j 3") == 0);
+    CHECK(readFile(out) == serial);
+
+    // filters and anomalies, only the trackball unit in both of its directories
+    CHECK(batch(" --by-dir --y 201:255 --trackball") == 0);
+    rows = parseCsv(readFile(out));
+    CHECK(rows.size() == 2 && rows[unitB]["matches"] == "39" && rows[unitB2]["matches"] == "20");
+    CHECK(batch(" --by-dir --anomalies") == 0);
+    rows = parseCsv(readFile(out));
+    CHECK(rows.size() == 2 && rows.count(unitB) && rows.count(unitB2));
+
+    CHECK(checkTool(argv0, "a5200batch --csv " + (dir / "missing").string() + " 2> /dev/null", out) == 1);
+    fs::remove_all(dir);
+    fs::remove(out);
+}
+
+int main(int, char **argv)
+{
+    testPool();
+    testBatch(argv[0]);
+    return checkResult("batch_test");
+}
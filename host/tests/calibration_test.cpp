@@ -0,0 +1,141 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   calibration_test - linearization table encoding and positions
+
+   The table is checked through its upload bytes and text file, and then
+   uploaded to the simulated board, whose linear reports at a set of stick
+   readings must give the positions CalTable::position() computes.
+*/
+
+#include "calibration.h"
+#include "check.h"
+#include "decoder.h"
+#include "scenario.h"
+#include "simulator.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+using namespace a5200;
+
+static const CalTable kTable = {{
+    {2, 20, 40, 60, 80, 100, 140, 180, 220},
+    {3, 22, 42, 62, 82, 102, 142, 182, 222},
+}};
+
+static void testUpload()
+{
+    std::string s = kTable.upload();
+    CHECK(s.size() == 2 + 2 * kCalPoints);
+    CHECK(s[0] == 'c');
+    uint8_t sum = 0;
+    for (size_t i = 1; i < s.size(); ++i) sum += static_cast<uint8_t>(s[i]);
+    CHECK(sum == 0);
+    for (int a = 0; a < 2; ++a)
+        for (int i = 0; i < kCalPoints; ++i)
+            CHECK(static_cast<uint8_t>(s[1 + a * kCalPoints + i]) == kTable.axis[a][i]);
+}
+
+static void testFile()
+{
+    std::string path = checkTempPath("calibration_test.cal"), error;
+    CHECK(kTable.save(path));
+    CalTable t{};
+    CHECK(t.load(path, error));
+    CHECK(std::memcmp(t.axis, kTable.axis, sizeof t.axis) == 0);
+
+    const char *const bad[] = {
+        "x 2 20 40 60 80 100 140 180 220\n",                                       // y missing
+        "x 2 20 40 60 80 100 140 180 220\ny 3 22 42 62 82 102 142 182\n",          // short line
+        "x 2 20 40 60 80 100 140 180 220\ny 3 22 42 62 62 102 142 182 222\n",      // not increasing
+        "x 2 20 40 60 80 100 140 180 256\ny 3 22 42 62 82 102 142 182 222\n",      // not a reading
+        "z 2 20 40 60 80 100 140 180 220\n",
+    };
+    for (const char *text : bad) {
+        std::ofstream(path) << text;
+        error.clear();
+        CHECK(!t.load(path, error) && !error.empty());
+    }
+    std::remove(path.c_str());
+}
+
+static void testPositions()
+{
+    CHECK(kTable.valid());
+    for (int a = 0; a < 2; ++a) {
+        for (int i = 0; i < kCalPoints - 1; ++i) CHECK(kTable.position(a, kTable.axis[a][i]) == i * kCalStep);
+        CHECK(kTable.position(a, 0) == 0);
+        CHECK(kTable.position(a, kTable.axis[a][kCalPoints - 1]) == 255);
+        CHECK(kTable.position(a, 255) == 255);
+        for (int r = 1; r < 256; ++r)
+            if (!CHECK(kTable.position(a, r) >= kTable.position(a, r - 1))) break;
+    }
+}
+
+// Upload through the serial port of the simulated board as a5200cal does, then hold the stick at readings
+static void testBoard()
+{
+    static const int readings[][2] = {{60, 150}, {2, 3}, {21, 221}, {119, 82}, {227, 227}, {100, 30}};
+
+    std::string text = "0 joystick\n0 stick 114 114\n950 send c\n";
+    std::string bytes = kTable.upload().substr(1);
+    char line[64];
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        std::snprintf(line, sizeof line, "%zu send \\x%02X\n", 1000 + 3 * i, static_cast<uint8_t>(bytes[i]));
+        text += line;
+    }
+    const double hold = 300;   // ms at each reading, the last reports taken
+    double t = 1200;
+    for (const auto &r : readings) {
+        std::snprintf(line, sizeof line, "%.0f stick %d %d\n", t, r[0], r[1]);
+        text += line;
+        t += hold;
+    }
+    std::snprintf(line, sizeof line, "%.0f end\n", t);
+    text += line;
+
+    Scenario scenario;
+    if (!CHECK(scenario.parse(text))) {
+        std::fprintf(stderr, "%s\n", scenario.error().c_str());
+        return;
+    }
+
+    Decoder decoder;
+    std::vector<Report> last(std::size(readings));
+    std::vector<bool> seen(std::size(readings));
+    bool loaded = false;
+    Simulator simulator(SimConfig(), scenario, [&](double now, uint8_t byte) {
+        char c = static_cast<char>(byte);
+        decoder.feed(&c, 1, [&](const Record &r) {
+            if (r.text == "[Cal] Saved, positions on") loaded = true;
+            double ms = now * 1000 - 1200;
+            if (r.type != RecordType::Report || !r.report.linear || ms < 0) return;
+            size_t i = static_cast<size_t>(ms / hold);
+            if (i < last.size() && ms - i * hold > hold / 2) {
+                last[i] = r.report;
+                seen[i] = true;
+            }
+        });
+    });
+    simulator.run(scenario.duration());
+
+    CHECK(loaded);
+    for (size_t i = 0; i < last.size(); ++i) {
+        CHECK(seen[i]);
+        CHECK(last[i].potx == kTable.position(0, static_cast<uint8_t>(readings[i][0])));
+        CHECK(last[i].poty == kTable.position(1, static_cast<uint8_t>(readings[i][1])));
+    }
+}
+
+int main()
+{
+    testUpload();
+    testFile();
+    testPositions();
+    testBoard();
+    return checkResult("calibration_test");
+}
@@ -0,0 +1,63 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   Checks for the unit tests (make test). CHECK() prints the failed
+   expression with its line and returns the result, so a loop over many
+   cases can stop at its first failure; checkResult() ends main() with the
+   count and a non zero status when any check failed. checkTool() runs one
+   of the host tools, built next to the test by make test.
+*/
+
+#ifndef A5200_CHECK_H
+#define A5200_CHECK_H
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace a5200 {
+
+inline int checkCount = 0, checkFailures = 0;
+
+inline bool checkAt(bool ok, const char *expr, const char *file, int line)
+{
+    ++checkCount;
+    if (!ok) {
+        ++checkFailures;
+        std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, expr);
+    }
+    return ok;
+}
+
+inline int checkResult(const char *name)
+{
+    std::printf("%s: %d checks, %d failed\n", name, checkCount, checkFailures);
+    return checkFailures ? 1 : 0;
+}
+
+// Temporary file for a test, removed by the test itself
+inline std::string checkTempPath(const char *name)
+{
+    const char *dir = std::getenv("TMPDIR");
+    return std::string(dir && *dir ? dir : "/tmp") + "/" + std::to_string(getpid()) + "-" + name;
+}
+
+// Run "tool args" from the directory of the test (argv[0]) with its stdout
+// written to out, the tool's exit status or -1 when it did not exit
+inline int checkTool(const char *argv0, const std::string &command, const std::string &out = "/dev/null")
+{
+    std::string dir = argv0;
+    size_t slash = dir.rfind('/');
+    dir = slash == std::string::npos ? "." : dir.substr(0, slash);
+    int status = std::system((dir + "/" + command + " > " + out).c_str());
+    return status != -1 && WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+} // namespace a5200
+
+#define CHECK(expr) a5200::checkAt(static_cast<bool>(expr), #expr, __FILE__, __LINE__)
+
+#endif // A5200_CHECK_H
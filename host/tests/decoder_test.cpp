@@ -0,0 +1,264 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   decoder_test - the stream decoder against the bytes the firmware sends
+
+   A capture with every kind of record is decoded whole and then split in
+   chunks of every size, byte by byte and at random points, which must all
+   give the same records. Event frames are inserted at each position inside
+   a report line and around a Trace line and its block, where the firmware
+   may send them (see captureTrace()). Every record must carry the stream
+   offset just past its '\n' or its block, however the stream is split.
+*/
+
+#include "check.h"
+#include "decoder.h"
+#include "synthetic.h"
+
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace a5200;
+
+// Record as text, so lists of records compare with ==
+static std::string describe(const Record &r)
+{
+    char buf[64];
+    switch (r.type) {
+    case RecordType::Report:
+        std::snprintf(buf, sizeof buf, "report %d %u %u %d %d %04x %d", static_cast<int>(r.report.controller),
+                      r.report.potx, r.report.poty, r.report.top, r.report.bottom, r.report.keys, r.report.linear);
+        return buf;
+    case RecordType::Event:
+        std::snprintf(buf, sizeof buf, "event %c%c", r.event.name, r.event.pressed ? '+' : '-');
+        return buf;
+    case RecordType::Trace: {
+        std::snprintf(buf, sizeof buf, "trace %u %u %u %u ", r.trace.potx, r.trace.poty, r.trace.edgesX,
+                      r.trace.edgesY);
+        std::string s = buf;
+        for (int i = 0; i < kTraceBytes; ++i) {
+            std::snprintf(buf, sizeof buf, "%02x", r.trace.bits[i]);
+            s += buf;
+        }
+        return s;
+    }
+    default:
+        return std::to_string(static_cast<int>(r.type)) + " " + std::string(r.text);
+    }
+}
+
+static std::vector<std::string> decode(const std::string &s, size_t chunk, Decoder &d)
+{
+    std::vector<std::string> out;
+    for (size_t i = 0; i < s.size(); i += chunk)
+        d.feed(s.data() + i, std::min(chunk, s.size() - i), [&](const Record &r) { out.push_back(describe(r)); });
+    return out;
+}
+
+static std::vector<std::string> decode(const std::string &s, size_t chunk = 4096)
+{
+    Decoder d;
+    return decode(s, chunk, d);
+}
+
+// Block holding the bytes that frame lines and events, which must stay data
+static std::string traceBlock()
+{
+    std::string b(kTraceBytes, '\0');
+    for (int i = 0; i < kTraceBytes; ++i) b[i] = static_cast<char>(0x0f + i * 37);
+    b[0] = '\r';
+    b[1] = '!';
+    b[2] = '\n';
+    b[30] = '!';
+    b[kTraceBytes - 1] = '\n';
+    return b;
+}
+
+static const char kTraceLine[] = "Trace X:100 Y:050\n\r";
+
+// Offset past the last '\n' of s, where the record just appended ends
+static uint64_t lineEnd(const std::string &s)
+{
+    return s.rfind('\n') + 1;
+}
+
+static std::string capture(std::vector<RecordType> &types, std::vector<uint64_t> &ends)
+{
+    std::mt19937 rng(5200);
+    std::string s;
+    static const char *const lines[] = {
+        "[Events] On\n\r",
+        "Matrix:0003 Count:002 Max:002 Ghost:0 Fault:0\n\r",
+        "Latency Off X:00012 Y:00013 On X:00014 Y:00015\n\r",
+        "VelBurst:00100 Ref X:114 Y:114\n\r",
+        "Settle Keys:0001 L0:003 L1:004 L2:005 L3:006 Dwell:024\n\r",
+    };
+    for (int i = 0; i < 40; ++i) {
+        Report r = randomReport(rng);
+        r.linear = (i % 7) == 3;
+        appendReport(s, r);
+        types.push_back(RecordType::Report);
+        ends.push_back(lineEnd(s));
+        if (i % 3 == 1) {
+            appendEvent(s, Event{kKeyNames[rng() % 15], (rng() & 1) != 0});
+            types.push_back(RecordType::Event);
+            ends.push_back(lineEnd(s));
+        }
+        if (i % 8 == 5) {
+            Record parsed;
+            const char *line = lines[i / 8];
+            CHECK(parseLine(std::string_view(line, std::strlen(line) - 2), parsed));
+            s += line;
+            types.push_back(parsed.type);
+            ends.push_back(lineEnd(s));
+        }
+        if (i % 10 == 9) {
+            s += kTraceLine;
+            s += traceBlock();
+            types.push_back(RecordType::Trace);
+            ends.push_back(s.size());
+            s += "\n\r";            // empty line closing the block
+        }
+    }
+    return s;
+}
+
+static void testChunks()
+{
+    std::vector<RecordType> types;
+    std::vector<uint64_t> ends;
+    std::string s = capture(types, ends);
+
+    Decoder whole;
+    std::vector<RecordType> got;
+    std::vector<uint64_t> gotEnds;
+    whole.feed(s.data(), s.size(), [&](const Record &r) {
+        got.push_back(r.type);
+        gotEnds.push_back(r.end);
+    });
+    CHECK(got == types);
+    CHECK(gotEnds == ends);
+    CHECK(whole.records() == types.size());
+    CHECK(whole.unknown() == 0);
+    CHECK(whole.overflows() == 0);
+    CHECK(whole.offset() == s.size());
+
+    std::vector<std::string> expected = decode(s);
+    for (size_t chunk = 1; chunk <= s.size(); ++chunk)
+        if (!CHECK(decode(s, chunk) == expected)) break;
+
+    // uneven splits
+    std::mt19937 rng(52);
+    for (int round = 0; round < 200; ++round) {
+        Decoder d;
+        std::vector<std::string> out;
+        gotEnds.clear();
+        for (size_t i = 0; i < s.size();) {
+            size_t n = std::min<size_t>(1 + rng() % 97, s.size() - i);
+            d.feed(s.data() + i, n, [&](const Record &r) {
+                out.push_back(describe(r));
+                gotEnds.push_back(r.end);
+            });
+            i += n;
+        }
+        if (!CHECK(out == expected)) break;
+        if (!CHECK(gotEnds == ends)) break;
+    }
+}
+
+static void testEventInLine()
+{
+    std::string line;
+    appendReport(line, Report{Controller::Joystick, 12, 200, true, false, 0x0101, false});
+    std::string event;
+    appendEvent(event, Event{'5', true});
+    std::vector<std::string> plain = decode(line), frame = decode(event);
+    CHECK(plain.size() == 1 && frame.size() == 1);
+
+    size_t newline = line.find('\n');
+    for (size_t pos = 0; pos <= line.size(); ++pos) {
+        std::string s = line.substr(0, pos) + event + line.substr(pos);
+        std::vector<std::string> expected;
+        if (pos <= newline) expected = {frame[0], plain[0]};
+        else expected = {plain[0], frame[0]};
+        if (!CHECK(decode(s) == expected)) break;
+        if (!CHECK(decode(s, 1) == expected)) break;
+    }
+}
+
+static void testEventAroundTrace()
+{
+    std::string trace = std::string(kTraceLine) + traceBlock();
+    std::string event;
+    appendEvent(event, Event{'T', false});
+
+    Decoder d;
+    const uint8_t *bits = nullptr;
+    std::string block;
+    d.feed(trace.data(), trace.size(), [&](const Record &r) {
+        CHECK(r.type == RecordType::Trace);
+        bits = r.trace.bits;
+        block.assign(reinterpret_cast<const char *>(bits), kTraceBytes);
+        CHECK(r.trace.potx == 100 && r.trace.poty == 50);
+    });
+    CHECK(bits != nullptr);
+    CHECK(block == traceBlock());
+    std::vector<std::string> plain = decode(trace), frame = decode(event);
+    CHECK(plain.size() == 1 && frame.size() == 1);
+
+    // anywhere in the Trace line and between its '\n' and '\r', and after the block
+    size_t header = std::strlen(kTraceLine);
+    for (size_t pos = 0; pos < header; ++pos) {
+        std::string s = trace.substr(0, pos) + event + trace.substr(pos);
+        std::vector<std::string> expected = {frame[0], plain[0]};
+        if (!CHECK(decode(s) == expected)) break;
+        if (!CHECK(decode(s, 1) == expected)) break;
+    }
+    std::vector<std::string> after = {plain[0], frame[0]};
+    CHECK(decode(trace + event) == after);
+    CHECK(decode(trace + event, 1) == after);
+
+    // the firmware sends no frame inside the block, its '!' bytes are data
+    std::string twice = trace + trace;
+    std::vector<std::string> two = {plain[0], plain[0]};
+    CHECK(decode(twice) == two);
+    CHECK(decode(twice, 3) == two);
+}
+
+static void testOverflow()
+{
+    std::string s(Decoder::kMaxLine * 2, 'x');
+    s += "\n\r";
+    std::string line;
+    appendReport(line, Report{Controller::Trackball, 1, 2, false, true, 0, false});
+    s += line;
+
+    // split, the long line overflows the buffer; whole in a chunk, it is parsed in place as unknown
+    std::string unknown = std::to_string(static_cast<int>(RecordType::Unknown)) + " " +
+                          s.substr(0, Decoder::kMaxLine * 2);
+    for (size_t chunk : {size_t(1), size_t(7), Decoder::kMaxLine + 5}) {
+        Decoder d;
+        CHECK(decode(s, chunk, d) == decode(line));
+        CHECK(d.overflows() == 1 && d.unknown() == 0);
+    }
+    Decoder e;
+    uint64_t end = 0;
+    for (size_t i = 0; i < s.size(); i += 7)
+        e.feed(s.data() + i, std::min<size_t>(7, s.size() - i), [&](const Record &r) { end = r.end; });
+    CHECK(end == s.size() - 1);   // the record after the dropped line keeps its offset
+    Decoder d;
+    std::vector<std::string> whole = {unknown, decode(line)[0]};
+    CHECK(decode(s, s.size(), d) == whole);
+    CHECK(d.overflows() == 0 && d.unknown() == 1);
+}
+
+int main()
+{
+    testChunks();
+    testEventInLine();
+    testEventAroundTrace();
+    testOverflow();
+    return checkResult("decoder_test");
+}
@@ -0,0 +1,532 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   firmware_test - the firmware modes on the simulated board
+
+   Each mode is driven through a scenario and checked on what it sends. 
+   Events: in every report mode a key or button edge must reach the wire 
+   within the bound printed when events are turned on, the mode's bound plus
+   a frame for each further edge found together. Matrix: the bitmap, counts
+   and flags of the keys held, with a ghost key from three corners of a 
+   rectangle on the diode-less keypad and none when it has diodes. CAV 
+   latency: the frame a trackball's outputs settle in after each CAV change,
+   for response times short, a few frames and beyond the measured frames. 
+   Velocity: bursts numbered in order, every sample the trackball's speed 
+   from the CAV off reference and the peak and mean of each burst. Soak: a
+   minute with a stick out of range, a hot swap, short taps and nothing 
+   plugged in must show in the summary's counters, and the log read back 
+   from EEPROM after a power cycle must be that summary. Scheduler: a report 
+   every 64 ticks with the last reading, one soon after each 'g' and no 
+   others, and periodic reports again after 'n'. Settle: the sweep must give
+   each line the keypad's settle time, or its recovery time after a key on 
+   the line before, and the dwell scan must still read the key. Buttons: 
+   press and bounce times to the line with every edge counted, and long 
+   presses up to their saturation. Trace: each block must hold one clean 
+   ramp per comparator, ending on the line of the X and Y readings sent with
+   it, which must follow the stick. ViH: each level set must be echoed in 
+   VR steps and millivolts and move that axis only, raised later and lowered
+   earlier; a bad level or none leaves both.
+*/
+
+#include "check.h"
+#include "scenario.h"
+#include "simrun.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace a5200;
+
+namespace {
+
+// Bound and per edge step from "[Events] On, max latency:nnnnnms +nnnms per extra edge", -1 if none
+bool eventBound(const SimRun &run, int &bound, int &step)
+{
+    for (const SimRecord &r : run.records)
+        if (r.record.type == RecordType::Status &&
+            std::sscanf(r.text.c_str(), "[Events] On, max latency:%dms +%dms per extra edge", &bound, &step) == 2)
+            return true;
+    return false;
+}
+
+// Time (ms) of the first event for name after t, pressed or released, -1 if none
+double eventAfter(const SimRun &run, char name, bool pressed, double t)
+{
+    for (const SimRecord *r : run.find(RecordType::Event, t / 1000))
+        if (r->record.event.name == name && r->record.event.pressed == pressed) return r->t * 1000;
+    return -1;
+}
+
+void testEvents()
+{
+    const char *const modes = "nmlvsbw";
+    std::mt19937 rng(26);
+    for (const char *m = modes; *m; ++m) {
+        // presses held longer than any bound, at random points of the mode's cycle
+        std::string text = "0 joystick\n0 send ";
+        text += *m;
+        text += "\n100 send e\n";
+        std::vector<double> single, together;
+        double t = 1500;
+        for (int i = 0; i < 16; ++i) {
+            t += 1200 + rng() % 400;
+            bool chord = i % 4 == 3;
+            text += std::to_string(static_cast<int>(t)) + (chord ? " tap 5#T 600\n" : " tap 5 600\n");
+            (chord ? together : single).push_back(t);
+        }
+        text += std::to_string(static_cast<int>(t + 1500)) + " end\n";
+
+        SimRun run;
+        if (!simRun(text, run)) continue;
+        int bound = 0, step = 0;
+        if (!CHECK(eventBound(run, bound, step))) continue;
+        double worst = 0, worstChord = 0;
+        for (double p : single) {
+            double down = eventAfter(run, '5', true, p), up = eventAfter(run, '5', false, p + 600);
+            if (!CHECK(down >= 0 && up >= 0)) break;
+            worst = std::max({worst, down - p, up - p - 600});
+        }
+        for (double p : together) {
+            // three edges found by one check, the last frame sent two frames after the first
+            double last = 0;
+            for (char name : {'5', '#', 'T'}) {
+                double down = eventAfter(run, name, true, p);
+                if (!CHECK(down >= 0)) break;
+                last = std::max(last, down - p);
+            }
+            worstChord = std::max(worstChord, last);
+        }
+        if (std::getenv("FIRMWARE_TEST_VERBOSE"))
+            std::fprintf(stderr, "events %c: bound %d +%d, worst %.1f, three edges %.1f\n", *m, bound, step, worst,
+                         worstChord);
+        CHECK(worst <= bound);
+        CHECK(worstChord <= bound + 2 * step);
+    }
+}
+
+// Last report of a type before t (ms)
+const SimRecord *lastBefore(const SimRun &run, RecordType type, double t)
+{
+    const SimRecord *last = nullptr;
+    for (const SimRecord *r : run.find(type))
+        if (r->t * 1000 < t) last = r;
+    return last;
+}
+
+uint16_t bits(const char *keys)
+{
+    uint16_t b = 0;
+    for (const char *k = keys; *k; ++k) b |= 1u << keyBit(*k);
+    return b;
+}
+
+// The key with no switch, COL3 on LIN3, closed
+class FaultyKeypad : public Stimulus {
+public:
+    void inputs(double, Inputs &in) override { in.keys = 0x8000; }
+    int command(double) override { return sent_++ ? -1 : 'm'; }
+
+private:
+    int sent_ = 0;
+};
+
+void testMatrix()
+{
+    static const char kScenario[] =
+        "0 joystick\n"
+        "0 send m\n"
+        "500 press 5\n"
+        "1000 release 5\n"
+        "1200 press 748\n"
+        "1700 release 748\n"
+        "2000 end\n";
+    SimConfig diodes;
+    diodes.ghosting = false;
+    for (bool ghosting : {true, false}) {
+        SimRun run;
+        if (!simRun(kScenario, run, ghosting ? SimConfig() : diodes)) return;
+        const SimRecord *one = lastBefore(run, RecordType::Matrix, 1000);
+        const SimRecord *three = lastBefore(run, RecordType::Matrix, 1700);
+        const SimRecord *none = lastBefore(run, RecordType::Matrix, 2000);
+        if (!CHECK(one && three && none && none->t > 1.75)) return;
+        const Matrix &a = one->record.matrix, &b = three->record.matrix, &c = none->record.matrix;
+        CHECK(a.keys == bits("5") && a.count == 1 && a.max == 1 && !a.ghost && !a.fault);
+        if (ghosting) CHECK(b.keys == bits("7485") && b.count == 4 && b.max == 4 && b.ghost);
+        else CHECK(b.keys == bits("748") && b.count == 3 && b.max == 3 && !b.ghost);
+        CHECK(!b.fault);
+        CHECK(c.keys == 0 && c.count == 0 && c.max == 0 && !c.ghost);
+        CHECK(run.find(RecordType::Report).empty());
+    }
+
+    FaultyKeypad faulty;
+    Decoder decoder;
+    bool fault = false;
+    Simulator simulator(SimConfig(), faulty, [&](double, uint8_t byte) {
+        char ch = static_cast<char>(byte);
+        decoder.feed(&ch, 1, [&](const Record &r) {
+            if (r.type == RecordType::Matrix) fault = r.matrix.fault && r.matrix.keys == 0x8000;
+        });
+    });
+    simulator.run(0.5);
+    CHECK(fault);
+}
+
+void testLatency()
+{
+    // a joystick follows CAV at once, a spinning trackball after its response time
+    static const char kJoystick[] = "0 joystick\n0 stick 60 170\n0 send l\n3000 end\n";
+    static const char kTrackball[] = "0 trackball\n0 spin 100000 40 -30\n0 send l\n3000 end\n";
+    struct {
+        const char *scenario;
+        double delay;       // trackball response, s
+        uint16_t lines;     // expected on both axes, both ways
+    } const cases[] = {
+        {kJoystick, 0.5e-3, 0},
+        {kTrackball, 0.5e-3, 244},      // the first frame starts charging before the change
+        {kTrackball, 40e-3, 3 * 244},   // frames of 15.6ms, the 4th one starts after it
+        {kTrackball, 230e-3, 65535},    // in time for the last of the 16 frames only
+    };
+    for (const auto &c : cases) {
+        SimConfig config;
+        config.trackballDelay = c.delay;
+        SimRun run;
+        if (!simRun(c.scenario, run, config)) return;
+        std::vector<const SimRecord *> v = run.find(RecordType::Latency);
+        if (!CHECK(v.size() >= 4)) continue;
+        for (const SimRecord *r : v) {
+            const Latency &l = r->record.latency;
+            if (std::getenv("FIRMWARE_TEST_VERBOSE"))
+                std::fprintf(stderr, "latency %.4f: %s\n", c.delay, r->text.c_str());
+            if (!CHECK(l.offX == c.lines && l.offY == c.lines && l.onX == c.lines && l.onY == c.lines)) break;
+        }
+    }
+}
+
+void testVelocity()
+{
+    SimRun run;
+    if (!simRun("0 trackball\n0 spin 100000 25 -40\n0 send v\n4000 end\n", run)) return;
+    std::vector<const SimRecord *> bursts = run.find(RecordType::VelocityBurst);
+    std::vector<const SimRecord *> samples = run.find(RecordType::VelocitySample);
+    std::vector<const SimRecord *> stats = run.find(RecordType::VelocityStats);
+    if (!CHECK(bursts.size() >= 3 && stats.size() >= 3)) return;
+    for (size_t i = 0; i < bursts.size(); ++i) CHECK(bursts[i]->record.burst.burst == i);
+    CHECK(samples.size() >= 24 * stats.size());
+    int frame = 0;
+    for (const SimRecord *r : samples) {
+        const VelocitySample &v = r->record.sample;
+        CHECK(v.frame == frame);
+        frame = (frame + 1) % 24;
+        if (!CHECK(std::abs(v.x - 25) <= 1 && std::abs(v.y + 40) <= 1)) break;
+    }
+    for (const SimRecord *r : stats) {
+        const VelocityStats &v = r->record.stats;
+        if (!CHECK(std::abs(v.peakX - 25) <= 1 && std::abs(v.meanX - 25) <= 1 && std::abs(v.peakY + 40) <= 1 &&
+                   std::abs(v.meanY + 40) <= 1))
+            break;
+    }
+    const VelocityBurst &b = bursts.back()->record.burst;
+    CHECK(std::abs(b.refx - b.refy) <= 1 && b.refx > 0 && b.refx < 227);
+
+    // at rest, nothing
+    SimRun rest;
+    if (!simRun("0 trackball\n0 send v\n1500 end\n", rest)) return;
+    stats = rest.find(RecordType::VelocityStats);
+    if (CHECK(!stats.empty())) {
+        const VelocityStats &v = stats[0]->record.stats;
+        CHECK(std::abs(v.peakX) <= 1 && std::abs(v.peakY) <= 1);
+    }
+}
+
+void testSoak()
+{
+    std::string text =
+        "0 joystick\n"
+        "0 stick 114 114\n"
+        "100 send s\n"
+        "10000 stick 5 114\n"          // out of range for a second
+        "11000 stick 114 114\n"
+        "20000 trackball\n"            // two flips
+        "21000 joystick\n"
+        "25000 press 8\n"              // held, not a glitch
+        "26000 release 8\n"
+        "40000 none\n"                 // saturated
+        "41000 joystick\n";
+    for (int i = 0; i < 10; ++i) text += std::to_string(30000 + 500 * i) + " tap 5 12\n";   // a scan at most
+    text += "66000 send r\n67000 end\n";
+    Scenario scenario;
+    if (!CHECK(scenario.parse(text))) return;
+
+    std::vector<Soak> summaries;
+    Decoder decoder;
+    Simulator simulator(SimConfig(), scenario, [&](double, uint8_t byte) {
+        char c = static_cast<char>(byte);
+        decoder.feed(&c, 1, [&](const Record &r) {
+            if (r.type == RecordType::Soak) summaries.push_back(r.soak);
+        });
+    });
+    simulator.run(65.5);
+    if (!CHECK(summaries.size() == 1)) return;
+    const Soak s = summaries[0];   // a copy, more are decoded into the vector
+    CHECK(!s.saved && s.minutes == 1);
+    CHECK(s.frames > 2000 && s.frames < 3000);
+    CHECK(s.range > 0 && s.sat > 0);
+    CHECK(s.flips == 2);
+    CHECK(s.glitches >= 1 && s.glitches <= 10);
+    CHECK(s.driftX == 227 - 114 && s.driftY == 227 - 114);
+
+    simulator.run(1.5);   // power cycle, then 'r'
+    if (!CHECK(summaries.size() == 2)) return;
+    const Soak &saved = summaries[1];
+    CHECK(saved.saved);
+    CHECK(saved.minutes == s.minutes && saved.frames == s.frames && saved.range == s.range && saved.sat == s.sat &&
+          saved.flips == s.flips && saved.glitches == s.glitches && saved.driftX == s.driftX &&
+          saved.driftY == s.driftY);
+}
+
+void testScheduler()
+{
+    static const char kScenario[] =
+        "0 joystick\n"
+        "0 stick 100 100\n"
+        "2000 stick 50 60\n"
+        "3000 send g\n"
+        "3500 send g\n"
+        "3600 send g\n"
+        "3900 stick 150 160\n"
+        "4200 send g\n"
+        "5000 send n\n"
+        "6500 end\n";
+    SimRun run;
+    if (!simRun(kScenario, run)) return;
+
+    // periodic, a report every 64 ticks of 1/8 frame, with the reading taken before it
+    std::vector<double> periodic;
+    for (const SimRecord *r : run.find(RecordType::Report, 1.0))
+        if (r->t < 3.0) periodic.push_back(r->t * 1000);
+    if (!CHECK(periodic.size() >= 14)) return;
+    for (size_t i = 1; i < periodic.size(); ++i)
+        if (!CHECK(std::abs(periodic[i] - periodic[i - 1] - 64 * 16.683 / 8) < 3)) break;
+    const SimRecord *moved = lastBefore(run, RecordType::Report, 2000 + 64 * 16.683 / 8 + 70);
+    CHECK(moved && moved->record.report.potx == 50 && moved->record.report.poty == 60);
+
+    // on demand, one report for each 'g', sent within a pot frame, a tick and its 52ms
+    static const double asked[] = {3000, 3500, 3600, 4200};
+    std::vector<double> demanded;
+    for (const SimRecord *r : run.find(RecordType::Report, 3.0))
+        if (r->t < 5.0) demanded.push_back(r->t * 1000);
+    if (CHECK(demanded.size() == std::size(asked)))
+        for (size_t i = 0; i < demanded.size(); ++i) {
+            if (std::getenv("FIRMWARE_TEST_VERBOSE")) std::fprintf(stderr, "report on demand: %.1f\n", demanded[i] - asked[i]);
+            CHECK(demanded[i] > asked[i] && demanded[i] - asked[i] < 75);
+        }
+    CHECK(!demanded.empty() && run.find(RecordType::Report, 4.2).front()->record.report.potx == 150);
+
+    // 'n', periodic again
+    CHECK(run.find(RecordType::Report, 5.2).size() >= 9);
+}
+
+// Settle time the sweep prints for a delay in cycles: the first sample at or after it, KS_FIXED+2+8*n
+int sweptCycles(double cycles)
+{
+    int n = static_cast<int>(std::ceil((cycles - 6) / 8));
+    return 6 + 8 * std::max(n, 0);
+}
+
+// Status line of the run starting with text, nullptr if none
+const SimRecord *status(const SimRun &run, const char *text)
+{
+    for (const SimRecord *r : run.find(RecordType::Status))
+        if (r->text.rfind(text, 0) == 0) return r;
+    return nullptr;
+}
+
+void testSettle()
+{
+    // no sweep yet, then no keys; a slow '5' on LIN1, the dwell scan still reads it; LIN2 waits for
+    // LIN1 to recover
+    static const char kSlow[] =
+        "0 joystick\n"
+        "200 send d\n"
+        "400 send k\n"             // a sweep takes ~0.85s
+        "1500 press 5\n"
+        "1800 send k\n"
+        "3000 send d\n"
+        "4500 release 5\n"
+        "4700 send k\n"
+        "5800 end\n";
+    SimConfig slow;
+    slow.keySettle = 33e-6;
+    SimRun run;
+    if (!simRun(kSlow, run, slow)) return;
+    CHECK(status(run, "[Settle] Sweep first"));
+    const SimRecord *none = status(run, "[Settle] No keys held");
+    CHECK(none && none->t < 1.5);
+    std::vector<const SimRecord *> sweeps = run.find(RecordType::Settle);
+    if (!CHECK(sweeps.size() == 1)) return;
+    const Settle &a = sweeps[0]->record.settle;
+    int line = sweptCycles(slow.keySettle * slow.cycleHz), next = sweptCycles(slow.keyRecover * slow.cycleHz);
+    CHECK(a.keys == bits("5"));
+    CHECK(a.lines[0] == 6 && a.lines[1] == line && a.lines[2] == next && a.lines[3] == 6);
+    CHECK(a.dwell == std::max(line, next) + 8);
+    const SimRecord *on = status(run, "[Settle] Dwell scan on");
+    const SimRecord *held = lastBefore(run, RecordType::Report, 4500);
+    CHECK(on && held && held->t > on->t + 0.2 && held->record.report.keys == bits("5"));
+    CHECK(run.find(RecordType::Status, 4.7).size() == 1 &&
+          run.find(RecordType::Status, 4.7).front()->text == "[Settle] No keys held");
+
+    // a key on LIN0 keeps its column low after the line is released, LIN1 waits for it
+    static const char kRecover[] =
+        "0 joystick\n"
+        "300 press 4\n"
+        "500 send k\n"
+        "1600 end\n";
+    SimConfig recover;
+    recover.keyRecover = 40e-6;
+    SimRun slowRecovery;
+    if (!simRun(kRecover, slowRecovery, recover)) return;
+    sweeps = slowRecovery.find(RecordType::Settle);
+    if (!CHECK(sweeps.size() == 1)) return;
+    const Settle &b = sweeps[0]->record.settle;
+    line = sweptCycles(recover.keySettle * recover.cycleHz);
+    next = sweptCycles(recover.keyRecover * recover.cycleHz);
+    CHECK(b.keys == bits("4"));
+    CHECK(b.lines[0] == line && b.lines[1] == next && b.lines[2] == 6 && b.lines[3] == 6);
+    CHECK(b.dwell == std::max(line, next) + 8);
+}
+
+void testButtons()
+{
+    static const char kScenario[] =
+        "0 joystick\n"
+        "0 send b\n"
+        "200 press T\n"               // 3 bounces over 2ms, 1 over 0.5ms on release
+        "200.2 bounce T 2 3\n"
+        "450 release T\n"
+        "450.1 bounce T 0.5 1\n"
+        "700 tap B 80\n"
+        "1000 press B\n"              // 20 bounces in a frame, every edge kept
+        "1000.2 bounce B 4 20\n"
+        "1300 release B\n"
+        "1600 press T\n"              // times up to 3.9s, then saturated
+        "4600 release T\n"
+        "4900 tap B 3900\n"
+        "9000 press T\n"
+        "14000 release T\n"
+        "14500 end\n";
+    SimRun run;
+    if (!simRun(kScenario, run)) return;
+    std::vector<const SimRecord *> presses = run.find(RecordType::Button);
+    if (!CHECK(presses.size() == 6)) return;
+    auto near = [](int got, int expected) { return std::abs(got - expected) <= 1; };   // to the line, 0.64 tenths
+    const ButtonPress &a = presses[0]->record.button, &b = presses[1]->record.button;
+    const ButtonPress &c = presses[2]->record.button, &d = presses[3]->record.button;
+    const ButtonPress &e = presses[4]->record.button, &f = presses[5]->record.button;
+    CHECK(a.name == 'T' && near(a.held, 2500) && near(a.down, 22) && a.downEdges == 6 && near(a.up, 6) &&
+          a.upEdges == 2);
+    CHECK(b.name == 'B' && near(b.held, 800) && b.down == 0 && b.downEdges == 0 && b.up == 0 && b.upEdges == 0);
+    CHECK(c.name == 'B' && near(c.held, 3000) && near(c.down, 42) && c.downEdges == 40);
+    CHECK(d.name == 'T' && near(d.held, 30000));
+    CHECK(e.name == 'B' && near(e.held, 39000));
+    CHECK(f.name == 'T' && f.held == 65535);
+}
+
+// Last line with the comparator high in a Trace block, -1 if none
+int traceLast(const uint8_t *block, int axis)
+{
+    int last = -1;
+    for (int l = 0; l < kTraceLines; ++l)
+        if (traceBit(block, l, axis)) last = l;
+    return last;
+}
+
+void testTrace()
+{
+    static const int readings[][2] = {{114, 114}, {5, 220}, {60, 150}, {200, 30}};
+    std::string text = "0 joystick\n0 send w\n";
+    double t = 0;
+    for (const auto &r : readings) {
+        text += std::to_string(static_cast<int>(t)) + " stick " + std::to_string(r[0]) + " " +
+                std::to_string(r[1]) + "\n";
+        t += 500;
+    }
+    text += std::to_string(static_cast<int>(t)) + " end\n";
+    SimRun run;
+    if (!simRun(text, run)) return;
+    std::vector<const SimRecord *> traces = run.find(RecordType::Trace);
+    CHECK(traces.size() > 4 * 3);
+    int seen[std::size(readings)] = {};
+    for (const SimRecord *r : traces) {
+        // the block is the last kTraceBytes of the record, sent as raw bytes
+        const uint8_t *block = reinterpret_cast<const uint8_t *>(run.bytes.data()) + r->record.end - kTraceBytes;
+        const Trace &g = r->record.trace;
+        size_t i = static_cast<size_t>(r->t * 1000 / 500);
+        bool settled = r->t * 1000 - i * 500 > 150;   // a frame read before the stick moved may come first
+        if (!CHECK(traceLast(block, 0) == g.potx && traceLast(block, 1) == g.poty)) break;
+        if (!CHECK(g.edgesX == 1 && g.edgesY == 1 && traceBit(block, 0, 0) && traceBit(block, 0, 1))) break;
+        if (!settled || i >= std::size(readings)) continue;
+        ++seen[i];
+        if (!CHECK(std::abs(g.potx - readings[i][0]) <= 1 && std::abs(g.poty - readings[i][1]) <= 1)) break;
+    }
+    for (int n : seen) CHECK(n > 0);
+}
+
+void testVih()
+{
+    static const char kScenario[] =
+        "0 joystick\n"
+        "0 stick 114 114\n"
+        "500 send xF\n"       // x later, split per line
+        "1000 send y3\n"      // y earlier
+        "1500 send xG\n"
+        "2000 send x\n"       // level never sent
+        "3500 send yb\n"      // both back at the default
+        "4000 end\n";
+    SimRun run;
+    if (!simRun(kScenario, run)) return;
+    std::vector<std::string> replies;
+    for (const SimRecord &r : run.records)
+        if (r.record.type == RecordType::Status && r.text.compare(0, 5, "[ViH]") == 0) replies.push_back(r.text);
+    auto reply = [](int x, int y) {
+        char buf[64];
+        std::snprintf(buf, sizeof buf, "[ViH] X:%03d/%05dmV Y:%03d/%05dmV", x, x * 5000 / 24, y, y * 5000 / 24);
+        return std::string(buf);
+    };
+    std::vector<std::string> expected = {reply(15, 11), reply(15, 3), "[ViH] Bad level", "[ViH] Timeout",
+                                         reply(15, 11)};
+    CHECK(replies == expected);
+
+    const SimRecord *base = lastBefore(run, RecordType::Report, 500), *high = lastBefore(run, RecordType::Report, 1000);
+    const SimRecord *low = lastBefore(run, RecordType::Report, 1500), *kept = lastBefore(run, RecordType::Report, 3500);
+    const SimRecord *back = lastBefore(run, RecordType::Report, 4000);
+    if (!CHECK(base && high && low && kept && back && back->t > 3.6)) return;
+    const Report &a = base->record.report, &b = high->record.report, &c = low->record.report;
+    const Report &d = kept->record.report, &e = back->record.report;
+    CHECK(std::abs(a.potx - 114) <= 1 && std::abs(a.poty - 114) <= 1);
+    CHECK(b.potx > a.potx + 20 && b.poty == a.poty);
+    CHECK(c.potx == b.potx && c.poty + 20 < a.poty);
+    CHECK(d.potx == c.potx && d.poty == c.poty);   // a bad level or a timeout leaves both
+    CHECK(e.potx == b.potx && e.poty == a.poty);
+}
+
+} // namespace
+
+int main()
+{
+    testEvents();
+    testMatrix();
+    testLatency();
+    testVelocity();
+    testSoak();
+    testScheduler();
+    testSettle();
+    testButtons();
+    testTrace();
+    testVih();
+    return checkResult("firmware_test");
+}
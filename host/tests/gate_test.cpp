@@ -0,0 +1,151 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   gate_test - a5200gate verdicts on synthetic captures
+
+   A stick released at the center, then pushed around its gate, is written
+   as the reports the firmware would send: a circular and a square gate must
+   pass and be told apart, and each check must fail on its own when the
+   capture breaks it (a saturated reading, an obstructed direction, a rest
+   off center, rests spread wider than the dead zone). The capture of
+   sim/scenarios/stick_gate.txt on the simulated board must pass too.
+*/
+
+#include "check.h"
+#include "synthetic.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+using namespace a5200;
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+struct Stick {
+    double radius = 107;            // 7..221 on both axes
+    bool square = false;
+    double restX = 114, restY = 114;
+    double restX2 = 114, restY2 = 114;   // second release
+    double obstructed = 0;          // reach scale from 75 to 105 degrees, 0 for none
+    bool saturate = false;
+};
+
+void rest(std::string &s, double x, double y)
+{
+    for (int i = 0; i < 6; ++i)
+        appendReport(s, Report{Controller::Joystick, static_cast<uint8_t>(std::lround(x)),
+                               static_cast<uint8_t>(std::lround(y)), false, false, 0, false});
+}
+
+std::string capture(const Stick &k)
+{
+    std::string s;
+    rest(s, k.restX, k.restY);
+    for (int d = 0; d < 360; ++d) {
+        double a = d * kPi / 180, c = std::cos(a), n = std::sin(a);
+        double r = k.radius;
+        if (k.square) r /= std::max(std::fabs(c), std::fabs(n));
+        if (k.obstructed && d >= 75 && d <= 105) r *= k.obstructed;
+        double x = std::clamp(114 + r * c, 0.0, 226.0), y = std::clamp(114 + r * n, 0.0, 226.0);
+        appendReport(s, Report{Controller::Joystick, static_cast<uint8_t>(std::lround(x)),
+                               static_cast<uint8_t>(std::lround(y)), false, false, 0, false});
+    }
+    rest(s, k.restX2, k.restY2);
+    if (k.saturate) appendReport(s, Report{Controller::Joystick, 227, 114, false, false, 0, false});
+    // trackball reports and positions are not readings of the stick
+    appendReport(s, Report{Controller::Trackball, 227, 0, false, false, 0, false});
+    appendReport(s, Report{Controller::Joystick, 0, 255, false, false, 0, true});
+    return s;
+}
+
+std::string readFile(const std::string &path)
+{
+    std::ifstream in(path);
+    std::stringstream s;
+    s << in.rdbuf();
+    return s.str();
+}
+
+// a5200gate on the capture, its exit status and its report in out
+int gate(const char *argv0, const Stick &k, const std::string &options, std::string &out)
+{
+    std::string path = checkTempPath("gate_test.txt"), report = checkTempPath("gate_test.out");
+    std::ofstream(path) << capture(k);
+    int status = checkTool(argv0, "a5200gate" + options + " " + path + " 2> /dev/null", report);
+    out = readFile(report);
+    std::remove(path.c_str());
+    std::remove(report.c_str());
+    return status;
+}
+
+bool has(const std::string &out, const char *text)
+{
+    return out.find(text) != std::string::npos;
+}
+
+} // namespace
+
+int main(int, char **argv)
+{
+    std::string out;
+    Stick circle;
+    CHECK(gate(argv[0], circle, "", out) == 0);
+    CHECK(has(out, "reports    372 joystick, 0 saturated, 1 trackball, 1 positions"));
+    CHECK(has(out, "range      x 007..221  y 007..221"));
+    CHECK(has(out, "center     114.0,114.0  offset +0.0,+0.0"));
+    CHECK(has(out, "gate       circular"));
+    CHECK(has(out, "16/16 reached"));
+    CHECK(has(out, "\nPASS\n"));
+
+    Stick square;
+    square.square = true;
+    square.radius = 105;
+    CHECK(gate(argv[0], square, "", out) == 0);
+    CHECK(has(out, "gate       square"));
+
+    // the dead zone takes both rests, the center their mean
+    Stick spread;
+    spread.restX2 = 118;
+    spread.restY2 = 112;
+    CHECK(gate(argv[0], spread, "", out) == 0);
+    CHECK(has(out, "center     116.0,113.0") && has(out, "dead zone  x 4  y 2 over 2 rests"));
+    CHECK(gate(argv[0], spread, " --dead 3", out) == 1);
+    CHECK(has(out, "dead zone  x 4  y 2 over 2 rests  (3)  FAIL"));
+
+    Stick offCenter;
+    offCenter.restX = offCenter.restX2 = 140;
+    CHECK(gate(argv[0], offCenter, "", out) == 1);
+    CHECK(has(out, "offset +26.0,+0.0  (20)  FAIL"));
+
+    Stick saturated;
+    saturated.saturate = true;
+    CHECK(gate(argv[0], saturated, "", out) == 1);
+    CHECK(has(out, "1 saturated") && has(out, "(10..190)  FAIL"));
+
+    // a narrow range passes with the limits moved in
+    Stick small;
+    small.radius = 90;
+    CHECK(gate(argv[0], small, "", out) == 1);
+    CHECK(gate(argv[0], small, " --low 30 --high 200", out) == 0);
+
+    Stick obstructed;
+    obstructed.obstructed = 0.7;
+    CHECK(gate(argv[0], obstructed, "", out) == 1);
+    CHECK(has(out, "short") && has(out, "(0.90)  FAIL"));
+    CHECK(gate(argv[0], obstructed, " --reach 0.5", out) == 0);
+
+    CHECK(gate(argv[0], circle, " --sectors 12", out) == 1);
+
+    // the simulated unit with a circular gate, through the firmware
+    std::string path = checkTempPath("gate_test.sim");
+    CHECK(checkTool(argv[0], "a5200sim -q -o " + path + " sim/scenarios/stick_gate.txt 2> /dev/null") == 0);
+    CHECK(checkTool(argv[0], "a5200gate " + path + " 2> /dev/null") == 0);
+    std::remove(path.c_str());
+    return checkResult("gate_test");
+}
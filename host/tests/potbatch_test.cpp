@@ -0,0 +1,67 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   potbatch_test - potReadings() against PotModel::reading()
+
+   The batch form is built with -O3 -ffast-math and floats, so it may differ
+   from the double precision model by one line when the crossing falls within
+   a thousandth of a line from a sample; anywhere else the readings must be
+   equal. Sources at or below ViH must give the last line in both.
+*/
+
+#include "check.h"
+#include "potmodel.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace a5200;
+
+int main()
+{
+    const PotModel model;
+    const size_t n = 200003;    // odd, so the loop tail after the vector body runs too
+    std::vector<float> source(n), r(n), vih(n), capScale(n);
+    std::vector<uint8_t> out(n);
+
+    std::mt19937 rng(5200);
+    std::uniform_real_distribution<float> joystick(3.5f, 5.5f), trackball(1.9f, 5.0f), threshold(2.0f, 2.6f);
+    std::uniform_real_distribution<float> pot(0.0f, 600e3f), scale(0.8f, 1.2f);
+    for (size_t i = 0; i < n; ++i) {
+        source[i] = (i & 1) ? joystick(rng) : trackball(rng);
+        r[i] = pot(rng);
+        vih[i] = threshold(rng);
+        capScale[i] = scale(rng);
+        switch (i % 97) {           // edge cases
+        case 0: source[i] = vih[i]; break;
+        case 1: r[i] = 0; break;
+        case 2: source[i] = vih[i] + 0.01f; break;
+        }
+    }
+
+    potReadings(model, source.data(), r.data(), vih.data(), capScale.data(), out.data(), n);
+
+    size_t boundary = 0, failures = 0;
+    for (size_t i = 0; i < n && failures < 10; ++i) {
+        PotModel m = model;
+        m.vih = vih[i];
+        m.timingCap *= capScale[i];
+        m.inputCap *= capScale[i];
+        int expected = m.reading(source[i], r[i]);
+
+        if (source[i] <= vih[i]) {
+            failures += !CHECK(out[i] == model.lines - 1);
+            continue;
+        }
+        if (out[i] == expected) continue;
+
+        double lines = (m.crossingTime(source[i], r[i]) - m.sampleOffset) / m.linePeriod;
+        bool nearSample = std::fabs(lines - std::round(lines)) < 1e-3;
+        if (CHECK(nearSample && std::abs(out[i] - expected) == 1)) ++boundary;
+        else ++failures;
+    }
+    CHECK(boundary < n / 1000);
+    return checkResult("potbatch_test");
+}
@@ -0,0 +1,189 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   sequencer_test - production test scripts and the sequencer
+
+   Scripts are parsed and rejected line by line. Synthetic records then take
+   units through a pass, a timeout and an unplug in the middle of a step. 
+   Finally the operator scenario sim/scenarios/qa_cx52.txt runs on the 
+   simulated board against qa/cx52.txt, through the Sequencer and through 
+   a5200test --sim: the first unit passes and the second, with a dead '#' 
+   key, fails its keypad step. Paths are from host/, where make test runs.
+*/
+
+#include "check.h"
+#include "sequencer.h"
+#include "simrun.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+using namespace a5200;
+
+static const char kScript[] =
+    "# test script\n"
+    "model TEST\n"
+    "detect   joystick  10  Plug in\n"
+    "release             5  Let go\n"
+    "keys     12        10  Press 1 and 2\n"
+    "buttons  T          5  Press the top button\n"
+    "sweep    x 20 170  10  Left and right\n"
+    "center   90 140     5  Let go of the stick\n";
+
+static void testParse()
+{
+    TestScript s;
+    CHECK(s.parse(kScript));
+    CHECK(s.model == "TEST");
+    if (!CHECK(s.steps.size() == 6)) return;
+    CHECK(s.steps[0].kind == StepKind::Detect && s.steps[0].controller == Controller::Joystick);
+    CHECK(s.steps[2].kind == StepKind::Keys && s.steps[2].keys == ((1u << keyBit('1')) | (1u << keyBit('2'))));
+    CHECK(s.steps[3].top && !s.steps[3].bottom);
+    CHECK(s.steps[4].x && !s.steps[4].y && s.steps[4].low == 20 && s.steps[4].high == 170);
+    CHECK(s.steps[5].timeout == 5 && s.steps[5].prompt == "Let go of the stick");
+
+    const char *const bad[] = {
+        "model X\ndetect paddle 10 Plug in\n",
+        "model X\nkeys 12? 10 Press\n",
+        "model X\nbuttons TX 5 Press\n",
+        "model X\nsweep z 20 170 10 Move\n",
+        "model X\ncenter 140 90 5 Let go\n",
+        "model X\nrelease 0 Let go\n",
+        "model X\nwiggle 5 Wiggle\n",
+        "model X\n",
+    };
+    for (const char *text : bad) {
+        TestScript t;
+        CHECK(!t.parse(text) && !t.error.empty());
+    }
+}
+
+// Station fed report by report, 0.13 s apart as the firmware sends them
+struct Feed {
+    Sequencer &seq;
+    double t = 0;
+
+    void report(uint8_t x, uint8_t y, uint16_t keys = 0, bool top = false,
+                Controller c = Controller::Joystick)
+    {
+        Record r{};
+        r.type = RecordType::Report;
+        r.report = Report{c, x, y, top, false, keys, false};
+        t += 0.13;
+        seq.tick(t);
+        seq.record(t, r);
+    }
+    void event(char name, bool pressed)
+    {
+        Record r{};
+        r.type = RecordType::Event;
+        r.event = Event{name, pressed};
+        seq.tick(t);
+        seq.record(t, r);
+    }
+    void empty(int n) { while (n--) report(227, 227); }
+    void idle(double seconds, uint8_t x = 114) { for (double end = t + seconds; t < end;) report(x, 114); }
+};
+
+static void testSynthetic()
+{
+    TestScript script;
+    CHECK(script.parse(kScript));
+    Sequencer seq(script);
+    std::vector<UnitResult> units;
+    std::vector<std::string> prompts;
+    seq.onUnit = [&](const UnitResult &u) { units.push_back(u); };
+    seq.onPrompt = [&](int, const TestStep &s) { prompts.push_back(s.prompt); };
+    Feed f{seq};
+
+    // nothing plugged in
+    f.empty(10);
+    CHECK(seq.state() == Sequencer::State::Empty && seq.units() == 0);
+
+    // unit 1 goes through every step
+    f.idle(2);
+    CHECK(seq.state() == Sequencer::State::Running);
+    f.report(114, 114, 1u << keyBit('1'));
+    f.event('2', true);
+    f.event('2', false);
+    f.report(114, 114, 0, true);
+    f.idle(0.5, 10);
+    f.idle(0.5, 200);
+    f.idle(1);
+    if (CHECK(units.size() == 1)) {
+        CHECK(units[0].pass && units[0].steps.size() == script.steps.size());
+        CHECK(units[0].unit == 1);
+    }
+    CHECK(prompts.size() == script.steps.size());
+    CHECK(seq.state() == Sequencer::State::Done);
+
+    // unplugged, unit 2 is a trackball and fails detection at the timeout
+    f.empty(3);
+    CHECK(seq.state() == Sequencer::State::Empty);
+    for (int i = 0; i < 100; ++i) f.report(114, 114, 0, false, Controller::Trackball);
+    if (CHECK(units.size() == 2)) {
+        CHECK(!units[1].pass && units[1].steps.size() == 1);
+        CHECK(units[1].steps[0].detail == "timeout, seen as trackball");
+    }
+
+    // unit 3 unplugged during the keypad step
+    f.empty(3);
+    f.idle(2);
+    f.report(114, 114, 1u << keyBit('1'));
+    f.empty(3);
+    if (CHECK(units.size() == 3)) {
+        CHECK(!units[2].pass && units[2].steps.size() == 3);
+        CHECK(units[2].steps.back().detail == "unplugged");
+    }
+    CHECK(seq.units() == 3 && seq.passed() == 1);
+}
+
+static std::string readFile(const char *path)
+{
+    std::ifstream in(path);
+    std::stringstream s;
+    s << in.rdbuf();
+    return s.str();
+}
+
+static void testQa(const char *argv0)
+{
+    TestScript script;
+    if (!CHECK(script.load("qa/cx52.txt"))) return;
+    SimRun run;
+    if (!simRun(readFile("sim/scenarios/qa_cx52.txt"), run)) return;
+
+    Sequencer seq(script);
+    std::vector<UnitResult> units;
+    seq.onUnit = [&](const UnitResult &u) { units.push_back(u); };
+    for (const SimRecord &r : run.records) {
+        seq.tick(r.t);
+        seq.record(r.t, r.record);
+    }
+    seq.tick(run.times.back());
+    if (CHECK(units.size() == 2)) {
+        CHECK(units[0].pass && units[0].steps.size() == script.steps.size());
+        CHECK(!units[1].pass && units[1].steps.size() == 3);
+        CHECK(units[1].steps.back().detail == "timeout, missing #");
+    }
+
+    // the same through the tool, results in its CSV
+    std::string csv = checkTempPath("sequencer_test.csv");
+    std::remove(csv.c_str());
+    CHECK(checkTool(argv0, "a5200test -q -r " + csv + " --sim sim/scenarios/qa_cx52.txt qa/cx52.txt") == 0);
+    std::string results = readFile(csv.c_str());
+    CHECK(results.find("sim,CX52,1,0,unit,PASS,") != std::string::npos);
+    CHECK(results.find("sim,CX52,2,0,unit,FAIL,") != std::string::npos);
+    CHECK(results.find("sim,CX52,2,3,keys,FAIL,") != std::string::npos);
+    std::remove(csv.c_str());
+}
+
+int main(int, char **argv)
+{
+    testParse();
+    testSynthetic();
+    testQa(argv[0]);
+    return checkResult("sequencer_test");
+}
@@ -0,0 +1,71 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   Scenario runs for the tests that drive the simulated board. simRun() 
+   parses a scenario (see sim/scenario.h), runs the firmware through it and
+   keeps every byte sent and every decoded record with the virtual time its
+   last byte left the UART.
+*/
+
+#ifndef A5200_SIMRUN_H
+#define A5200_SIMRUN_H
+
+#include "check.h"
+#include "decoder.h"
+#include "scenario.h"
+#include "simulator.h"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace a5200 {
+
+struct SimRecord {
+    double t;
+    Record record;        // text and trace bits cleared, they do not outlive the callback
+    std::string text;     // the line
+};
+
+struct SimRun {
+    std::string bytes;
+    std::vector<double> times;         // of each byte
+    std::vector<SimRecord> records;
+
+    // Records of a type from time t on
+    std::vector<const SimRecord *> find(RecordType type, double t = 0) const
+    {
+        std::vector<const SimRecord *> v;
+        for (const SimRecord &r : records)
+            if (r.record.type == type && r.t >= t) v.push_back(&r);
+        return v;
+    }
+};
+
+// Run a scenario for its duration, false when it does not parse
+inline bool simRun(const std::string &text, SimRun &run, const SimConfig &config = SimConfig())
+{
+    Scenario scenario;
+    if (!CHECK(scenario.parse(text))) {
+        std::fprintf(stderr, "%s\n", scenario.error().c_str());
+        return false;
+    }
+    Decoder decoder;
+    Simulator simulator(config, scenario, [&](double now, uint8_t byte) {
+        char c = static_cast<char>(byte);
+        run.bytes += c;
+        run.times.push_back(now);
+        decoder.feed(&c, 1, [&](const Record &r) {
+            run.records.push_back(SimRecord{now, r, std::string(r.text)});
+            SimRecord &s = run.records.back();
+            s.record.text = std::string_view();
+            if (r.type == RecordType::Trace) s.record.trace.bits = nullptr;
+        });
+    });
+    simulator.run(scenario.duration());
+    return true;
+}
+
+} // namespace a5200
+
+#endif // A5200_SIMRUN_H
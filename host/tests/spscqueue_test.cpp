@@ -0,0 +1,68 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   spscqueue_test - the lock-free queue and the a5200d fan-out on it
+
+   The queue is filled and drained across its wrap point on one thread, then
+   a producer and a consumer thread pass a numbered sequence through a small
+   queue, which must arrive complete and in order. Finally a5200d reads two
+   ptys fed with synthetic output and must account for every record sent.
+*/
+
+#include "check.h"
+#include "spscqueue.h"
+
+#include <cstdint>
+#include <thread>
+
+using namespace a5200;
+
+static void testSingleThread()
+{
+    SpscQueue<uint32_t, 8> q;
+    uint32_t v = 0, next = 0, expected = 0;
+    CHECK(q.empty());
+    CHECK(!q.pop(v));
+    for (int round = 0; round < 5; ++round) {
+        for (int i = 0; i < 8; ++i) CHECK(q.push(next++));
+        CHECK(!q.push(next));          // full, not queued
+        for (int i = 0; i < 5; ++i) CHECK(q.pop(v) && v == expected++);
+        for (int i = 0; i < 5; ++i) CHECK(q.push(next++));
+        while (q.pop(v)) CHECK(v == expected++);
+        CHECK(q.empty());
+    }
+    CHECK(expected == next);
+}
+
+static void testThreads()
+{
+    static SpscQueue<uint64_t, 64> q;
+    const uint64_t n = 2000000;
+    std::thread producer([] {
+        for (uint64_t i = 0; i < n;) {
+            if (q.push(i)) ++i;
+            else std::this_thread::yield();
+        }
+    });
+    uint64_t expected = 0, v;
+    bool inOrder = true;
+    while (expected < n) {
+        if (!q.pop(v)) {
+            std::this_thread::yield();
+            continue;
+        }
+        inOrder = inOrder && v == expected;
+        ++expected;
+    }
+    producer.join();
+    CHECK(inOrder);
+    CHECK(q.empty());
+}
+
+int main(int, char **argv)
+{
+    testSingleThread();
+    testThreads();
+    CHECK(checkTool(argv[0], "a5200d --pty 2 -t 1 --fast -q") == 0);
+    return checkResult("spscqueue_test");
+}
@@ -0,0 +1,137 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   trace_test - Trace files written and read back
+
+   Records over three index blocks, the last one partial, must read back
+   unchanged; each block summary is checked against the records it covers
+   and lowerBound() against a search over the records themselves.
+*/
+
+#include "check.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace a5200;
+
+static std::vector<TraceRecord> records(size_t n)
+{
+    std::vector<TraceRecord> v(n);
+    uint64_t t = 0;
+    for (size_t i = 0; i < n; ++i) {
+        TraceRecord &r = v[i];
+        std::memset(&r, 0, sizeof r);
+        t += (i % 5 == 0) ? 0 : 16683 + i % 3;   // repeated times, lowerBound() takes the first
+        r.timeUs = t;
+        r.controller = static_cast<uint8_t>(i < 6000 ? Controller::Joystick : Controller::Trackball);
+        r.potx = static_cast<uint8_t>(20 + i % 180);
+        r.poty = static_cast<uint8_t>(227 - (i * 7) % 200);
+        r.buttons = (i % 1000 == 17) ? kTraceTop : (i % 3001 == 5) ? kTraceBottom : 0;
+        r.keys = (i % 777 == 0) ? static_cast<uint16_t>(1u << (i / 777 % 15)) : 0;
+        r.flags = (i / 2048) % 2 ? kTraceLinear : 0;
+    }
+    return v;
+}
+
+static void testRoundTrip()
+{
+    const size_t n = 2 * kTraceBlockRecords + 1234;
+    std::vector<TraceRecord> v = records(n);
+    std::string path = checkTempPath("trace_test.trace");
+
+    TraceWriter w;
+    CHECK(w.open(path));
+    for (const TraceRecord &r : v) w.append(r);
+    CHECK(w.count() == n);
+    CHECK(w.close());
+
+    TraceReader t;
+    if (!CHECK(t.open(path))) {
+        std::fprintf(stderr, "%s\n", t.error().c_str());
+        std::remove(path.c_str());
+        return;
+    }
+    CHECK(t.count() == n);
+    CHECK(std::memcmp(t.records(), v.data(), n * sizeof(TraceRecord)) == 0);
+
+    CHECK(t.blockCount() == (n + kTraceBlockRecords - 1) / kTraceBlockRecords);
+    for (uint64_t b = 0; b < t.blockCount(); ++b) {
+        size_t first = b * kTraceBlockRecords, last = std::min<size_t>(n, first + kTraceBlockRecords);
+        TraceBlock e{};
+        e.firstTimeUs = v[first].timeUs;
+        e.minPotx = e.minPoty = 255;
+        for (size_t i = first; i < last; ++i) {
+            e.minPotx = std::min(e.minPotx, v[i].potx);
+            e.maxPotx = std::max(e.maxPotx, v[i].potx);
+            e.minPoty = std::min(e.minPoty, v[i].poty);
+            e.maxPoty = std::max(e.maxPoty, v[i].poty);
+            e.keys |= v[i].keys;
+            e.buttons |= v[i].buttons;
+            e.controllers |= 1u << v[i].controller;
+        }
+        const TraceBlock &g = t.blocks()[b];
+        CHECK(g.firstTimeUs == e.firstTimeUs);
+        CHECK(g.minPotx == e.minPotx && g.maxPotx == e.maxPotx);
+        CHECK(g.minPoty == e.minPoty && g.maxPoty == e.maxPoty);
+        CHECK(g.keys == e.keys);
+        CHECK(g.buttons == e.buttons);
+        CHECK(g.controllers == e.controllers);
+    }
+
+    // every record time, the microsecond before it, and past the end
+    auto expected = [&](uint64_t time) {
+        return static_cast<uint64_t>(std::lower_bound(v.begin(), v.end(), time,
+            [](const TraceRecord &r, uint64_t x) { return r.timeUs < x; }) - v.begin());
+    };
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t time = v[i].timeUs;
+        if (!CHECK(t.lowerBound(time) == expected(time))) break;
+        if (time && !CHECK(t.lowerBound(time - 1) == expected(time - 1))) break;
+    }
+    CHECK(t.lowerBound(0) == 0);
+    CHECK(t.lowerBound(v.back().timeUs + 1) == n);
+
+    t.close();
+    std::remove(path.c_str());
+}
+
+static void testRejects()
+{
+    std::string path = checkTempPath("trace_test.bad");
+    FILE *f = std::fopen(path.c_str(), "wb");
+    CHECK(f != nullptr);
+    if (!f) return;
+    std::fputs("A52TRACE but not a header", f);
+    std::fclose(f);
+
+    TraceReader t;
+    CHECK(!t.open(path));
+    CHECK(!t.error().empty());
+
+    // a valid file of another version
+    TraceWriter w;
+    CHECK(w.open(path));
+    w.append(records(1)[0]);
+    CHECK(w.close());
+    f = std::fopen(path.c_str(), "r+b");
+    CHECK(f != nullptr);
+    if (!f) return;
+    uint32_t version = kTraceVersion - 1;
+    std::fseek(f, offsetof(TraceHeader, version), SEEK_SET);
+    std::fwrite(&version, sizeof version, 1, f);
+    std::fclose(f);
+    CHECK(!t.open(path));
+    std::remove(path.c_str());
+}
+
+int main()
+{
+    testRoundTrip();
+    testRejects();
+    return checkResult("trace_test");
+}
@@ -0,0 +1,353 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   a5200batch - per unit summaries of archived captures, in parallel
+
+   usage: a5200batch [options] capture|directory...
+     -j threads              default all cores
+     --by-dir                one unit per directory of captures, otherwise one per capture
+     --csv                   CSV with every counter instead of the table
+     --anomalies             only units with detection flips, saturated readings,
+                             matrix faults or lines that did not decode
+     --x min:max --y min:max any report with the pot readings in range (as a5200query),
+                             PosX/PosY reports never match
+     --keys hhhh             any of these keys down (hex bitmap as Report::keys)
+     --top --bottom          button down
+     --joystick --trackball  controller type
+
+   Directories are searched recursively and every regular file in them is
+   taken as a capture. With a filter, only the units that have matching
+   reports are listed, with their count: "which units ever read PotY above
+   200 as a trackball" is --y 201:255 --trackball. Joystick reports with 
+   positions (PosX/PosY, a linearization table on the board) are counted with
+   the joystick reports but their ranges are kept apart from the readings and
+   they are not checked for saturation.
+
+   Each capture is read in 1MB chunks and decoded as it streams in, nothing is
+   kept but the counters of its unit. Captures are handed out largest first
+   to a work-stealing pool (lib/workpool.h), one decoder per capture, so a few
+   long burn-in logs do not hold up the thousands of short ones behind them.
+*/
+
+#include "decoder.h"
+#include "workpool.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+using namespace a5200;
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr size_t kChunk = 1 << 20;
+constexpr int kJoystick = 0, kTrackball = 1;
+
+struct Filter {
+    bool active = false;
+    bool ranges = false;       // --x or --y, readings only
+    uint8_t xmin = 0, xmax = 255, ymin = 0, ymax = 255;
+    uint16_t keys = 0;
+    bool top = false, bottom = false;
+    uint8_t controllers = 0;   // bit kJoystick / kTrackball, 0 = any
+
+    bool match(const Report &r, int controller) const
+    {
+        return (!ranges || !r.linear) && r.potx >= xmin && r.potx <= xmax && r.poty >= ymin && r.poty <= ymax &&
+               (!keys || (r.keys & keys)) && (!top || r.top) && (!bottom || r.bottom) &&
+               (!controllers || (controllers & (1u << controller)));
+    }
+};
+
+struct Range {
+    uint8_t lo = 255, hi = 0;
+
+    bool empty() const { return lo > hi; }
+    void add(uint8_t v) { lo = std::min(lo, v); hi = std::max(hi, v); }
+    void merge(const Range &o) { lo = std::min(lo, o.lo); hi = std::max(hi, o.hi); }
+};
+
+struct Summary {
+    uint64_t files = 0, bytes = 0, records = 0;
+    uint64_t reports[2] = {};            // joystick, trackball
+    Range x[2], y[2];                    // readings as each controller
+    uint64_t positions = 0;              // joystick reports with PosX/PosY
+    Range px, py;                        // and their positions
+    uint64_t keyHits[16] = {};           // presses, by bitmap position
+    uint64_t top = 0, bottom = 0;
+    uint64_t flips = 0;                  // controller type changed between reports
+    uint64_t saturated = 0;              // readings of 227, ViH never reached
+    uint64_t faults = 0;                 // matrix reports with Fault:1
+    uint64_t unknown = 0, overflows = 0; // lines that did not decode
+    uint64_t matches = 0;                // reports through the filter
+    uint64_t readErrors = 0;
+
+    uint64_t anomalies() const { return flips + saturated + faults + unknown + overflows + readErrors; }
+
+    void merge(const Summary &o)
+    {
+        files += o.files;
+        bytes += o.bytes;
+        records += o.records;
+        for (int c = 0; c < 2; ++c) {
+            reports[c] += o.reports[c];
+            x[c].merge(o.x[c]);
+            y[c].merge(o.y[c]);
+        }
+        positions += o.positions;
+        px.merge(o.px);
+        py.merge(o.py);
+        for (int k = 0; k < 16; ++k) keyHits[k] += o.keyHits[k];
+        top += o.top;
+        bottom += o.bottom;
+        flips += o.flips;
+        saturated += o.saturated;
+        faults += o.faults;
+        unknown += o.unknown;
+        overflows += o.overflows;
+        matches += o.matches;
+        readErrors += o.readErrors;
+    }
+};
+
+// State carried from one report of a capture to the next
+struct Previous {
+    bool valid = false;
+    int controller = kJoystick;
+    uint16_t keys = 0;
+    bool top = false, bottom = false;
+};
+
+void addReport(Summary &s, Previous &p, const Report &r, const Filter &f)
+{
+    int c = r.controller == Controller::Trackball ? kTrackball : kJoystick;
+    ++s.reports[c];
+    if (r.linear) {
+        ++s.positions;
+        s.px.add(r.potx);
+        s.py.add(r.poty);
+    } else {
+        s.x[c].add(r.potx);
+        s.y[c].add(r.poty);
+        s.saturated += (r.potx == 227) + (r.poty == 227);
+    }
+    if (p.valid && p.controller != c) ++s.flips;
+
+    // keys and buttons down here and not on the previous report, held at the start count once
+    for (uint16_t down = r.keys & ~p.keys; down; down &= down - 1) ++s.keyHits[__builtin_ctz(down)];
+    s.top += r.top && !p.top;
+    s.bottom += r.bottom && !p.bottom;
+    if (f.active && f.match(r, c)) ++s.matches;
+
+    p = Previous{true, c, r.keys, r.top, r.bottom};
+}
+
+// Decode one capture as it is read
+Summary analyze(const std::string &path, const Filter &f, std::vector<char> &buf)
+{
+    Summary s;
+    s.files = 1;
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::fprintf(stderr, "a5200batch: %s: %s\n", path.c_str(), std::strerror(errno));
+        s.readErrors = 1;
+        return s;
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    Decoder decoder;
+    Previous prev;
+    for (;;) {
+        ssize_t n = ::read(fd, buf.data(), buf.size());
+        if (n == 0) break;
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::fprintf(stderr, "a5200batch: %s: %s\n", path.c_str(), std::strerror(errno));
+            ++s.readErrors;
+            break;
+        }
+        s.bytes += n;
+        decoder.feed(buf.data(), n, [&](const Record &r) {
+            if (r.type == RecordType::Report) addReport(s, prev, r.report, f);
+            else if (r.type == RecordType::Matrix && r.matrix.fault) ++s.faults;
+        });
+    }
+    ::close(fd);
+    s.records = decoder.records();
+    s.unknown = decoder.unknown();
+    s.overflows = decoder.overflows();
+    return s;
+}
+
+std::string range(const Range &r)
+{
+    char buf[16];
+    if (r.empty()) return "   -   ";
+    std::snprintf(buf, sizeof buf, "%03u-%03u", r.lo, r.hi);
+    return buf;
+}
+
+void printTable(const std::map<std::string, Summary> &units, bool matches)
+{
+    std::printf("%-32s %9s  %-15s  %-15s  %-15s %7s %7s  %-15s %5s%s\n", "unit", "reports", "joystick x/y",
+                "trackball x/y", "positions x/y", "flips", "sat", "keys missing", "other", matches ? "  matches" : "");
+    for (const auto &u : units) {
+        const Summary &s = u.second;
+        std::string missing;
+        for (int k = 0; k < 15; ++k)
+            if (!s.keyHits[k]) missing += kKeyNames[k];
+        std::printf("%-32s %9llu  %s %s  %s %s  %s %s %7llu %7llu  %-15s %5llu", u.first.c_str(),
+                    (unsigned long long)(s.reports[kJoystick] + s.reports[kTrackball]), range(s.x[kJoystick]).c_str(),
+                    range(s.y[kJoystick]).c_str(), range(s.x[kTrackball]).c_str(), range(s.y[kTrackball]).c_str(),
+                    range(s.px).c_str(), range(s.py).c_str(), (unsigned long long)s.flips, (unsigned long long)s.saturated, missing.empty() ? "-" : missing.c_str(),
+                    (unsigned long long)(s.faults + s.unknown + s.overflows + s.readErrors));
+        if (matches) std::printf("  %7llu", (unsigned long long)s.matches);
+        std::printf("\n");
+    }
+}
+
+void printCsv(const std::map<std::string, Summary> &units)
+{
+    std::printf("unit,files,bytes,records,joystick,trackball,jx_min,jx_max,jy_min,jy_max,tx_min,tx_max,ty_min,ty_max,"
+                "positions,px_min,px_max,py_min,py_max,flips,saturated,faults,unknown,overflows,read_errors,matches,top,bottom");
+    for (int k = 0; k < 15; ++k) std::printf(",key_%c", kKeyNames[k]);
+    std::printf("\n");
+
+    auto ends = [](const Range &r) {
+        if (r.empty()) std::printf(",,");
+        else std::printf(",%u,%u", r.lo, r.hi);
+    };
+    for (const auto &u : units) {
+        const Summary &s = u.second;
+        std::printf("%s,%llu,%llu,%llu,%llu,%llu", u.first.c_str(), (unsigned long long)s.files,
+                    (unsigned long long)s.bytes, (unsigned long long)s.records,
+                    (unsigned long long)s.reports[kJoystick], (unsigned long long)s.reports[kTrackball]);
+        ends(s.x[kJoystick]);
+        ends(s.y[kJoystick]);
+        ends(s.x[kTrackball]);
+        ends(s.y[kTrackball]);
+        std::printf(",%llu", (unsigned long long)s.positions);
+        ends(s.px);
+        ends(s.py);
+        const uint64_t counts[] = { s.flips, s.saturated, s.faults, s.unknown, s.overflows, s.readErrors,
+                                    s.matches, s.top, s.bottom };
+        for (uint64_t c : counts) std::printf(",%llu", (unsigned long long)c);
+        for (int k = 0; k < 15; ++k) std::printf(",%llu", (unsigned long long)s.keyHits[k]);
+        std::printf("\n");
+    }
+}
+
+bool parseRange(const char *s, uint8_t &lo, uint8_t &hi)
+{
+    unsigned a, b;
+    if (std::sscanf(s, "%u:%u", &a, &b) != 2 || a > 255 || b > 255) return false;
+    lo = static_cast<uint8_t>(a);
+    hi = static_cast<uint8_t>(b);
+    return true;
+}
+
+int usage()
+{
+    std::fprintf(stderr, "usage: a5200batch [-j threads] [--by-dir] [--csv] [--anomalies] [--x min:max] [--y min:max]\n"
+                         "                  [--keys hhhh] [--top] [--bottom] [--joystick] [--trackball]\n"
+                         "                  capture|directory...\n");
+    return 1;
+}
+
+struct Capture {
+    std::string path, unit;
+    uint64_t size;
+};
+
+} // namespace
+
+
+int main(int argc, char **argv)
+{
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    bool byDir = false, csv = false, anomalies = false;
+    Filter f;
+    std::vector<std::string> inputs;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "-j" && more) threads = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--by-dir") byDir = true;
+        else if (a == "--csv") csv = true;
+        else if (a == "--anomalies") anomalies = true;
+        else if (a == "--x" && more) { if (!parseRange(argv[++i], f.xmin, f.xmax)) return usage(); f.active = f.ranges = true; }
+        else if (a == "--y" && more) { if (!parseRange(argv[++i], f.ymin, f.ymax)) return usage(); f.active = f.ranges = true; }
+        else if (a == "--keys" && more) { f.keys = static_cast<uint16_t>(std::strtoul(argv[++i], nullptr, 16)); f.active = true; }
+        else if (a == "--top") f.top = f.active = true;
+        else if (a == "--bottom") f.bottom = f.active = true;
+        else if (a == "--joystick") { f.controllers |= 1u << kJoystick; f.active = true; }
+        else if (a == "--trackball") { f.controllers |= 1u << kTrackball; f.active = true; }
+        else if (a[0] != '-') inputs.push_back(a);
+        else return usage();
+    }
+    if (inputs.empty()) return usage();
+
+    std::vector<Capture> captures;
+    auto add = [&](const fs::path &p) {
+        std::error_code ec;
+        uint64_t size = fs::file_size(p, ec);
+        std::string unit = byDir ? p.parent_path().string() : p.string();
+        captures.push_back(Capture{p.string(), unit.empty() ? "." : unit, ec ? 0 : size});
+    };
+    for (const std::string &in : inputs) {
+        std::error_code ec;
+        if (fs::is_directory(in, ec)) {
+            for (fs::recursive_directory_iterator it(in, ec), end; !ec && it != end; it.increment(ec))
+                if (it->is_regular_file(ec)) add(it->path());
+        } else if (fs::exists(in, ec)) {
+            add(in);
+        }
+        if (ec || !fs::exists(in)) {
+            std::fprintf(stderr, "a5200batch: %s: %s\n", in.c_str(), ec ? ec.message().c_str() : "not found");
+            return 1;
+        }
+    }
+    std::stable_sort(captures.begin(), captures.end(),
+                     [](const Capture &a, const Capture &b) { return a.size > b.size; });
+
+    auto t0 = std::chrono::steady_clock::now();
+    WorkPool pool(std::min<unsigned>(threads, std::max<size_t>(1, captures.size())));
+    std::vector<std::vector<char>> buffers(pool.threads(), std::vector<char>(kChunk));
+    std::vector<Summary> results(captures.size());
+    pool.run(captures.size(), [&](size_t i, unsigned worker) {
+        results[i] = analyze(captures[i].path, f, buffers[worker]);
+    });
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    std::map<std::string, Summary> units;
+    Summary total;
+    for (size_t i = 0; i < captures.size(); ++i) {
+        units[captures[i].unit].merge(results[i]);
+        total.merge(results[i]);
+    }
+    for (auto it = units.begin(); it != units.end();) {
+        bool keep = (!f.active || it->second.matches) && (!anomalies || it->second.anomalies());
+        it = keep ? std::next(it) : units.erase(it);
+    }
+
+    if (csv) printCsv(units);
+    else printTable(units, f.active);
+
+    std::fprintf(stderr, "a5200batch: %zu captures, %zu units listed, %llu records, %.1f MB in %.2fs (%.0f MB/s) "
+                 "on %u threads, %llu steals\n", captures.size(), units.size(), (unsigned long long)total.records,
+                 total.bytes / 1e6, seconds, seconds > 0 ? total.bytes / 1e6 / seconds : 0.0, pool.threads(),
+                 (unsigned long long)pool.steals());
+    return total.readErrors ? 1 : 0;
+}
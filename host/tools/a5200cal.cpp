@@ -0,0 +1,287 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   a5200cal - stick linearization tables (see lib/calibration.h)
+
+   usage: a5200cal sweep [-t seconds] [--cav V] [-o table.cal] port|capture
+          a5200cal points [--cav V] [-o table.cal] jig.csv
+          a5200cal show table.cal
+          a5200cal apply table.cal capture
+          a5200cal upload table.cal port
+
+   sweep   guided sweep on a port: leave the stick released for the first 
+           reports, then sweep it around its full circle until the time is up
+           (default 15s). A capture of the same sequence works too.
+   points  fit from jig positions, lines "axis,percent,reading" (x,50,112)
+   show    breakpoints and the position of every 16th reading
+   apply   positions of every joystick report of a capture, as CSV
+   upload  store the table in the board's EEPROM, one byte per ack from the
+           board; it then reports PosX/PosY
+           (serial command 'u' switches between positions and raw readings)
+*/
+
+#include "calibration.h"
+#include "decoder.h"
+#include "serial.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <poll.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace a5200;
+
+namespace {
+
+constexpr double kSweepSeconds = 15.0;
+constexpr double kReplySeconds = 3.0;    // table upload and EEPROM write
+constexpr double kAckSeconds = 0.5;      // "[Cal] Load " after a report, '.' for each byte
+
+int usage()
+{
+    std::fprintf(stderr, "usage: a5200cal sweep [-t seconds] [--cav V] [-o table.cal] port|capture\n"
+                         "       a5200cal points [--cav V] [-o table.cal] jig.csv\n"
+                         "       a5200cal show table.cal\n"
+                         "       a5200cal apply table.cal capture\n"
+                         "       a5200cal upload table.cal port\n");
+    return 1;
+}
+
+// Open a port or a capture, live tells which
+int openInput(const char *path, bool &live)
+{
+    struct stat st;
+    if (stat(path, &st) < 0) return -1;
+    live = S_ISCHR(st.st_mode);
+    return live ? openSerial(path) : ::open(path, O_RDONLY | O_CLOEXEC);
+}
+
+// Decode fd until EOF, Ctrl-C or the time is up (live input only)
+template <typename F>
+void readRecords(int fd, bool live, double seconds, F &&onRecord)
+{
+    Decoder decoder;
+    char buf[4096];
+    auto t0 = std::chrono::steady_clock::now();
+    for (;;) {
+        double now = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if (live && now >= seconds) break;
+        if (live) {
+            pollfd p{fd, POLLIN, 0};
+            if (poll(&p, 1, 100) <= 0) continue;
+        }
+        ssize_t n = ::read(fd, buf, sizeof buf);
+        if (n == 0) break;
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) continue;
+            break;
+        }
+        bool stop = false;
+        decoder.feed(buf, n, [&](const Record &r) { stop = onRecord(now, r) || stop; });
+        if (stop) break;
+    }
+}
+
+void printTable(const CalTable &t)
+{
+    for (int a = 0; a < 2; ++a) {
+        std::printf("%c  ", a ? 'y' : 'x');
+        for (int i = 0; i < kCalPoints; ++i) std::printf(" %3u", t.axis[a][i]);
+        std::printf("\n");
+    }
+}
+
+int finish(const CalFit &fit, const char *out)
+{
+    CalTable table;
+    std::string error;
+    if (!fit.fit(table, error)) {
+        std::fprintf(stderr, "a5200cal: %s\n", error.c_str());
+        return 1;
+    }
+    for (int a = 0; a < 2; ++a) {
+        std::printf("%c anchors:", a ? 'y' : 'x');
+        for (const CalAnchor &p : fit.anchors(a)) std::printf(" %.0f@%.0f", p.reading, p.position);
+        std::printf("\n");
+    }
+    std::printf("breakpoints at positions 0, 32 .. 256:\n");
+    printTable(table);
+    if (out && !table.save(out)) {
+        std::perror(out);
+        return 1;
+    }
+    return 0;
+}
+
+int sweep(int argc, char **argv)
+{
+    double seconds = kSweepSeconds, cav = 5.0;
+    const char *out = nullptr, *path = nullptr;
+    for (int i = 0; i < argc; ++i) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "-t" && more) seconds = std::atof(argv[++i]);
+        else if (a == "--cav" && more) cav = std::atof(argv[++i]);
+        else if (a == "-o" && more) out = argv[++i];
+        else if (a[0] != '-' && !path) path = argv[i];
+        else return usage();
+    }
+    if (!path) return usage();
+
+    bool live;
+    int fd = openInput(path, live);
+    if (fd < 0) {
+        std::perror(path);
+        return 1;
+    }
+    CalFit fit(PotModel(), cav);
+    if (live) std::printf("Leave the stick released...\n");
+    readRecords(fd, live, seconds, [&](double, const Record &r) {
+        if (r.type != RecordType::Report) return false;
+        fit.addSweep(r.report);
+        if (live && fit.sweepReports() == kCalCenterReports)
+            std::printf("Now sweep the stick slowly around its full circle, several times\n");
+        std::fflush(stdout);
+        return false;
+    });
+    ::close(fd);
+    std::printf("%zu joystick reports\n", fit.sweepReports());
+    return finish(fit, out);
+}
+
+int points(int argc, char **argv)
+{
+    double cav = 5.0;
+    const char *out = nullptr, *path = nullptr;
+    for (int i = 0; i < argc; ++i) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "--cav" && more) cav = std::atof(argv[++i]);
+        else if (a == "-o" && more) out = argv[++i];
+        else if (a[0] != '-' && !path) path = argv[i];
+        else return usage();
+    }
+    if (!path) return usage();
+
+    std::ifstream in(path);
+    if (!in) {
+        std::perror(path);
+        return 1;
+    }
+    CalFit fit(PotModel(), cav);
+    std::string line;
+    while (std::getline(in, line)) {
+        char axis;
+        double percent, reading;
+        if (std::sscanf(line.c_str(), " %c,%lf,%lf", &axis, &percent, &reading) != 3) continue;
+        if (axis == 'x' || axis == 'y') fit.addPoint(axis == 'y', percent, reading);
+    }
+    return finish(fit, out);
+}
+
+int show(const CalTable &t)
+{
+    printTable(t);
+    std::printf("\nreading  x    y\n");
+    for (int r = 0; r < 228; r += 16)
+        std::printf("%5d  %3u  %3u\n", r, t.position(0, r), t.position(1, r));
+    return 0;
+}
+
+int apply(const CalTable &t, const char *path)
+{
+    bool live;
+    int fd = openInput(path, live);
+    if (fd < 0) {
+        std::perror(path);
+        return 1;
+    }
+    std::printf("potx,poty,posx,posy\n");
+    readRecords(fd, live, 1e9, [&](double, const Record &r) {
+        if (r.type == RecordType::Report && r.report.controller == Controller::Joystick && !r.report.linear)
+            std::printf("%u,%u,%u,%u\n", r.report.potx, r.report.poty, t.position(0, r.report.potx),
+                        t.position(1, r.report.poty));
+        return false;
+    });
+    ::close(fd);
+    return 0;
+}
+
+// Read raw bytes until the received text ends with want, false on timeout
+bool waitFor(int fd, const std::string &want, double seconds)
+{
+    std::string seen;
+    auto t0 = std::chrono::steady_clock::now();
+    while (seen.size() < want.size() || seen.compare(seen.size() - want.size(), want.size(), want) != 0) {
+        double now = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if (now >= seconds) return false;
+        pollfd p{fd, POLLIN, 0};
+        if (poll(&p, 1, 10) <= 0) continue;
+        char c;
+        if (::read(fd, &c, 1) == 1) seen += c;
+    }
+    return true;
+}
+
+// One byte at a time, each after the firmware's '.' for the one before: the 
+// board has a 2 byte receive FIFO and stops reading while it sends a report
+int upload(const CalTable &t, const char *path)
+{
+    int fd = openSerial(path);
+    if (fd < 0) {
+        std::perror(path);
+        return 1;
+    }
+    setLowLatency(fd);
+    std::string bytes = t.upload();
+    for (size_t i = 0; i < bytes.size(); ++i) {
+        ssize_t n;
+        while ((n = ::write(fd, &bytes[i], 1)) < 0 && (errno == EAGAIN || errno == EINTR)) {}
+        if (n < 0) {
+            std::perror(path);
+            return 1;
+        }
+        if (!waitFor(fd, i ? "." : "[Cal] Load ", kAckSeconds)) {
+            std::printf("no answer to byte %zu\n", i);
+            ::close(fd);
+            return 1;
+        }
+    }
+    std::string reply;
+    readRecords(fd, true, kReplySeconds, [&](double, const Record &r) {
+        if (r.type == RecordType::Status && r.text.compare(0, 5, "[Cal]") == 0) reply = r.text;
+        return !reply.empty();
+    });
+    ::close(fd);
+    if (reply.empty()) reply = "no reply";
+    std::printf("%s\n", reply.c_str());
+    return reply.compare(0, 11, "[Cal] Saved") == 0 ? 0 : 1;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) return usage();
+    std::string cmd = argv[1];
+    if (cmd == "sweep") return sweep(argc - 2, argv + 2);
+    if (cmd == "points") return points(argc - 2, argv + 2);
+
+    CalTable table;
+    std::string error;
+    if (!table.load(argv[2], error)) {
+        std::fprintf(stderr, "a5200cal: %s\n", error.c_str());
+        return 1;
+    }
+    if (cmd == "show" && argc == 3) return show(table);
+    if (cmd == "apply" && argc == 4) return apply(table, argv[3]);
+    if (cmd == "upload" && argc == 4) return upload(table, argv[3]);
+    return usage();
+}
@@ -0,0 +1,473 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   a5200d - acquisition daemon for many emulator boards
+
+   usage: a5200d [-t seconds] [-l log.csv] [-q] device...
+          a5200d --pty n [-t seconds] [-l log.csv] [-q] [--fast]
+
+   All serial ports are read by a single thread with epoll and decoded as they
+   arrive. Every record is published, without locks, to one single producer /
+   single consumer queue per consumer thread:
+
+     logger   - CSV line per record (time_ns,device,type,...) to the -l file;
+                reports end with pot (readings) or pos (PosX/PosY positions)
+     display  - once a second, one status line per device on stderr (-q turns it off)
+     checker  - per device pass/fail at exit: no unrecognized lines, no 
+                joystick/trackball detection flips, no saturated readings
+
+   A consumer that falls behind loses records (counted) instead of stalling
+   the reader. With --pty the daemon creates n pseudo terminals and feeds 
+   them with synthetic firmware output, paced at 9600bps unless --fast, so it
+   can be exercised without any hardware.
+*/
+
+#include "decoder.h"
+#include "serial.h"
+#include "spscqueue.h"
+#include "synthetic.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <string>
+#include <sys/epoll.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace a5200;
+
+namespace {
+
+std::atomic<bool> stopping{false};   // reader and feeder stop
+std::atomic<bool> drained{false};    // both have stopped, consumers finish their queues
+
+void onSignal(int) { stopping = true; }
+
+uint64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Sample {
+    uint64_t timeNs;     // when the chunk holding the end of the record was read
+    uint16_t device;
+    Record record;       // text and trace bits are cleared, they do not outlive the read buffer
+};
+
+using Queue = SpscQueue<Sample, 4096>;
+
+struct Device {
+    std::string path;
+    int fd = -1;
+    Decoder decoder;
+    uint64_t bytes = 0;
+    uint64_t expected = 0;   // records written by the pty feeder
+};
+
+// Consumer thread fed by its own queue
+class Consumer {
+public:
+    explicit Consumer(const char *name) : name_(name) {}
+    virtual ~Consumer() = default;
+
+    void publish(const Sample &s)
+    {
+        if (!queue_.push(s)) ++drops_;
+    }
+
+    void start() { thread_ = std::thread([this] { run(); }); }
+    void join() { thread_.join(); }
+
+    const char *name() const { return name_; }
+    uint64_t drops() const { return drops_; }
+
+protected:
+    virtual void handle(const Sample &s) = 0;
+    virtual void idle(uint64_t) {}
+    virtual void finish() {}
+
+private:
+    void run()
+    {
+        Sample s;
+        for (;;) {
+            bool any = false;
+            while (queue_.pop(s)) {
+                handle(s);
+                any = true;
+            }
+            idle(nowNs());
+            if (!any) {
+                if (drained && queue_.empty()) break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        finish();
+    }
+
+    const char *name_;
+    Queue queue_;
+    std::atomic<uint64_t> drops_{0};
+    std::thread thread_;
+};
+
+
+class Logger : public Consumer {
+public:
+    explicit Logger(FILE *out) : Consumer("logger"), out_(out) {}
+
+protected:
+    void handle(const Sample &s) override
+    {
+        const Record &r = s.record;
+        std::fprintf(out_, "%llu,%u,", (unsigned long long)s.timeNs, s.device);
+        switch (r.type) {
+        case RecordType::Report:
+            std::fprintf(out_, "report,%c,%u,%u,%u,%u,%04x,%s\n",
+                         r.report.controller == Controller::Trackball ? 'T' : 'J', r.report.potx,
+                         r.report.poty, r.report.top, r.report.bottom, r.report.keys,
+                         r.report.linear ? "pos" : "pot");
+            break;
+        case RecordType::Event:
+            std::fprintf(out_, "event,%c,%c\n", r.event.name, r.event.pressed ? '+' : '-');
+            break;
+        case RecordType::Matrix:
+            std::fprintf(out_, "matrix,%04x,%u,%u,%u,%u\n", r.matrix.keys, r.matrix.count, r.matrix.max,
+                         r.matrix.ghost, r.matrix.fault);
+            break;
+        case RecordType::Latency:
+            std::fprintf(out_, "latency,%u,%u,%u,%u\n", r.latency.offX, r.latency.offY, r.latency.onX,
+                         r.latency.onY);
+            break;
+        case RecordType::VelocitySample:
+            std::fprintf(out_, "velocity,%u,%d,%d\n", r.sample.frame, r.sample.x, r.sample.y);
+            break;
+        case RecordType::Soak:
+            std::fprintf(out_, "soak,%u,%u,%u,%u,%u,%u,%u,%u\n", r.soak.minutes, r.soak.frames, r.soak.range,
+                         r.soak.sat, r.soak.flips, r.soak.glitches, r.soak.driftX, r.soak.driftY);
+            break;
+        case RecordType::Button:
+            std::fprintf(out_, "button,%c,%u,%u,%u,%u,%u\n", r.button.name, r.button.held, r.button.down,
+                         r.button.downEdges, r.button.up, r.button.upEdges);
+            break;
+        case RecordType::Trace:
+            std::fprintf(out_, "trace,%u,%u,%u,%u\n", r.trace.potx, r.trace.poty, r.trace.edgesX, r.trace.edgesY);
+            break;
+        case RecordType::Settle:
+            std::fprintf(out_, "settle,%04x,%u,%u,%u,%u,%u\n", r.settle.keys, r.settle.lines[0],
+                         r.settle.lines[1], r.settle.lines[2], r.settle.lines[3], r.settle.dwell);
+            break;
+        case RecordType::Profile:
+            std::fprintf(out_, "profile,%u,%u,%u,%u,%u,%u,%u,%u,%u\n", r.profile.ms,
+                         r.profile.permille[PhaseMeasure], r.profile.permille[PhaseScan],
+                         r.profile.permille[PhaseDelay], r.profile.permille[PhaseTx],
+                         r.profile.permille[PhaseOther], r.profile.frames, r.profile.overruns,
+                         r.profile.maxFrame);
+            break;
+        default:
+            std::fprintf(out_, "other,%u\n", static_cast<unsigned>(r.type));
+            break;
+        }
+    }
+
+    void finish() override { std::fflush(out_); }
+
+private:
+    FILE *out_;
+};
+
+
+class Display : public Consumer {
+public:
+    Display(const std::vector<std::unique_ptr<Device>> &devices)
+        : Consumer("display"), devices_(devices), last_(devices.size()), counts_(devices.size()) {}
+
+protected:
+    void handle(const Sample &s) override
+    {
+        ++counts_[s.device];
+        if (s.record.type == RecordType::Report) last_[s.device] = s.record.report;
+    }
+
+    void idle(uint64_t now) override
+    {
+        if (now < next_) return;
+        if (next_ == 0) {
+            next_ = now + 1000000000ull;
+            return;
+        }
+        next_ += 1000000000ull;
+        for (size_t i = 0; i < last_.size(); ++i) {
+            const Report &r = last_[i];
+            std::fprintf(stderr, "%-16s %5llu rec/s  %c X:%03u Y:%03u T:%u B:%u K:%04x%s\n",
+                         devices_[i]->path.c_str(), (unsigned long long)counts_[i],
+                         r.controller == Controller::Trackball ? 'T' : 'J', r.potx, r.poty, r.top,
+                         r.bottom, r.keys, r.linear ? " Pos" : "");
+            counts_[i] = 0;
+        }
+    }
+
+private:
+    const std::vector<std::unique_ptr<Device>> &devices_;
+    std::vector<Report> last_;
+    std::vector<uint64_t> counts_;
+    uint64_t next_ = 0;
+};
+
+
+class Checker : public Consumer {
+public:
+    Checker(const std::vector<std::unique_ptr<Device>> &devices)
+        : Consumer("checker"), devices_(devices), units_(devices.size()) {}
+
+    bool passed() const { return passed_; }
+
+protected:
+    void handle(const Sample &s) override
+    {
+        Unit &u = units_[s.device];
+        ++u.records;
+        if (s.record.type == RecordType::Unknown) ++u.unknown;
+        if (s.record.type != RecordType::Report) return;
+
+        const Report &r = s.record.report;
+        if (u.reports++ && r.controller != u.controller) ++u.flips;
+        u.controller = r.controller;
+        if (r.linear) return;   // positions, the range checks are for readings
+        if (r.potx == 227 || r.poty == 227) ++u.saturated;
+        else if (r.potx < 10 || r.potx > 190 || r.poty < 10 || r.poty > 190) ++u.range;
+    }
+
+    void finish() override
+    {
+        for (size_t i = 0; i < units_.size(); ++i) {
+            const Unit &u = units_[i];
+            const Device &d = *devices_[i];
+            bool pass = u.unknown == 0 && u.flips == 0 && u.saturated == 0 && u.reports > 0;
+            if (d.expected && u.records + d.decoder.overflows() != d.expected) pass = false;
+            passed_ = passed_ && pass;
+            std::printf("%s %s: %llu records, %llu reports, %llu unknown, %llu flips, %llu saturated, "
+                        "%llu out of range",
+                        pass ? "PASS" : "FAIL", d.path.c_str(), (unsigned long long)u.records,
+                        (unsigned long long)u.reports, (unsigned long long)u.unknown,
+                        (unsigned long long)u.flips, (unsigned long long)u.saturated,
+                        (unsigned long long)u.range);
+            if (d.expected) std::printf(", %llu sent", (unsigned long long)d.expected);
+            std::printf("\n");
+        }
+    }
+
+private:
+    struct Unit {
+        uint64_t records = 0, reports = 0, unknown = 0, flips = 0, saturated = 0, range = 0;
+        Controller controller = Controller::Unknown;
+    };
+
+    const std::vector<std::unique_ptr<Device>> &devices_;
+    std::vector<Unit> units_;
+    bool passed_ = true;
+};
+
+
+// Feed pty masters with synthetic output of a good unit, ~9600bps each unless fast 
+void feedPtys(std::vector<int> masters, std::vector<std::unique_ptr<Device>> *devices, bool fast,
+              double seconds)
+{
+    const double bytesPerMs = 1.0 / (kByteSeconds * 1000.0);
+    std::mt19937 rng(5200);
+    std::vector<std::string> pending(masters.size());
+    std::vector<size_t> sent(masters.size());      // offset in pending[]
+    std::vector<size_t> written(masters.size());   // total bytes written
+    auto t0 = std::chrono::steady_clock::now();
+
+    while (!stopping) {
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        if (ms > seconds * 1000.0) break;
+
+        for (size_t i = 0; i < masters.size(); ++i) {
+            std::string &p = pending[i];
+            while (p.size() - sent[i] < 256) {
+                if (sent[i] > 4096) {
+                    p.erase(0, sent[i]);
+                    sent[i] = 0;
+                }
+                // one unit per pty, readings inside the expected range
+                Report r = randomReport(rng);
+                r.controller = (i & 1) ? Controller::Trackball : Controller::Joystick;
+                r.potx = static_cast<uint8_t>(10 + rng() % 181);
+                r.poty = static_cast<uint8_t>(10 + rng() % 181);
+                appendReport(p, r);
+                ++(*devices)[i]->expected;
+            }
+            size_t budget = p.size() - sent[i];
+            if (!fast) {
+                size_t due = static_cast<size_t>(ms * bytesPerMs);
+                budget = due > written[i] ? std::min(budget, due - written[i]) : 0;
+            }
+            if (budget == 0) continue;
+            ssize_t n = ::write(masters[i], p.data() + sent[i], budget);
+            if (n > 0) {
+                sent[i] += n;
+                written[i] += n;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(fast ? 0 : 5));
+    }
+
+    // records still buffered in pending[] were counted but not sent
+    for (size_t i = 0; i < masters.size(); ++i) {
+        const std::string &p = pending[i];
+        for (size_t k = sent[i]; k < p.size(); ++k)
+            if (p[k] == '\n') --(*devices)[i]->expected;
+    }
+}
+
+
+int usage()
+{
+    std::fprintf(stderr, "usage: a5200d [-t seconds] [-l log.csv] [-q] device...\n"
+                         "       a5200d --pty n [-t seconds] [-l log.csv] [-q] [--fast]\n");
+    return 1;
+}
+
+} // namespace
+
+
+int main(int argc, char **argv)
+{
+    double seconds = 0;
+    const char *logPath = nullptr;
+    bool quiet = false, fast = false;
+    int ptys = 0;
+    std::vector<std::unique_ptr<Device>> devices;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "-t" && i + 1 < argc) seconds = std::atof(argv[++i]);
+        else if (a == "-l" && i + 1 < argc) logPath = argv[++i];
+        else if (a == "-q") quiet = true;
+        else if (a == "--fast") fast = true;
+        else if (a == "--pty" && i + 1 < argc) ptys = std::atoi(argv[++i]);
+        else if (a[0] == '-') return usage();
+        else {
+            devices.emplace_back(new Device);
+            devices.back()->path = a;
+        }
+    }
+    if (devices.empty() && ptys <= 0) return usage();
+    if (ptys > 0 && seconds <= 0) seconds = 5;
+
+    std::vector<int> masters;
+    for (int i = 0; i < ptys; ++i) {
+        int m = posix_openpt(O_RDWR | O_NOCTTY);
+        if (m < 0 || grantpt(m) < 0 || unlockpt(m) < 0) {
+            std::perror("a5200d: pty");
+            return 1;
+        }
+        masters.push_back(m);
+        devices.emplace_back(new Device);
+        devices.back()->path = ptsname(m);
+    }
+
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    if (ep < 0) {
+        std::perror("a5200d: epoll");
+        return 1;
+    }
+    for (size_t i = 0; i < devices.size(); ++i) {
+        Device &d = *devices[i];
+        d.fd = openSerial(d.path.c_str());
+        if (d.fd < 0) {
+            std::fprintf(stderr, "a5200d: %s: %s\n", d.path.c_str(), std::strerror(errno));
+            return 1;
+        }
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.u32 = static_cast<uint32_t>(i);
+        if (epoll_ctl(ep, EPOLL_CTL_ADD, d.fd, &ev) < 0) {
+            std::fprintf(stderr, "a5200d: %s: %s\n", d.path.c_str(), std::strerror(errno));
+            return 1;
+        }
+    }
+
+    FILE *log = nullptr;
+    if (logPath) {
+        log = std::fopen(logPath, "w");
+        if (!log) {
+            std::perror(logPath);
+            return 1;
+        }
+        std::setvbuf(log, nullptr, _IOFBF, 1 << 16);
+    }
+
+    std::vector<std::unique_ptr<Consumer>> consumers;
+    if (log) consumers.emplace_back(new Logger(log));
+    if (!quiet) consumers.emplace_back(new Display(devices));
+    Checker *checker = new Checker(devices);
+    consumers.emplace_back(checker);
+    for (auto &c : consumers) c->start();
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    std::thread feeder;
+    if (!masters.empty()) feeder = std::thread(feedPtys, masters, &devices, fast, seconds);
+
+    // reader: one thread, every port
+    uint64_t deadline = seconds > 0 ? nowNs() + static_cast<uint64_t>(seconds * 1e9) : 0;
+    size_t open = devices.size();
+    char buf[4096];
+    epoll_event events[32];
+    while (!stopping && open > 0) {
+        if (deadline && nowNs() >= deadline) {
+            if (masters.empty()) break;
+            if (feeder.joinable()) feeder.join();   // drain what the feeder wrote
+            deadline = nowNs() + 200000000ull;
+            masters.clear();
+        }
+        int n = epoll_wait(ep, events, 32, 100);
+        if (n < 0 && errno != EINTR) {
+            std::perror("a5200d: epoll_wait");
+            break;
+        }
+        for (int k = 0; k < n; ++k) {
+            uint16_t id = static_cast<uint16_t>(events[k].data.u32);
+            Device &d = *devices[id];
+            ssize_t len = ::read(d.fd, buf, sizeof buf);
+            if (len <= 0) {
+                if (len < 0 && (errno == EAGAIN || errno == EINTR)) continue;
+                epoll_ctl(ep, EPOLL_CTL_DEL, d.fd, nullptr);
+                --open;
+                continue;
+            }
+            d.bytes += len;
+            uint64_t t = nowNs();
+            d.decoder.feed(buf, len, [&](const Record &r) {
+                Sample s{t, id, r};
+                s.record.text = std::string_view();
+                if (r.type == RecordType::Trace) s.record.trace.bits = nullptr;
+                for (auto &c : consumers) c->publish(s);
+            });
+        }
+    }
+
+    // the feeder settles Device::expected before the checker reads it
+    stopping = true;
+    if (feeder.joinable()) feeder.join();
+    drained = true;
+    for (auto &c : consumers) c->join();
+    for (auto &c : consumers)
+        if (c->drops()) std::fprintf(stderr, "a5200d: %s dropped %llu records\n", c->name(),
+                                     (unsigned long long)c->drops());
+    if (log) std::fclose(log);
+    return checker->passed() ? 0 : 2;
+}
@@ -0,0 +1,443 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   a5200dash - live terminal dashboard
+
+   usage: a5200dash port|capture|-
+          a5200dash --synth reports_per_second
+
+   Shows the stick position on a grid, the keypad and fire buttons, the 
+   controller type and statistics over the last few seconds, on an 80x24 ANSI
+   terminal; q or Ctrl-C quits. A capture is replayed at 9600bps. --synth
+   feeds the decoder with a moving synthetic controller at the given report
+   rate, to check the load (the cpu figure is the dashboard's own).
+
+   The screen is composed into a cell buffer and compared with what the 
+   terminal already shows, at most kFps times a second and only when a record
+   arrived; only changed cells are sent, with cursor jumps between them. A 
+   report that moves the stick one step costs a few dozen bytes and no redraw.
+*/
+
+#include "decoder.h"
+#include "serial.h"
+#include "synthetic.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <poll.h>
+#include <string>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace a5200;
+
+namespace {
+
+constexpr int kRows = 24, kCols = 80;
+constexpr int kFps = 30;
+constexpr double kWindow = 5.0;           // seconds of rolling statistics
+constexpr int kBuckets = 50;              // the window in slices, so a report costs the same at any rate
+constexpr int kGridW = 39, kGridH = 15;   // stick grid inside its frame
+constexpr int kGridX = 2, kGridY = 3;     // top left of the grid
+constexpr size_t kEventLines = 6;
+
+volatile sig_atomic_t stopping = 0;
+
+void onSignal(int) { stopping = 1; }
+
+double seconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Character cells, the attribute is reverse video on/off
+class Screen {
+public:
+    Screen() : next_(kRows * kCols, Cell{' ', false}), shown_(kRows * kCols, Cell{'\0', false}) {}
+
+    void clear() { std::fill(next_.begin(), next_.end(), Cell{' ', false}); }
+
+    void put(int row, int col, char c, bool reverse = false)
+    {
+        if (row >= 0 && row < kRows && col >= 0 && col < kCols) next_[row * kCols + col] = Cell{c, reverse};
+    }
+
+    void text(int row, int col, const char *s, bool reverse = false)
+    {
+        for (; *s; ++s) put(row, col++, *s, reverse);
+    }
+
+    template <typename... A>
+    void print(int row, int col, const char *fmt, A... args)
+    {
+        char buf[kCols + 1];
+        std::snprintf(buf, sizeof buf, fmt, args...);
+        text(row, col, buf);
+    }
+
+    // Send the cells that differ from the terminal, returns the bytes written
+    size_t flush(int fd)
+    {
+        out_.clear();
+        int cursor = -1;          // cell the terminal cursor is on
+        bool reverse = false;
+        for (int i = 0; i < kRows * kCols; ++i) {
+            if (next_[i] == shown_[i]) continue;
+            if (i != cursor) {
+                char buf[16];
+                int n = std::snprintf(buf, sizeof buf, "\x1b[%d;%dH", i / kCols + 1, i % kCols + 1);
+                out_.append(buf, n);
+            }
+            if (next_[i].reverse != reverse) {
+                reverse = next_[i].reverse;
+                out_ += reverse ? "\x1b[7m" : "\x1b[0m";
+            }
+            out_ += next_[i].c;
+            shown_[i] = next_[i];
+            cursor = (i % kCols == kCols - 1) ? -1 : i + 1;   // no reliance on autowrap
+        }
+        if (reverse) out_ += "\x1b[0m";
+        for (size_t done = 0; done < out_.size();) {
+            ssize_t n = ::write(fd, out_.data() + done, out_.size() - done);
+            if (n < 0 && errno != EINTR && errno != EAGAIN) break;
+            if (n > 0) done += n;
+        }
+        return out_.size();
+    }
+
+private:
+    struct Cell {
+        char c;
+        bool reverse;
+        bool operator==(const Cell &o) const { return c == o.c && reverse == o.reverse; }
+    };
+
+    std::vector<Cell> next_, shown_;
+    std::string out_;
+};
+
+// Reports of one slice of the window
+struct Bucket {
+    int64_t slice = -1;
+    uint32_t n = 0;
+    uint8_t x0 = 255, x1 = 0, y0 = 255, y1 = 0;
+    double sx = 0, sy = 0, qx = 0, qy = 0;
+
+    void add(uint8_t x, uint8_t y)
+    {
+        ++n;
+        x0 = std::min(x0, x); x1 = std::max(x1, x);
+        y0 = std::min(y0, y); y1 = std::max(y1, y);
+        sx += x; sy += y; qx += x * x; qy += y * y;
+    }
+
+    void merge(const Bucket &b)
+    {
+        n += b.n;
+        x0 = std::min(x0, b.x0); x1 = std::max(x1, b.x1);
+        y0 = std::min(y0, b.y0); y1 = std::max(y1, b.y1);
+        sx += b.sx; sy += b.sy; qx += b.qx; qy += b.qy;
+    }
+};
+
+class Dashboard {
+public:
+    explicit Dashboard(std::string source) : source_(std::move(source)) {}
+
+    void record(double t, const Record &r)
+    {
+        ++records_;
+        dirty_ = true;
+        if (r.type == RecordType::Report) {
+            last_ = r.report;
+            haveReport_ = true;
+            int64_t slice = static_cast<int64_t>(t * kBuckets / kWindow);
+            Bucket &b = buckets_[slice % kBuckets];
+            if (b.slice != slice) b = Bucket{slice};
+            b.add(r.report.potx, r.report.poty);
+        } else if (r.type == RecordType::Event) {
+            char line[32];
+            std::snprintf(line, sizeof line, "%8.2f  %c %s", t - start_, r.event.name,
+                          r.event.pressed ? "pressed" : "released");
+            events_.push_back(line);
+            if (events_.size() > kEventLines) events_.pop_front();
+            ++eventCount_;
+        } else if (r.type == RecordType::Unknown) {
+            ++unknown_;
+        }
+    }
+
+    void setStart(double t) { start_ = t; }
+    void touch() { dirty_ = true; }
+    bool dirty() const { return dirty_; }
+
+    void draw(Screen &s, double t, double cpu, uint64_t bytesOut)
+    {
+        int64_t now = static_cast<int64_t>(t * kBuckets / kWindow);
+        window_ = Bucket{};
+        for (const Bucket &b : buckets_)
+            if (b.slice > now - kBuckets) window_.merge(b);
+        dirty_ = false;
+        s.clear();
+
+        s.print(0, 0, " a5200dash  %-30.30s  %-9s  %5.1f rep/s  cpu %4.1f%%", source_.c_str(),
+                !haveReport_ ? "waiting" : last_.controller == Controller::Trackball ? "TrackBall" : "Joystick",
+                window_.n / kWindow, cpu);
+        s.print(1, 0, " records %-9llu unknown %-6llu events %-6llu out %-9llu %s",
+                (unsigned long long)records_, (unsigned long long)unknown_, (unsigned long long)eventCount_,
+                (unsigned long long)bytesOut, haveReport_ && last_.linear ? "positions" : "readings");
+
+        drawGrid(s);
+        drawKeypad(s);
+        drawStats(s);
+        s.text(kRows - 1, 0, " q quit");
+    }
+
+private:
+    void drawGrid(Screen &s)
+    {
+        int top = kGridY - 1, left = kGridX - 1, bottom = kGridY + kGridH, right = kGridX + kGridW;
+        for (int c = left; c <= right; ++c) s.put(top, c, '-'), s.put(bottom, c, '-');
+        for (int r = top; r <= bottom; ++r) s.put(r, left, '|'), s.put(r, right, '|');
+        s.put(top, left, '+'); s.put(top, right, '+'); s.put(bottom, left, '+'); s.put(bottom, right, '+');
+        s.put(kGridY + kGridH / 2, kGridX + kGridW / 2, '+');
+        if (!haveReport_) return;
+
+        auto col = [](int v) { return kGridX + std::min(v, 227) * (kGridW - 1) / 227; };
+        auto row = [](int v) { return kGridY + std::min(v, 227) * (kGridH - 1) / 227; };
+        // range seen in the window, then the current position
+        const Bucket &w = window_;
+        if (w.n) {
+            for (int c = col(w.x0); c <= col(w.x1); ++c) s.put(row(w.y0), c, '.'), s.put(row(w.y1), c, '.');
+            for (int r = row(w.y0); r <= row(w.y1); ++r) s.put(r, col(w.x0), '.'), s.put(r, col(w.x1), '.');
+        }
+        s.put(row(last_.poty), col(last_.potx), 'O', true);
+    }
+
+    void drawKeypad(Screen &s)
+    {
+        static const char keys[] = "123456789*0#";
+        const int x = 46, y = 3;
+        s.text(y - 1, x, "Keypad");
+        for (int i = 0; i < 12; ++i) {
+            bool down = haveReport_ && (last_.keys >> keyBit(keys[i]) & 1);
+            char cell[4] = {'[', keys[i], ']', 0};
+            s.text(y + i / 3, x + (i % 3) * 5, cell, down);
+        }
+        const char *names[] = {"Start", "Pause", "Reset"};
+        const char sp[] = "SPR";
+        for (int i = 0; i < 3; ++i)
+            s.text(y + 5, x + i * 6, names[i], haveReport_ && (last_.keys >> keyBit(sp[i]) & 1));
+        s.text(y - 1, 66, "Buttons");
+        s.text(y, 66, " Top ", haveReport_ && last_.top);
+        s.text(y + 1, 66, " Bot ", haveReport_ && last_.bottom);
+
+        s.text(y + 7, x, "Events");
+        for (size_t i = 0; i < events_.size(); ++i) s.text(y + 8 + i, x, events_[i].c_str());
+    }
+
+    void drawStats(Screen &s)
+    {
+        int r = kGridY + kGridH + 2;
+        if (!haveReport_) return;
+        const char *name = last_.linear ? "Pos" : "Pot";
+        s.print(r, 1, "%sX %3u  %sY %3u   last %.0fs:", name, last_.potx, name, last_.poty, kWindow);
+        const Bucket &w = window_;
+        if (!w.n) return;
+        double mx = w.sx / w.n, my = w.sy / w.n;
+        s.print(r + 1, 1, "X min %3u max %3u mean %5.1f sd %4.1f", w.x0, w.x1, mx,
+                std::sqrt(std::max(0.0, w.qx / w.n - mx * mx)));
+        s.print(r + 2, 1, "Y min %3u max %3u mean %5.1f sd %4.1f", w.y0, w.y1, my,
+                std::sqrt(std::max(0.0, w.qy / w.n - my * my)));
+    }
+
+    std::string source_;
+    Report last_{};
+    bool haveReport_ = false;
+    bool dirty_ = true;
+    double start_ = 0;
+    uint64_t records_ = 0, unknown_ = 0, eventCount_ = 0;
+    Bucket buckets_[kBuckets];
+    Bucket window_;
+    std::deque<std::string> events_;
+};
+
+// Moving controller at a given report rate: a slow circle, keys and buttons now and then
+class Synth {
+public:
+    explicit Synth(double rate) : period_(1.0 / rate) {}
+
+    void produce(double now, std::string &out)
+    {
+        if (next_ == 0) next_ = now;
+        for (; next_ <= now; next_ += period_, ++n_) {
+            double a = n_ * period_ * 1.5;
+            Report r{};
+            r.controller = Controller::Joystick;
+            r.potx = static_cast<uint8_t>(114 + 90 * std::cos(a));
+            r.poty = static_cast<uint8_t>(114 + 90 * std::sin(a));
+            int step = static_cast<int>(n_ * period_ * 2);        // new key every half second
+            r.keys = (step & 1) ? 1u << kKeyOrder[(step / 2) % 15] : 0;
+            r.top = (step % 6) == 1;
+            r.bottom = (step % 6) == 4;
+            appendReport(out, r);
+        }
+    }
+
+private:
+    static constexpr int kKeyOrder[15] = {2, 6, 10, 1, 5, 9, 0, 4, 8, 3, 7, 11, 14, 13, 12};
+    double period_, next_ = 0;
+    uint64_t n_ = 0;
+};
+
+constexpr int Synth::kKeyOrder[15];
+
+int usage()
+{
+    std::fprintf(stderr, "usage: a5200dash port|capture|-\n       a5200dash --synth reports_per_second\n");
+    return 1;
+}
+
+double cpuSeconds()
+{
+    rusage u;
+    getrusage(RUSAGE_SELF, &u);
+    return u.ru_utime.tv_sec + u.ru_stime.tv_sec + (u.ru_utime.tv_usec + u.ru_stime.tv_usec) * 1e-6;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 2 || argc > 3) return usage();
+    int fd = -1;
+    bool live = false, capture = false;
+    double synthRate = 0;
+    std::string source = argv[1];
+
+    if (source == "--synth" && argc == 3) {
+        synthRate = std::atof(argv[2]);
+        if (synthRate <= 0) return usage();
+        source = "synthetic " + std::to_string(static_cast<int>(synthRate)) + " rep/s";
+    } else if (argc != 2) {
+        return usage();
+    } else if (source == "-") {
+        fd = STDIN_FILENO;
+    } else {
+        struct stat st;
+        if (stat(argv[1], &st) < 0) {
+            std::perror(argv[1]);
+            return 1;
+        }
+        live = S_ISCHR(st.st_mode);
+        capture = !live;
+        fd = live ? openSerial(argv[1]) : ::open(argv[1], O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            std::perror(argv[1]);
+            return 1;
+        }
+    }
+
+    // keys without Enter and no echo, alternate screen, hidden cursor
+    termios saved{}, raw{};
+    bool tty = isatty(STDIN_FILENO) && fd != STDIN_FILENO;
+    if (tty) {
+        tcgetattr(STDIN_FILENO, &saved);
+        raw = saved;
+        raw.c_lflag &= ~(ICANON | ECHO);
+        raw.c_cc[VMIN] = 0;
+        raw.c_cc[VTIME] = 0;
+        tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+    }
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    const char enter[] = "\x1b[?1049h\x1b[?25l\x1b[2J";
+    const char leave[] = "\x1b[0m\x1b[?25h\x1b[?1049l";
+    if (::write(STDOUT_FILENO, enter, sizeof enter - 1) < 0) return 1;
+
+    Screen screen;
+    Dashboard dash(source);
+    Decoder decoder;
+    Synth synth(synthRate > 0 ? synthRate : 1);
+    std::string pending;           // capture bytes or synthetic output not yet decoded
+    char buf[4096];
+    double t0 = seconds(), nextFrame = t0, cpuAt = t0, cpu0 = cpuSeconds(), cpu = 0;
+    uint64_t capturePos = 0, bytesOut = 0;
+    bool eof = false;
+    dash.setStart(t0);
+
+    auto feed = [&](const char *p, size_t n, double t) {
+        decoder.feed(p, n, [&](const Record &r) { dash.record(t, r); });
+    };
+
+    while (!stopping) {
+        double now = seconds();
+        pollfd fds[2];
+        int nfds = 0;
+        if (tty) fds[nfds++] = pollfd{STDIN_FILENO, POLLIN, 0};
+        bool reading = fd >= 0 && !eof && !capture;
+        if (reading) fds[nfds++] = pollfd{fd, POLLIN, 0};
+        int wait = std::max(0, static_cast<int>((nextFrame - now) * 1000));
+        poll(fds, nfds, wait);
+        now = seconds();
+
+        if (tty && (fds[0].revents & POLLIN)) {
+            char c;
+            if (::read(STDIN_FILENO, &c, 1) == 1 && (c == 'q' || c == 'Q')) break;
+        }
+        if (reading && (fds[nfds - 1].revents & (POLLIN | POLLHUP))) {
+            ssize_t n = ::read(fd, buf, sizeof buf);
+            if (n > 0) feed(buf, n, now);
+            else if (n == 0) eof = true;
+        }
+        if (capture && !eof) {
+            // replay at the line rate
+            uint64_t due = static_cast<uint64_t>((now - t0) / kByteSeconds);
+            while (capturePos < due && !eof) {
+                size_t want = std::min<uint64_t>(sizeof buf, due - capturePos);
+                ssize_t n = ::read(fd, buf, want);
+                if (n <= 0) eof = true;
+                else feed(buf, n, now), capturePos += n;
+            }
+        }
+        if (synthRate > 0) {
+            pending.clear();
+            synth.produce(now, pending);
+            feed(pending.data(), pending.size(), now);
+        }
+
+        if (now - cpuAt >= 1.0) {
+            double c = cpuSeconds();
+            cpu = 100.0 * (c - cpu0) / (now - cpuAt);
+            cpu0 = c;
+            cpuAt = now;
+            dash.touch();                    // refresh the cpu figure and the window
+        }
+        if (now >= nextFrame) {
+            if (dash.dirty()) {
+                dash.draw(screen, now, cpu, bytesOut);
+                bytesOut += screen.flush(STDOUT_FILENO);
+            }
+            nextFrame = std::max(nextFrame + 1.0 / kFps, now);
+        }
+    }
+
+    if (::write(STDOUT_FILENO, leave, sizeof leave - 1) < 0) {}
+    if (tty) tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+    if (fd > STDIN_FILENO) ::close(fd);
+    double wall = seconds() - t0;
+    std::fprintf(stderr, "a5200dash: %.1fs, cpu %.2f%%, %llu bytes to the terminal\n", wall,
+                 100.0 * cpuSeconds() / wall, (unsigned long long)bytesOut);
+    return 0;
+}
@@ -0,0 +1,347 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   a5200gate - stick range and gate shape
+
+   usage: a5200gate [-t seconds] [--low n] [--high n] [--sectors n] [--offset n]
+                    [--dead n] [--reach f] [-g] port|capture|-
+
+   Collects the joystick readings of a live stream or a capture in a 228x228
+   occupancy grid while the stick is released, swept through the center and
+   pushed around its gate, then gives a PASS/FAIL verdict (exit status 0/1):
+
+   range    both axes reach low and high (default 10 and 190), no reading
+            saturated at 227
+   center   the released stick rests within offset readings (default 20) of
+            the nominal center, 114
+   dead     rest positions spread over at most dead readings per axis
+            (default 8): how far off center a game must ignore the stick
+   sectors  every angle sector (default 16) is reached to at least reach
+            (default 0.9) of the gate, so no direction is obstructed
+
+   A rest is kRestReports reports in a row within a reading of each other,
+   near the center; rests farther out are the stick held, not released.
+   Reach is measured from the rest center and scaled per half axis by the
+   reach along it, so the gate comes out as a unit circle for a circular
+   gate and a unit square for a square one, whatever the center and the pot
+   ends. The diagonal/axis reach ratio tells them apart: 1.0 for a circle,
+   1.41 for a square, in between for an octagonal gate.
+
+   Each report only updates the grid, the ranges and the rest tracking; the
+   sectors are worked out from the grid when needed (at the end, and every
+   second for the progress line on a port), so any report rate keeps up.
+
+   -t   stop after seconds on a port (default 30, Ctrl-C stops earlier)
+   -g   print the occupancy grid, 4 readings per column and 8 per row
+*/
+
+#include "decoder.h"
+#include "serial.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <poll.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace a5200;
+
+namespace {
+
+constexpr int kReadings = 228;          // 0..227
+constexpr int kSaturated = 227;
+constexpr int kNominalCenter = 114;
+constexpr int kRestReports = 5;         // ~0.7s of text reports
+constexpr double kLiveSeconds = 30.0;
+constexpr double kPi = 3.14159265358979323846;
+
+volatile sig_atomic_t stopping = 0;
+
+void onSignal(int) { stopping = 1; }
+
+int usage()
+{
+    std::fprintf(stderr, "usage: a5200gate [-t seconds] [--low n] [--high n] [--sectors n] [--offset n]\n"
+                         "                 [--dead n] [--reach f] [-g] port|capture|-\n");
+    return 1;
+}
+
+struct Limits {
+    int low = 10, high = 190;
+    int sectors = 16;
+    int offset = 20;
+    int dead = 8;
+    double reach = 0.9;
+};
+
+struct Gate {
+    std::vector<uint32_t> grid = std::vector<uint32_t>(kReadings * kReadings);
+    uint64_t reports = 0, trackball = 0, positions = 0, saturated = 0;
+    int minX = kReadings, maxX = -1, minY = kReadings, maxY = -1;
+
+    // rest tracking: current run, and the rests found
+    int runX = -1, runY = -1, runLen = 0;
+    bool runCounted = false;
+    uint64_t rests = 0;
+    double sumX = 0, sumY = 0;
+    int restMinX = kReadings, restMaxX = -1, restMinY = kReadings, restMaxY = -1;
+
+    void add(const Report &r, int nearCenter)
+    {
+        if (r.controller != Controller::Joystick) {
+            ++trackball;
+            return;
+        }
+        if (r.linear) {               // positions, not readings
+            ++positions;
+            return;
+        }
+        ++reports;
+        int x = r.potx, y = r.poty;
+        if (x >= kSaturated || y >= kSaturated) {
+            ++saturated;
+            runLen = 0;
+            return;
+        }
+        ++grid[y * kReadings + x];
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+
+        if (runLen && std::abs(x - runX) <= 1 && std::abs(y - runY) <= 1) {
+            ++runLen;
+        } else {
+            runX = x;
+            runY = y;
+            runLen = 1;
+            runCounted = false;
+        }
+        if (runLen >= kRestReports && !runCounted && std::abs(runX - kNominalCenter) <= nearCenter &&
+            std::abs(runY - kNominalCenter) <= nearCenter) {
+            runCounted = true;
+            ++rests;
+            sumX += runX;
+            sumY += runY;
+            restMinX = std::min(restMinX, runX);
+            restMaxX = std::max(restMaxX, runX);
+            restMinY = std::min(restMinY, runY);
+            restMaxY = std::max(restMaxY, runY);
+        }
+    }
+};
+
+struct Analysis {
+    bool centered = false;
+    double cx = kNominalCenter, cy = kNominalCenter;
+    std::vector<double> reach;      // per sector, 1.0 = the axis reach
+    double ratio = 0;               // diagonal / axis reach
+    int covered = 0;                // sectors with any reading
+};
+
+// Sector reach from the grid, each half axis scaled by its own reach
+Analysis analyze(const Gate &g, const Limits &lim)
+{
+    Analysis a;
+    a.reach.assign(lim.sectors, 0.0);
+    if (g.reports == g.saturated) return a;
+    if (g.rests) {
+        a.centered = true;
+        a.cx = g.sumX / g.rests;
+        a.cy = g.sumY / g.rests;
+    }
+    double right = std::max(g.maxX - a.cx, 1.0), left = std::max(a.cx - g.minX, 1.0);
+    double down = std::max(g.maxY - a.cy, 1.0), up = std::max(a.cy - g.minY, 1.0);
+    double width = 2 * kPi / lim.sectors;
+
+    for (int y = g.minY; y <= g.maxY; ++y) {
+        for (int x = g.minX; x <= g.maxX; ++x) {
+            if (!g.grid[y * kReadings + x]) continue;
+            double u = x - a.cx, v = y - a.cy;
+            u /= u < 0 ? left : right;
+            v /= v < 0 ? up : down;
+            if (u == 0 && v == 0) continue;
+            double angle = std::atan2(v, u);
+            int s = static_cast<int>(std::floor(angle / width + 0.5));
+            s = ((s % lim.sectors) + lim.sectors) % lim.sectors;
+            a.reach[s] = std::max(a.reach[s], std::sqrt(u * u + v * v));
+        }
+    }
+
+    double axis = 0, diagonal = 0;
+    int eighth = lim.sectors / 8;
+    for (int k = 0; k < 8; ++k) (k & 1 ? diagonal : axis) += a.reach[k * eighth];
+    a.ratio = axis > 0 ? diagonal / axis : 0;
+    for (double r : a.reach) a.covered += r > 0;
+    return a;
+}
+
+const char *shape(double ratio)
+{
+    if (ratio < 1.15) return "circular";
+    if (ratio > 1.3) return "square";
+    return "octagonal";
+}
+
+void printGrid(const Gate &g, const Analysis &a)
+{
+    constexpr int kColumn = 4, kRow = 8;
+    int cx = static_cast<int>(std::lround(a.cx)), cy = static_cast<int>(std::lround(a.cy));
+    for (int r = 0; r < kReadings; r += kRow) {
+        std::string line;
+        for (int c = 0; c < kReadings; c += kColumn) {
+            bool hit = false;
+            for (int y = r; y < r + kRow && y < kReadings && !hit; ++y)
+                for (int x = c; x < c + kColumn && !hit; ++x) hit = g.grid[y * kReadings + x] != 0;
+            bool center = cx >= c && cx < c + kColumn && cy >= r && cy < r + kRow;
+            line += center ? '+' : hit ? '#' : '.';
+        }
+        std::printf("  %s\n", line.c_str());
+    }
+    std::printf("  0 .. 227 both axes, x across, + center\n\n");
+}
+
+// Prints the checks, true when all pass
+bool verdict(const Gate &g, const Analysis &a, const Limits &lim)
+{
+    bool pass = true;
+    auto check = [&](bool ok) {
+        pass = pass && ok;
+        return ok ? "ok" : "FAIL";
+    };
+
+    std::printf("reports    %llu joystick, %llu saturated, %llu trackball, %llu positions (ignored)\n",
+                static_cast<unsigned long long>(g.reports), static_cast<unsigned long long>(g.saturated),
+                static_cast<unsigned long long>(g.trackball), static_cast<unsigned long long>(g.positions));
+    if (g.reports == g.saturated) {
+        std::printf("no joystick readings\nFAIL\n");
+        return false;
+    }
+    bool range = g.minX <= lim.low && g.maxX >= lim.high && g.minY <= lim.low && g.maxY >= lim.high &&
+                 g.saturated == 0;
+    std::printf("range      x %03d..%03d  y %03d..%03d  (%d..%d)  %s\n", g.minX, g.maxX, g.minY, g.maxY,
+                lim.low, lim.high, check(range));
+
+    if (a.centered) {
+        double ox = a.cx - kNominalCenter, oy = a.cy - kNominalCenter;
+        std::printf("center     %.1f,%.1f  offset %+.1f,%+.1f  (%d)  %s\n", a.cx, a.cy, ox, oy, lim.offset,
+                    check(std::fabs(ox) <= lim.offset && std::fabs(oy) <= lim.offset));
+        int dx = g.restMaxX - g.restMinX, dy = g.restMaxY - g.restMinY;
+        std::printf("dead zone  x %d  y %d over %llu rest%s  (%d)  %s\n", dx, dy,
+                    static_cast<unsigned long long>(g.rests), g.rests > 1 ? "s" : "", lim.dead,
+                    check(dx <= lim.dead && dy <= lim.dead));
+    } else {
+        std::printf("center     stick never released near the center  %s\n", check(false));
+    }
+
+    std::printf("gate       %s, diagonal/axis reach %.2f\n", shape(a.ratio), a.ratio);
+    std::printf("sector  angle  reach\n");
+    double low = 1e9;
+    for (int s = 0; s < lim.sectors; ++s) {
+        low = std::min(low, a.reach[s]);
+        std::printf("%6d  %5.1f  %5.2f%s\n", s, 360.0 * s / lim.sectors, a.reach[s],
+                    a.reach[s] < lim.reach ? "  short" : "");
+    }
+    std::printf("sectors    %d/%d reached, lowest %.2f  (%.2f)  %s\n", a.covered, lim.sectors, low, lim.reach,
+                check(low >= lim.reach));
+    std::printf("%s\n", pass ? "PASS" : "FAIL");
+    return pass;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Limits lim;
+    double seconds = kLiveSeconds;
+    bool showGrid = false;
+    const char *path = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "-t" && more) seconds = std::atof(argv[++i]);
+        else if (a == "--low" && more) lim.low = std::atoi(argv[++i]);
+        else if (a == "--high" && more) lim.high = std::atoi(argv[++i]);
+        else if (a == "--sectors" && more) lim.sectors = std::atoi(argv[++i]);
+        else if (a == "--offset" && more) lim.offset = std::atoi(argv[++i]);
+        else if (a == "--dead" && more) lim.dead = std::atoi(argv[++i]);
+        else if (a == "--reach" && more) lim.reach = std::atof(argv[++i]);
+        else if (a == "-g") showGrid = true;
+        else if ((a[0] != '-' || a == "-") && !path) path = argv[i];
+        else return usage();
+    }
+    if (!path || lim.sectors < 8 || lim.sectors % 8) {   // sectors on the axes and diagonals
+        if (path) std::fprintf(stderr, "a5200gate: sectors must be a multiple of 8\n");
+        return usage();
+    }
+
+    int fd = STDIN_FILENO;
+    bool live = false;
+    if (std::string(path) != "-") {
+        struct stat st;
+        if (stat(path, &st) < 0) {
+            std::perror(path);
+            return 1;
+        }
+        live = S_ISCHR(st.st_mode);
+        fd = live ? openSerial(path) : ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            std::perror(path);
+            return 1;
+        }
+    }
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    if (live) std::fprintf(stderr, "a5200gate: release the stick, sweep it through the center, then around the gate\n");
+
+    Gate gate;
+    Decoder decoder;
+    char buf[65536];
+    auto t0 = std::chrono::steady_clock::now();
+    double shown = 0;
+    while (!stopping) {
+        double now = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        if (live && now >= seconds) break;
+        if (live && now - shown >= 1.0) {
+            shown = now;
+            Analysis a = analyze(gate, lim);
+            std::fprintf(stderr, "\r%3.0fs  %llu reports  x %03d..%03d  y %03d..%03d  %llu rests  %d/%d sectors ",
+                         now, static_cast<unsigned long long>(gate.reports), std::max(gate.minX, 0),
+                         std::max(gate.maxX, 0), std::max(gate.minY, 0), std::max(gate.maxY, 0),
+                         static_cast<unsigned long long>(gate.rests), a.covered, lim.sectors);
+        }
+        if (live) {
+            pollfd p{fd, POLLIN, 0};
+            if (poll(&p, 1, 100) <= 0) continue;
+        }
+        ssize_t n = ::read(fd, buf, sizeof buf);
+        if (n == 0) break;
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) continue;
+            break;
+        }
+        decoder.feed(buf, n, [&](const Record &r) {
+            if (r.type == RecordType::Report) gate.add(r.report, 2 * lim.offset);
+        });
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (live) std::fprintf(stderr, "\n");
+    if (fd != STDIN_FILENO) ::close(fd);
+
+    Analysis a = analyze(gate, lim);
+    if (showGrid) printGrid(gate, a);
+    bool pass = verdict(gate, a, lim);
+    std::fprintf(stderr, "a5200gate: %llu records in %.3f s (%.0f per second), %llu unknown\n",
+                 static_cast<unsigned long long>(decoder.records()), elapsed,
+                 elapsed > 0 ? decoder.records() / elapsed : 0.0,
+                 static_cast<unsigned long long>(decoder.unknown()));
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,358 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   a5200pad - the emulator as a Linux gamepad (uinput)
+
+   usage: a5200pad [-n] [-l latency.csv] [-t seconds] port|capture
+          a5200pad --selftest [-n] [-t seconds]
+
+   Creates a uinput device "Atari 5200 controller" and follows the serial 
+   stream of the emulator:
+
+     ABS_X, ABS_Y          potx, poty (0..255, 114 is the center of a joystick)
+     BTN_TRIGGER, BTN_THUMB          top and bottom fire buttons
+     BTN_TRIGGER_HAPPY1..12          keypad 1 2 3 4 5 6 7 8 9 * 0 #
+     BTN_START, BTN_SELECT, BTN_MODE Start, Pause, Reset
+
+   Turn the firmware's immediate events on (command e, sent at start unless
+   the input is a capture) and keys and buttons follow the event frames, 
+   without waiting for the next report.
+
+   The read path is one blocking read() per burst of bytes on a port set to 
+   low latency, decoding in place and one write() of all the input events of
+   a record; nothing is allocated per record. The added latency of each 
+   record that changed the device, from the return of the read() holding its
+   last byte to the return of the write() to uinput, is kept in a histogram
+   and printed at exit (p50/p99/max); -l also logs every one to a file. -n 
+   runs without uinput, for the measurement alone. --selftest feeds a pseudo
+   terminal with synthetic reports and event frames at 9600bps.
+*/
+
+#include "decoder.h"
+#include "serial.h"
+#include "synthetic.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/uinput.h>
+#include <random>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+
+using namespace a5200;
+
+namespace {
+
+std::atomic<bool> stopping{false};
+
+void onSignal(int) { stopping = true; }
+
+uint64_t nowNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// keypad bitmap bit to button, order of kKeyNames
+const uint16_t kKeyCodes[15] = {
+    BTN_TRIGGER_HAPPY7,  BTN_TRIGGER_HAPPY4, BTN_TRIGGER_HAPPY1, BTN_TRIGGER_HAPPY10,   // 7 4 1 *
+    BTN_TRIGGER_HAPPY8,  BTN_TRIGGER_HAPPY5, BTN_TRIGGER_HAPPY2, BTN_TRIGGER_HAPPY11,   // 8 5 2 0
+    BTN_TRIGGER_HAPPY9,  BTN_TRIGGER_HAPPY6, BTN_TRIGGER_HAPPY3, BTN_TRIGGER_HAPPY12,   // 9 6 3 #
+    BTN_MODE, BTN_SELECT, BTN_START,                                                   // R P S
+};
+
+constexpr int kMaxEvents = 2 + 2 + 15 + 1;     // axes, buttons, keys, sync
+constexpr uint64_t kHistogramUs = 20000;       // 1us bins up to 20ms, the rest in the last
+
+class Pad {
+public:
+    bool open(bool dryRun);
+    void close();
+
+    // Bring the device to the record, returns true when anything changed
+    bool apply(const Record &r);
+
+    uint64_t writes() const { return writes_; }
+
+private:
+    void key(uint16_t code, bool down) { add(EV_KEY, code, down); }
+    void add(uint16_t type, uint16_t code, int32_t value)
+    {
+        input_event &e = events_[count_++];
+        e.type = type;
+        e.code = code;
+        e.value = value;
+    }
+    bool flush();
+
+    int fd_ = -1;
+    bool dryRun_ = false;
+    input_event events_[kMaxEvents] = {};
+    int count_ = 0;
+    uint64_t writes_ = 0;
+
+    // state the device shows
+    int x_ = -1, y_ = -1;
+    bool top_ = false, bottom_ = false;
+    uint16_t keys_ = 0;
+};
+
+bool Pad::open(bool dryRun)
+{
+    dryRun_ = dryRun;
+    if (dryRun) return true;
+    fd_ = ::open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd_ < 0) return false;
+
+    ioctl(fd_, UI_SET_EVBIT, EV_KEY);
+    ioctl(fd_, UI_SET_EVBIT, EV_ABS);
+    ioctl(fd_, UI_SET_EVBIT, EV_SYN);
+    ioctl(fd_, UI_SET_KEYBIT, BTN_TRIGGER);
+    ioctl(fd_, UI_SET_KEYBIT, BTN_THUMB);
+    for (uint16_t code : kKeyCodes) ioctl(fd_, UI_SET_KEYBIT, code);
+
+    for (uint16_t axis : {ABS_X, ABS_Y}) {
+        uinput_abs_setup abs{};
+        abs.code = axis;
+        abs.absinfo.minimum = 0;
+        abs.absinfo.maximum = 255;
+        if (ioctl(fd_, UI_ABS_SETUP, &abs) < 0) return false;
+    }
+
+    uinput_setup setup{};
+    setup.id.bustype = BUS_VIRTUAL;
+    setup.id.vendor = 0x5200;
+    setup.id.product = 0x0001;
+    std::strncpy(setup.name, "Atari 5200 controller", UINPUT_MAX_NAME_SIZE - 1);
+    return ioctl(fd_, UI_DEV_SETUP, &setup) == 0 && ioctl(fd_, UI_DEV_CREATE) == 0;
+}
+
+void Pad::close()
+{
+    if (fd_ < 0) return;
+    ioctl(fd_, UI_DEV_DESTROY);
+    ::close(fd_);
+    fd_ = -1;
+}
+
+bool Pad::flush()
+{
+    if (count_ == 0) return false;
+    add(EV_SYN, SYN_REPORT, 0);
+    if (!dryRun_) {
+        ssize_t n = ::write(fd_, events_, count_ * sizeof(input_event));
+        (void)n;   // a full uinput queue drops the record, the next report corrects it
+    }
+    count_ = 0;
+    ++writes_;
+    return true;
+}
+
+bool Pad::apply(const Record &r)
+{
+    if (r.type == RecordType::Event) {
+        const Event &e = r.event;
+        if (e.name == 'T' && top_ != e.pressed) key(BTN_TRIGGER, top_ = e.pressed);
+        else if (e.name == 'B' && bottom_ != e.pressed) key(BTN_THUMB, bottom_ = e.pressed);
+        else {
+            int bit = keyBit(e.name);
+            if (bit >= 0 && bit < 15 && ((keys_ >> bit) & 1) != e.pressed) {
+                keys_ ^= 1u << bit;
+                key(kKeyCodes[bit], e.pressed);
+            }
+        }
+        return flush();
+    }
+    if (r.type != RecordType::Report) return false;
+
+    const Report &p = r.report;
+    if (p.potx != x_) add(EV_ABS, ABS_X, x_ = p.potx);
+    if (p.poty != y_) add(EV_ABS, ABS_Y, y_ = p.poty);
+    if (p.top != top_) key(BTN_TRIGGER, top_ = p.top);
+    if (p.bottom != bottom_) key(BTN_THUMB, bottom_ = p.bottom);
+    for (uint16_t changed = (p.keys ^ keys_) & 0x7FFF; changed; changed &= changed - 1) {
+        int bit = __builtin_ctz(changed);
+        key(kKeyCodes[bit], (p.keys >> bit) & 1);
+    }
+    keys_ = p.keys & 0x7FFF;
+    return flush();
+}
+
+// Added latency, microseconds
+class Histogram {
+public:
+    void add(uint64_t us)
+    {
+        ++bins_[us < kHistogramUs ? us : kHistogramUs];
+        ++count_;
+        if (us > max_) max_ = us;
+    }
+
+    uint64_t percentile(double p) const
+    {
+        uint64_t rank = static_cast<uint64_t>(p * count_), seen = 0;
+        for (uint64_t us = 0; us <= kHistogramUs; ++us)
+            if ((seen += bins_[us]) > rank) return us;
+        return max_;
+    }
+
+    uint64_t count() const { return count_; }
+    uint64_t max() const { return max_; }
+
+private:
+    uint64_t bins_[kHistogramUs + 1] = {};
+    uint64_t count_ = 0, max_ = 0;
+};
+
+// Synthetic reports with event frames at 9600bps into a pty master
+void feed(int master, double seconds)
+{
+    std::mt19937 rng(5200);
+    std::string s;
+    uint64_t t0 = nowNs(), written = 0;
+    while (!stopping && (nowNs() - t0) < seconds * 1e9) {
+        s.clear();
+        Report r = randomReport(rng);
+        r.controller = Controller::Joystick;
+        appendReport(s, r);
+        if ((rng() & 3) == 0) appendEvent(s, Event{kKeyNames[rng() % 15], (rng() & 1) != 0});
+        for (size_t done = 0; done < s.size() && !stopping;) {
+            uint64_t due = static_cast<uint64_t>((nowNs() - t0) * 1e-9 / kByteSeconds);
+            if (due <= written) {
+                std::this_thread::sleep_for(std::chrono::microseconds(500));
+                continue;
+            }
+            ssize_t n = ::write(master, s.data() + done, std::min<uint64_t>(s.size() - done, due - written));
+            if (n > 0) done += n, written += n;
+        }
+    }
+}
+
+int usage()
+{
+    std::fprintf(stderr, "usage: a5200pad [-n] [-l latency.csv] [-t seconds] port|capture\n"
+                         "       a5200pad --selftest [-n] [-t seconds]\n");
+    return 1;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    bool dryRun = false, selftest = false;
+    double seconds = 0;
+    const char *logPath = nullptr, *path = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "-n") dryRun = true;
+        else if (a == "--selftest") selftest = true;
+        else if (a == "-l" && more) logPath = argv[++i];
+        else if (a == "-t" && more) seconds = std::atof(argv[++i]);
+        else if (a[0] != '-' && !path) path = argv[i];
+        else return usage();
+    }
+    if (selftest == (path != nullptr)) return usage();
+
+    int fd, master = -1;
+    bool live;
+    std::string slave;
+    if (selftest) {
+        if (seconds <= 0) seconds = 5;
+        master = posix_openpt(O_RDWR | O_NOCTTY);
+        if (master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) {
+            std::perror("a5200pad: pty");
+            return 1;
+        }
+        slave = ptsname(master);
+        path = slave.c_str();
+    }
+    struct stat st;
+    if (stat(path, &st) < 0) {
+        std::perror(path);
+        return 1;
+    }
+    live = S_ISCHR(st.st_mode);
+    fd = live ? openSerial(path) : ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        std::perror(path);
+        return 1;
+    }
+    if (live) {
+        if (!setLowLatency(fd) && !selftest) std::fprintf(stderr, "a5200pad: %s has no low latency mode\n", path);
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);    // block in read(), no poll() in the path
+        if (::write(fd, "e", 1) != 1 && !selftest) std::perror(path);
+    }
+
+    Pad pad;
+    if (!pad.open(dryRun)) {
+        std::perror("a5200pad: /dev/uinput");
+        return 1;
+    }
+    FILE *log = nullptr;
+    if (logPath) {
+        log = std::fopen(logPath, "w");
+        if (!log) {
+            std::perror(logPath);
+            return 1;
+        }
+        std::fprintf(log, "time_ns,type,added_us\n");
+    }
+
+    struct sigaction sa{};
+    sa.sa_handler = onSignal;     // no SA_RESTART, so the blocking read() returns
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    sigaction(SIGALRM, &sa, nullptr);
+    if (seconds > 0) alarm(static_cast<unsigned>(seconds + (selftest ? 0.5 : 0.0)));
+    std::thread feeder;
+    if (selftest) feeder = std::thread(feed, master, seconds);
+
+    static Histogram histogram;   // 160kB, kept off the stack
+    Decoder decoder;
+    uint64_t bytes = 0;
+    char buf[512];
+    while (!stopping) {
+        ssize_t n = ::read(fd, buf, sizeof buf);
+        if (n == 0) break;
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            break;
+        }
+        uint64_t arrived = nowNs();
+        bytes += n;
+        decoder.feed(buf, n, [&](const Record &r) {
+            if (!pad.apply(r)) return;
+            uint64_t done = nowNs();
+            uint64_t us = (done - arrived) / 1000;
+            histogram.add(us);
+            if (log) std::fprintf(log, "%llu,%c,%llu\n", (unsigned long long)arrived,
+                                  r.type == RecordType::Event ? 'e' : 'r', (unsigned long long)us);
+        });
+    }
+    stopping = true;
+    if (feeder.joinable()) feeder.join();
+    pad.close();
+    if (log) std::fclose(log);
+    ::close(fd);
+    if (master >= 0) ::close(master);
+
+    std::fprintf(stderr, "a5200pad: %llu bytes, %llu records, %llu device updates%s\n", (unsigned long long)bytes,
+                 (unsigned long long)decoder.records(), (unsigned long long)pad.writes(), dryRun ? " (dry run)" : "");
+    if (histogram.count())
+        std::fprintf(stderr, "added latency: p50 %lluus  p99 %lluus  max %lluus\n",
+                     (unsigned long long)histogram.percentile(0.50), (unsigned long long)histogram.percentile(0.99),
+                     (unsigned long long)histogram.max());
+    return 0;
+}
@@ -0,0 +1,131 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   a5200query - filter a binary trace
+
+   usage: a5200query trace [options]
+     --from us --to us       time range, found through the block index
+     --x min:max --y min:max pot ranges
+     --keys hhhh             any of these keys down (hex bitmap as Report::keys)
+     --top --bottom          button down
+     --joystick --trackball  controller type
+     -p                      print the matching records, otherwise only count them
+
+   The trace is mapped with mmap and scanned in place; blocks whose index 
+   entry shows that no record can match are skipped without being touched.
+*/
+
+#include "trace.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+using namespace a5200;
+
+namespace {
+
+struct Filter {
+    uint64_t from = 0, to = UINT64_MAX;
+    uint8_t xmin = 0, xmax = 255, ymin = 0, ymax = 255;
+    uint16_t keys = 0;
+    uint8_t buttons = 0;
+    uint8_t controllers = 0xFF;
+
+    bool block(const TraceBlock &b) const
+    {
+        return b.maxPotx >= xmin && b.minPotx <= xmax && b.maxPoty >= ymin && b.minPoty <= ymax &&
+               (!keys || (b.keys & keys)) && (b.buttons & buttons) == buttons && (b.controllers & controllers);
+    }
+
+    bool record(const TraceRecord &r) const
+    {
+        return r.potx >= xmin && r.potx <= xmax && r.poty >= ymin && r.poty <= ymax &&
+               (!keys || (r.keys & keys)) && (r.buttons & buttons) == buttons &&
+               ((1u << (r.controller & 7)) & controllers);
+    }
+};
+
+bool range(const char *s, uint8_t &lo, uint8_t &hi)
+{
+    unsigned a, b;
+    if (std::sscanf(s, "%u:%u", &a, &b) != 2 || a > 255 || b > 255) return false;
+    lo = static_cast<uint8_t>(a);
+    hi = static_cast<uint8_t>(b);
+    return true;
+}
+
+int usage()
+{
+    std::fprintf(stderr, "usage: a5200query trace [--from us] [--to us] [--x min:max] [--y min:max] [--keys hhhh]\n"
+                         "                        [--top] [--bottom] [--joystick] [--trackball] [-p]\n");
+    return 1;
+}
+
+} // namespace
+
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) return usage();
+    Filter f;
+    bool print = false;
+    uint8_t controllers = 0;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "--from" && more) f.from = std::strtoull(argv[++i], nullptr, 10);
+        else if (a == "--to" && more) f.to = std::strtoull(argv[++i], nullptr, 10);
+        else if (a == "--x" && more) { if (!range(argv[++i], f.xmin, f.xmax)) return usage(); }
+        else if (a == "--y" && more) { if (!range(argv[++i], f.ymin, f.ymax)) return usage(); }
+        else if (a == "--keys" && more) f.keys = static_cast<uint16_t>(std::strtoul(argv[++i], nullptr, 16));
+        else if (a == "--top") f.buttons |= kTraceTop;
+        else if (a == "--bottom") f.buttons |= kTraceBottom;
+        else if (a == "--joystick") controllers |= 1u << static_cast<int>(Controller::Joystick);
+        else if (a == "--trackball") controllers |= 1u << static_cast<int>(Controller::Trackball);
+        else if (a == "-p") print = true;
+        else return usage();
+    }
+    if (controllers) f.controllers = controllers;
+
+    TraceReader trace;
+    if (!trace.open(argv[1])) {
+        std::fprintf(stderr, "a5200query: %s\n", trace.error().c_str());
+        return 1;
+    }
+
+    auto t0 = std::chrono::steady_clock::now();
+    const TraceRecord *rec = trace.records();
+    uint64_t first = trace.lowerBound(f.from);
+    uint64_t last = f.to == UINT64_MAX ? trace.count() : trace.lowerBound(f.to + 1);
+    uint64_t matches = 0, scanned = 0;
+
+    for (uint64_t i = first; i < last;) {
+        uint64_t block = i / kTraceBlockRecords;
+        uint64_t blockEnd = std::min<uint64_t>(last, (block + 1) * kTraceBlockRecords);
+        if (!f.block(trace.blocks()[block])) {
+            i = blockEnd;
+            continue;
+        }
+        scanned += blockEnd - i;
+        for (; i < blockEnd; ++i) {
+            const TraceRecord &r = rec[i];
+            if (!f.record(r)) continue;
+            ++matches;
+            if (print)
+                std::printf("%llu %c X:%03u Y:%03u T:%u B:%u K:%04x%s\n", (unsigned long long)r.timeUs,
+                            r.controller == static_cast<uint8_t>(Controller::Trackball) ? 'T' : 'J', r.potx,
+                            r.poty, (r.buttons & kTraceTop) != 0, (r.buttons & kTraceBottom) != 0, r.keys,
+                            r.flags & kTraceLinear ? " Pos" : "");
+        }
+    }
+
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    std::fprintf(stderr, "a5200query: %llu of %llu records match, %llu scanned, %.0f records/s\n",
+                 (unsigned long long)matches, (unsigned long long)trace.count(), (unsigned long long)scanned,
+                 s > 0 ? (last - first) / s : 0.0);
+    return 0;
+}
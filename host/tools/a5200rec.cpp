@@ -0,0 +1,111 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   a5200rec - record the emulator output as a binary trace
+
+   usage: a5200rec input output.trace
+
+   input is a serial port (recorded until Ctrl-C), an ASCII capture file, or 
+   '-' for stdin. Each printResults() report becomes one TraceRecord. Live 
+   input is timestamped with the clock when the report's last byte arrives;
+   captures have no time information, so the time is the position of that
+   byte in the stream at 9600bps (the firmware never leaves the line idle for
+   long, so this is close to the time it was sent).
+*/
+
+#include "decoder.h"
+#include "serial.h"
+#include "trace.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace a5200;
+
+static std::atomic<bool> stopping{false};
+
+static void onSignal(int) { stopping = true; }
+
+int main(int argc, char **argv)
+{
+    if (argc != 3) {
+        std::fprintf(stderr, "usage: a5200rec input output.trace\n");
+        return 1;
+    }
+
+    int fd;
+    bool live;
+    if (std::strcmp(argv[1], "-") == 0) {
+        fd = STDIN_FILENO;
+        live = isatty(fd);
+    } else {
+        struct stat st;
+        if (stat(argv[1], &st) < 0) {
+            std::perror(argv[1]);
+            return 1;
+        }
+        live = S_ISCHR(st.st_mode);
+        fd = live ? openSerial(argv[1]) : ::open(argv[1], O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            std::perror(argv[1]);
+            return 1;
+        }
+    }
+
+    TraceWriter writer;
+    if (!writer.open(argv[2])) {
+        std::perror(argv[2]);
+        return 1;
+    }
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    Decoder decoder;
+    uint64_t skipped = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    char buf[1 << 16];
+    bool ok = true;
+
+    while (!stopping) {
+        if (live) {
+            pollfd p{fd, POLLIN, 0};
+            if (poll(&p, 1, 200) <= 0) continue;
+        }
+        ssize_t n = ::read(fd, buf, sizeof buf);
+        if (n == 0) break;
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) continue;
+            std::perror(argv[1]);
+            break;
+        }
+
+        uint64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+                           std::chrono::steady_clock::now() - t0).count();
+        decoder.feed(buf, n, [&](const Record &r) {
+            if (r.type != RecordType::Report) {
+                ++skipped;
+                return;
+            }
+            uint64_t t = live ? now : static_cast<uint64_t>(r.end * kByteSeconds * 1e6);
+            ok = writer.append(toTraceRecord(r.report, t)) && ok;
+        });
+    }
+
+    uint64_t count = writer.count();
+    if (!writer.close() || !ok) {
+        std::fprintf(stderr, "a5200rec: error writing %s\n", argv[2]);
+        return 1;
+    }
+    std::fprintf(stderr, "a5200rec: %llu reports, %llu other records\n", (unsigned long long)count,
+                 (unsigned long long)skipped);
+    return 0;
+}
@@ -0,0 +1,117 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   a5200sim - run the firmware on the virtual board with a scripted scenario
+
+   usage: a5200sim [-t seconds] [-o capture.txt] [-q] [--cav V] [--vih V] [--no-ghosting]
+                   [--key-settle us] [--key-recover us] scenario.txt
+
+   The firmware (firmware/main.c built natively) runs in virtual time against
+   the controller and keypad actions of the scenario (see sim/scenario.h). 
+   Every decoded record is printed with the virtual time its last byte left 
+   the UART; -o also writes the raw serial output, byte for byte, as a capture
+   the other tools read. -q prints only the summary, with the simulation speed
+   in virtual seconds per wall clock second. --key-settle and --key-recover
+   set how long the keypad columns take to follow a line being driven and
+   released (3 and 6us by default).
+*/
+
+#include "decoder.h"
+#include "scenario.h"
+#include "simulator.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace a5200;
+
+static int usage()
+{
+    std::fprintf(stderr, "usage: a5200sim [-t seconds] [-o capture.txt] [-q] [--cav V] [--vih V] [--no-ghosting]\n"
+                         "                [--key-settle us] [--key-recover us] scenario.txt\n");
+    return 1;
+}
+
+static void printRecord(double t, const Record &r)
+{
+    std::printf("%10.6f ", t);
+    switch (r.type) {
+    case RecordType::Report:
+        std::printf("%c X:%03u Y:%03u T:%u B:%u K:%04x\n",
+                    r.report.controller == Controller::Trackball ? 'T' : 'J', r.report.potx, r.report.poty,
+                    r.report.top, r.report.bottom, r.report.keys);
+        break;
+    case RecordType::Event:
+        std::printf("event %c%c\n", r.event.name, r.event.pressed ? '+' : '-');
+        break;
+    case RecordType::Trace:
+        std::printf("trace X:%03u Y:%03u edges X:%u Y:%u\n", r.trace.potx, r.trace.poty, r.trace.edgesX,
+                    r.trace.edgesY);
+        break;
+    default:
+        std::printf("%.*s\n", static_cast<int>(r.text.size()), r.text.data());
+        break;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = 0;
+    const char *capturePath = nullptr, *scenarioPath = nullptr;
+    bool quiet = false;
+    SimConfig config;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "-t" && more) seconds = std::atof(argv[++i]);
+        else if (a == "-o" && more) capturePath = argv[++i];
+        else if (a == "-q") quiet = true;
+        else if (a == "--cav" && more) config.cav = std::atof(argv[++i]);
+        else if (a == "--vih" && more) config.model.vih = std::atof(argv[++i]);   // nominal console ViH
+        else if (a == "--no-ghosting") config.ghosting = false;
+        else if (a == "--key-settle" && more) config.keySettle = std::atof(argv[++i]) * 1e-6;
+        else if (a == "--key-recover" && more) config.keyRecover = std::atof(argv[++i]) * 1e-6;
+        else if (a[0] != '-' && !scenarioPath) scenarioPath = argv[i];
+        else return usage();
+    }
+    if (!scenarioPath) return usage();
+
+    Scenario scenario;
+    if (!scenario.load(scenarioPath)) {
+        std::fprintf(stderr, "a5200sim: %s\n", scenario.error().c_str());
+        return 1;
+    }
+    if (seconds <= 0) seconds = scenario.duration();
+
+    FILE *capture = nullptr;
+    if (capturePath && !(capture = std::fopen(capturePath, "wb"))) {
+        std::perror(capturePath);
+        return 1;
+    }
+
+    Decoder decoder;
+    uint64_t bytes = 0, reports = 0, events = 0;
+    Simulator simulator(config, scenario, [&](double t, uint8_t byte) {
+        ++bytes;
+        if (capture) std::fputc(byte, capture);
+        char c = static_cast<char>(byte);
+        decoder.feed(&c, 1, [&](const Record &r) {
+            if (r.type == RecordType::Report) ++reports;
+            if (r.type == RecordType::Event) ++events;
+            if (!quiet) printRecord(t, r);
+        });
+    });
+
+    auto t0 = std::chrono::steady_clock::now();
+    simulator.run(seconds);
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    if (capture) std::fclose(capture);
+    std::fprintf(stderr, "a5200sim: %.3f virtual s in %.3f s (%.0fx), %llu bytes, %llu reports, %llu events, "
+                 "%llu records\n", simulator.now(), wall, simulator.now() / wall, (unsigned long long)bytes,
+                 (unsigned long long)reports, (unsigned long long)events, (unsigned long long)decoder.records());
+    return 0;
+}
@@ -0,0 +1,46 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   a5200synth - synthetic capture with the bytes the firmware sends
+
+   usage: a5200synth [-n records] [-s seed] > capture.txt
+
+   Random reports with an event frame every 16 records, for trying the other
+   tools without a board.
+*/
+
+#include "synthetic.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace a5200;
+
+int main(int argc, char **argv)
+{
+    unsigned long records = 100000, seed = 5200;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "-n" && i + 1 < argc) records = std::strtoul(argv[++i], nullptr, 10);
+        else if (a == "-s" && i + 1 < argc) seed = std::strtoul(argv[++i], nullptr, 10);
+        else {
+            std::fprintf(stderr, "usage: a5200synth [-n records] [-s seed]\n");
+            return 1;
+        }
+    }
+
+    std::mt19937 rng(seed);
+    std::string s;
+    for (unsigned long i = 0; i < records; ++i) {
+        if ((i & 15) == 15) appendEvent(s, Event{kKeyNames[rng() % 15], (rng() & 1) != 0});
+        else appendReport(s, randomReport(rng));
+        if (s.size() > 65536) {
+            std::fwrite(s.data(), 1, s.size(), stdout);
+            s.clear();
+        }
+    }
+    std::fwrite(s.data(), 1, s.size(), stdout);
+    return 0;
+}
@@ -0,0 +1,237 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   a5200test - production test sequencer
+
+   usage: a5200test [-r results.csv] [-q] script.txt port|capture ...
+          a5200test [-r results.csv] [-q] --sim scenario.txt script.txt
+
+   Runs the test script (see lib/sequencer.h) on every station at once, one
+   serial port per station, so one operator can keep several stations busy:
+   each station prompts for its next step, advances by itself when the step
+   is seen done, and prints a PASS/FAIL line per unit with the time of every
+   step. Plug the next unit in when the previous one is unplugged. Runs until
+   Ctrl-C, then prints the units tested and passed per station.
+
+   A capture file instead of a port replays a recorded session (timed by byte
+   position at 9600bps); --sim runs the script against the simulated firmware
+   driven by a scenario, to try a script without a board.
+
+   -r appends one CSV line per step and per unit: 
+   station,model,unit,step,name,result,seconds,detail
+*/
+
+#include "decoder.h"
+#include "scenario.h"
+#include "sequencer.h"
+#include "serial.h"
+#include "simulator.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <memory>
+#include <poll.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+using namespace a5200;
+
+static std::atomic<bool> stopping{false};
+
+static void onSignal(int) { stopping = true; }
+
+namespace {
+
+struct Station {
+    Station(std::string n, const TestScript &script) : name(std::move(n)), sequencer(script) {}
+
+    std::string name;
+    int fd = -1;
+    bool live = false;
+    Decoder decoder;
+    Sequencer sequencer;
+    double unitSeconds = 0;    // sum over the units tested
+};
+
+class Console {
+public:
+    Console(const TestScript &script, FILE *csv, bool quiet) : script_(script), csv_(csv), quiet_(quiet) {}
+
+    void attach(Station &s)
+    {
+        s.sequencer.onPrompt = [this, &s](int unit, const TestStep &step) {
+            if (!quiet_) std::printf("%-12s unit %-4d > %s\n", s.name.c_str(), unit, step.prompt.c_str());
+        };
+        s.sequencer.onStep = [this, &s](int unit, const TestStep &step, const StepResult &r) {
+            if (!quiet_)
+                std::printf("%-12s unit %-4d   %-8s %s %6.1fs %s\n", s.name.c_str(), unit, stepName(step.kind),
+                            r.pass ? "PASS" : "FAIL", r.seconds, r.detail.c_str());
+            if (csv_)
+                std::fprintf(csv_, "%s,%s,%d,%zu,%s,%s,%.2f,\"%s\"\n", s.name.c_str(), script_.model.c_str(), unit,
+                             &step - script_.steps.data() + 1, stepName(step.kind), r.pass ? "PASS" : "FAIL",
+                             r.seconds, r.detail.c_str());
+        };
+        s.sequencer.onUnit = [this, &s](const UnitResult &u) {
+            s.unitSeconds += u.seconds;
+            std::printf("%-12s unit %-4d %s %s in %.1fs, %zu/%zu steps\n", s.name.c_str(), u.unit,
+                        script_.model.c_str(), u.pass ? "PASS" : "FAIL", u.seconds, u.steps.size(),
+                        script_.steps.size());
+            if (csv_) {
+                std::fprintf(csv_, "%s,%s,%d,0,unit,%s,%.2f,\n", s.name.c_str(), script_.model.c_str(), u.unit,
+                             u.pass ? "PASS" : "FAIL", u.seconds);
+                std::fflush(csv_);
+            }
+            std::fflush(stdout);
+        };
+    }
+
+private:
+    const TestScript &script_;
+    FILE *csv_;
+    bool quiet_;
+};
+
+// Feed a chunk; each record is timed at its last byte for a capture, at now for a port
+void feed(Station &s, const char *buf, size_t n, double now)
+{
+    s.decoder.feed(buf, n, [&](const Record &r) {
+        double t = s.live ? now : r.end * kByteSeconds;
+        s.sequencer.tick(t);
+        s.sequencer.record(t, r);
+    });
+}
+
+int usage()
+{
+    std::fprintf(stderr, "usage: a5200test [-r results.csv] [-q] script.txt port|capture ...\n"
+                         "       a5200test [-r results.csv] [-q] --sim scenario.txt script.txt\n");
+    return 1;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const char *csvPath = nullptr, *scenarioPath = nullptr;
+    bool quiet = false;
+    std::vector<const char *> paths;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "-r" && more) csvPath = argv[++i];
+        else if (a == "--sim" && more) scenarioPath = argv[++i];
+        else if (a == "-q") quiet = true;
+        else if (a[0] != '-') paths.push_back(argv[i]);
+        else return usage();
+    }
+    if (paths.empty() || (scenarioPath ? paths.size() != 1 : paths.size() < 2)) return usage();
+
+    TestScript script;
+    if (!script.load(paths[0])) {
+        std::fprintf(stderr, "a5200test: %s\n", script.error.c_str());
+        return 1;
+    }
+
+    FILE *csv = nullptr;
+    if (csvPath) {
+        csv = std::fopen(csvPath, "a");
+        if (!csv) {
+            std::perror(csvPath);
+            return 1;
+        }
+        if (std::ftell(csv) == 0) std::fprintf(csv, "station,model,unit,step,name,result,seconds,detail\n");
+    }
+    Console console(script, csv, quiet);
+    std::vector<std::unique_ptr<Station>> stations;
+
+    if (scenarioPath) {
+        Scenario scenario;
+        if (!scenario.load(scenarioPath)) {
+            std::fprintf(stderr, "a5200test: %s\n", scenario.error().c_str());
+            return 1;
+        }
+        stations.push_back(std::make_unique<Station>("sim", script));
+        Station &s = *stations.back();
+        console.attach(s);
+        SimConfig config;
+        Simulator simulator(config, scenario, [&](double t, uint8_t byte) {
+            char c = static_cast<char>(byte);
+            s.decoder.feed(&c, 1, [&](const Record &r) {
+                s.sequencer.tick(t);
+                s.sequencer.record(t, r);
+            });
+        });
+        simulator.run(scenario.duration());
+        s.sequencer.tick(simulator.now());
+    } else {
+        for (size_t i = 1; i < paths.size(); ++i) {
+            const char *base = std::strrchr(paths[i], '/');
+            stations.push_back(std::make_unique<Station>(base ? base + 1 : paths[i], script));
+            Station &s = *stations.back();
+            struct stat st;
+            if (stat(paths[i], &st) < 0) {
+                std::perror(paths[i]);
+                return 1;
+            }
+            s.live = S_ISCHR(st.st_mode);
+            s.fd = s.live ? openSerial(paths[i]) : ::open(paths[i], O_RDONLY | O_CLOEXEC);
+            if (s.fd < 0) {
+                std::perror(paths[i]);
+                return 1;
+            }
+            console.attach(s);
+        }
+
+        std::signal(SIGINT, onSignal);
+        std::signal(SIGTERM, onSignal);
+        char buf[4096];
+
+        // captures first, one after another
+        for (auto &s : stations) {
+            if (s->live) continue;
+            ssize_t n;
+            while (!stopping && (n = ::read(s->fd, buf, sizeof buf)) > 0) feed(*s, buf, n, 0);
+            s->sequencer.tick(s->decoder.offset() * kByteSeconds);
+        }
+
+        std::vector<pollfd> fds;
+        std::vector<Station *> live;
+        for (auto &s : stations)
+            if (s->live) {
+                fds.push_back(pollfd{s->fd, POLLIN, 0});
+                live.push_back(s.get());
+            }
+        auto t0 = std::chrono::steady_clock::now();
+        while (!live.empty() && !stopping) {
+            int n = poll(fds.data(), fds.size(), 100);
+            if (n < 0 && errno != EINTR) break;
+            double now = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+            for (size_t i = 0; i < fds.size(); ++i) {
+                if (fds[i].revents & POLLIN) {
+                    ssize_t len = ::read(fds[i].fd, buf, sizeof buf);
+                    if (len > 0) feed(*live[i], buf, len, now);
+                }
+                live[i]->sequencer.tick(now);
+            }
+        }
+        for (auto &s : stations) ::close(s->fd);
+    }
+
+    std::printf("\n%-12s %-8s %6s %6s %10s\n", "station", "model", "units", "passed", "s/unit");
+    for (auto &s : stations) {
+        int units = s->sequencer.units();
+        if (s->sequencer.state() == Sequencer::State::Running) --units;   // interrupted, not counted
+        std::printf("%-12s %-8s %6d %6d %10.1f\n", s->name.c_str(), script.model.c_str(), units,
+                    s->sequencer.passed(), units ? s->unitSeconds / units : 0.0);
+    }
+    if (csv) std::fclose(csv);
+    return 0;
+}
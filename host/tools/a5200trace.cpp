@@ -0,0 +1,155 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   a5200trace - comparator traces as waveforms
+
+   usage: a5200trace [-n count] [-w] [-g] [--csv] port|capture|-
+
+   Shows the comparator traces of the firmware (serial command 'w'): both
+   comparator outputs on every line of a frame, as a two level waveform per
+   axis. On a port the trace mode is started, and the board is sent back to
+   reports ('n') at exit. A pot input charging cleanly gives a single edge,
+   where the reading is taken; ringing, noise or a slow ramp near ViH show up
+   as extra edges before or after it.
+
+   -n   stop after count traces (Ctrl-C otherwise, or the end of a capture)
+   -w   one column per line (228), 3 lines per column by default
+   -g   only traces with more than one edge on an axis
+   --csv  trace,line,x,y for every line instead of the waveforms
+*/
+
+#include "decoder.h"
+#include "serial.h"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <poll.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace a5200;
+
+namespace {
+
+constexpr int kNarrowLines = 3;   // lines per column, 76 columns
+
+volatile sig_atomic_t stopping = 0;
+
+void onSignal(int) { stopping = 1; }
+
+int usage()
+{
+    std::fprintf(stderr, "usage: a5200trace [-n count] [-w] [-g] [--csv] port|capture|-\n");
+    return 1;
+}
+
+// Two rows per axis, '_' on the top row while the comparator is high, on the
+// bottom row while it is low, '|' on both for a column with an edge inside
+void printAxis(const Trace &t, int axis, int perColumn)
+{
+    std::string top, bottom;
+    for (int l = 0; l < kTraceLines; l += perColumn) {
+        int high = 0, n = 0;
+        for (int i = l; i < l + perColumn && i < kTraceLines; ++i, ++n) high += traceBit(t.bits, i, axis);
+        bool edge = high != 0 && high != n;
+        if (!edge && l > 0) edge = traceBit(t.bits, l, axis) != traceBit(t.bits, l - 1, axis);
+        top += edge ? '|' : high ? '_' : ' ';
+        bottom += edge ? '|' : high ? ' ' : '_';
+    }
+    while (!top.empty() && top.back() == ' ') top.pop_back();
+    while (!bottom.empty() && bottom.back() == ' ') bottom.pop_back();
+    std::printf("%c %s\n  %s\n", axis ? 'y' : 'x', top.c_str(), bottom.c_str());
+}
+
+void printTrace(unsigned n, const Trace &t, int perColumn)
+{
+    std::printf("trace %u  X:%03u edges %u%s  Y:%03u edges %u%s\n", n, t.potx, t.edgesX,
+                t.edgesX > 1 ? " (glitch)" : "", t.poty, t.edgesY, t.edgesY > 1 ? " (glitch)" : "");
+    printAxis(t, 0, perColumn);
+    printAxis(t, 1, perColumn);
+    std::string ruler;
+    for (int l = 0; l < kTraceLines; l += perColumn)
+        ruler += (l % (20 * perColumn) == 0) ? '+' : ' ';
+    while (ruler.back() == ' ') ruler.pop_back();
+    std::printf("  %s\n  0 .. 227, %d line%s per column, + every %d lines\n\n", ruler.c_str(), perColumn,
+                perColumn > 1 ? "s" : "", 20 * perColumn);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    unsigned count = 0;
+    int perColumn = kNarrowLines;
+    bool glitches = false, csv = false;
+    const char *path = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "-n" && more) count = static_cast<unsigned>(std::atoi(argv[++i]));
+        else if (a == "-w") perColumn = 1;
+        else if (a == "-g") glitches = true;
+        else if (a == "--csv") csv = true;
+        else if ((a[0] != '-' || a == "-") && !path) path = argv[i];
+        else return usage();
+    }
+    if (!path) return usage();
+
+    int fd = STDIN_FILENO;
+    bool live = false;
+    if (std::string(path) != "-") {
+        struct stat st;
+        if (stat(path, &st) < 0) {
+            std::perror(path);
+            return 1;
+        }
+        live = S_ISCHR(st.st_mode);
+        fd = live ? openSerial(path) : ::open(path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            std::perror(path);
+            return 1;
+        }
+    }
+    if (live && ::write(fd, "w", 1) != 1) std::perror(path);
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    if (csv) std::printf("trace,line,x,y\n");
+    Decoder decoder;
+    unsigned traces = 0, shown = 0;
+    char buf[4096];
+    while (!stopping && (count == 0 || shown < count)) {
+        if (live) {
+            pollfd p{fd, POLLIN, 0};
+            if (poll(&p, 1, 100) <= 0) continue;
+        }
+        ssize_t n = ::read(fd, buf, sizeof buf);
+        if (n == 0) break;
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) continue;
+            break;
+        }
+        decoder.feed(buf, n, [&](const Record &r) {
+            if (r.type != RecordType::Trace) return;
+            ++traces;
+            if ((glitches && r.trace.edgesX <= 1 && r.trace.edgesY <= 1) || (count && shown >= count)) return;
+            ++shown;
+            if (csv) {
+                for (int l = 0; l < kTraceLines; ++l)
+                    std::printf("%u,%d,%d,%d\n", traces, l, traceBit(r.trace.bits, l, 0), traceBit(r.trace.bits, l, 1));
+            } else {
+                printTrace(traces, r.trace, perColumn);
+            }
+            std::fflush(stdout);
+        });
+    }
+
+    if (live && ::write(fd, "n", 1) != 1) std::perror(path);
+    if (fd != STDIN_FILENO) ::close(fd);
+    std::fprintf(stderr, "a5200trace: %u traces, %u shown\n", traces, shown);
+    return 0;
+}
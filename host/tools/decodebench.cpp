@@ -0,0 +1,100 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   decodebench - decoder throughput in records per second
+
+   usage: decodebench [-n records] [-c chunk] [-r rounds] [capture file]
+
+   Without a file a synthetic capture is generated with the same bytes the 
+   firmware sends: reports with random pots, buttons and keys and an event 
+   frame every 16 reports. The capture is decoded in chunks of the given size
+   (default 4096, as read() from a tty or file would return).
+*/
+
+#include "decoder.h"
+#include "synthetic.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+using namespace a5200;
+
+static std::string synthetic(size_t records)
+{
+    std::mt19937 rng(5200);
+    std::string s;
+    s.reserve(records * 60);
+    for (size_t i = 0; i < records; ++i) {
+        if ((i & 15) == 15) appendEvent(s, Event{kKeyNames[rng() % 15], (rng() & 1) != 0});
+        else appendReport(s, randomReport(rng));
+    }
+    return s;
+}
+
+int main(int argc, char **argv)
+{
+    size_t records = 1000000, chunk = 4096;
+    int rounds = 5;
+    const char *file = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "-n" && i + 1 < argc) records = std::strtoul(argv[++i], nullptr, 10);
+        else if (a == "-c" && i + 1 < argc) chunk = std::strtoul(argv[++i], nullptr, 10);
+        else if (a == "-r" && i + 1 < argc) rounds = std::atoi(argv[++i]);
+        else if (a[0] != '-') file = argv[i];
+        else {
+            std::fprintf(stderr, "usage: decodebench [-n records] [-c chunk] [-r rounds] [capture file]\n");
+            return 1;
+        }
+    }
+    if (chunk == 0) chunk = 1;
+
+    std::string data;
+    if (file) {
+        std::ifstream in(file, std::ios::binary);
+        if (!in) {
+            std::fprintf(stderr, "decodebench: cannot open %s\n", file);
+            return 1;
+        }
+        data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    } else {
+        data = synthetic(records);
+    }
+
+    double best = 0;
+    uint64_t decoded = 0, reports = 0;
+    for (int round = 0; round < rounds; ++round) {
+        Decoder decoder;
+        uint64_t n = 0, keySum = 0;
+        auto t0 = std::chrono::steady_clock::now();
+        for (size_t off = 0; off < data.size(); off += chunk) {
+            size_t len = std::min(chunk, data.size() - off);
+            decoder.feed(data.data() + off, len, [&](const Record &r) {
+                if (r.type == RecordType::Report) {
+                    ++n;
+                    keySum += r.report.keys + r.report.potx;
+                }
+            });
+        }
+        auto t1 = std::chrono::steady_clock::now();
+        double s = std::chrono::duration<double>(t1 - t0).count();
+        double rate = decoder.records() / s;
+        if (rate > best) best = rate;
+        decoded = decoder.records();
+        reports = n + (keySum & 0);   // keeps the callback from being optimized away
+        if (decoder.unknown() || decoder.overflows())
+            std::fprintf(stderr, "decodebench: %llu unknown lines, %llu overflows\n",
+                         (unsigned long long)decoder.unknown(), (unsigned long long)decoder.overflows());
+    }
+
+    std::printf("%zu bytes, %llu records (%llu reports), chunk %zu\n", data.size(),
+                (unsigned long long)decoded, (unsigned long long)reports, chunk);
+    std::printf("%.0f records/s, %.1f MB/s (best of %d)\n", best,
+                best * data.size() / (decoded ? decoded : 1) / 1e6, rounds);
+    return 0;
+}
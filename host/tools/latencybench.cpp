@@ -0,0 +1,300 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   latencybench - input to decoded record latency of each reporting mode
+
+   usage: latencybench [-n trials] [-s seed] [-m mode] [--csv file]
+
+   Runs the firmware on the simulated board (see sim/simulator.h) and, for 
+   each probe below, changes one input at a random time and measures until 
+   the decoder delivers the first record that shows the change. The input is
+   then put back and, once that is seen too, the next change is made after a
+   random delay of up to two report periods, so changes land at every phase
+   of the main() loop, the four frame loop and the serial transmission.
+
+     text      key, stick, button     normal report (command n)
+     events    key, button            event frames (command e)
+     matrix    key                    matrix report (command m)
+     velocity  trackball              velocity bursts (command v)
+
+   Latency is virtual time from the input change to the end of the stop bit
+   of the last byte of the record. --csv writes every trial.
+*/
+
+#include "decoder.h"
+#include "serial.h"
+#include "simulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace a5200;
+
+namespace {
+
+enum class Input : uint8_t { Key, Stick, Button, Trackball };
+
+struct Probe {
+    const char *mode;
+    const char *input;
+    Input kind;
+    char command;            // report mode, sent when the probe starts
+    bool events;             // event frames on
+    double window;           // random delay before a change, about two report periods
+};
+
+const Probe kProbes[] = {
+    { "text",     "key",       Input::Key,       'n', false, 0.3 },
+    { "text",     "stick",     Input::Stick,     'n', false, 0.3 },
+    { "text",     "button",    Input::Button,    'n', false, 0.3 },
+    { "events",   "key",       Input::Key,       'n', true,  0.3 },
+    { "events",   "button",    Input::Button,    'n', true,  0.3 },
+    { "matrix",   "key",       Input::Key,       'm', false, 0.3 },
+    { "velocity", "trackball", Input::Trackball, 'v', false, 2.0 },
+};
+
+constexpr char kKey = '5';
+constexpr int kKeyBit = 5;              // '5' in the report bitmap
+constexpr double kStickLow = 50, kStickHigh = 150;
+constexpr int kStickTolerance = 4;      // readings
+constexpr double kSpin = 40;            // trackball speed step, readings from steady
+constexpr double kSettle = 1.0;         // after a mode change, before the first trial
+constexpr double kTimeout = 5.0;        // a change not seen by then counts as lost
+
+class Bench : public Stimulus {
+public:
+    Bench(std::vector<const Probe *> probes, int trials, uint32_t seed)
+        : probes_(std::move(probes)), trials_(trials), rng_(seed), latency_(probes_.size()),
+          lost_(probes_.size(), 0) {}
+
+    Simulator *simulator = nullptr;
+
+    void inputs(double t, Inputs &in) override;
+    int command(double t) override;
+    void record(double t, const Record &r);
+
+    const std::vector<std::vector<double>> &latency() const { return latency_; }
+    const std::vector<int> &lost() const { return lost_; }
+
+private:
+    enum class State : uint8_t { Start, Idle, Changed, Reverted, Done };
+
+    void startProbe(double t);
+    void apply(Inputs &in, bool changed) const;
+    bool shows(const Record &r, bool changed) const;
+    void schedule(double t);
+
+    std::vector<const Probe *> probes_;
+    int trials_;
+    std::mt19937 rng_;
+    size_t probe_ = 0;
+    int trial_ = 0;
+    State state_ = State::Start;
+    double next_ = 0;            // time of the next change, or settle end
+    double changedAt_ = 0;
+    bool changed_ = false;
+    bool events_ = false;
+    std::string pending_;
+    double sendAt_ = 0;
+    std::vector<std::vector<double>> latency_;
+    std::vector<int> lost_;
+};
+
+void Bench::startProbe(double t)
+{
+    const Probe &p = *probes_[probe_];
+    pending_.clear();
+    if (p.events != events_) pending_ += 'e';    // e toggles
+    pending_ += p.command;
+    events_ = p.events;
+    sendAt_ = t;
+    trial_ = 0;
+    changed_ = false;
+    state_ = State::Idle;
+    next_ = t + kSettle;
+}
+
+void Bench::schedule(double t)
+{
+    std::uniform_real_distribution<double> delay(0.0, probes_[probe_]->window);
+    next_ = t + 0.05 + delay(rng_);
+}
+
+void Bench::apply(Inputs &in, bool changed) const
+{
+    switch (probes_[probe_]->kind) {
+    case Input::Key:
+        if (changed) in.keys |= 1u << kKeyBit;
+        else in.keys &= ~(1u << kKeyBit);
+        break;
+    case Input::Button:
+        in.top = changed;
+        break;
+    case Input::Stick:
+        in.x = changed ? kStickHigh : kStickLow;
+        break;
+    case Input::Trackball:
+        in.x = changed ? kSpin : 0;
+        break;
+    }
+}
+
+bool Bench::shows(const Record &r, bool changed) const
+{
+    const Probe &p = *probes_[probe_];
+    switch (p.kind) {
+    case Input::Key:
+        if (p.events)
+            return r.type == RecordType::Event && r.event.name == kKey && r.event.pressed == changed;
+        if (r.type == RecordType::Report)
+            return ((r.report.keys >> kKeyBit) & 1) == changed;
+        if (r.type == RecordType::Matrix)
+            return ((r.matrix.keys >> kKeyBit) & 1) == changed;
+        return false;
+    case Input::Button:
+        if (p.events)
+            return r.type == RecordType::Event && r.event.name == 'T' && r.event.pressed == changed;
+        if (r.type == RecordType::Report)
+            return r.report.top == changed;
+        return false;
+    case Input::Stick:
+        return r.type == RecordType::Report &&
+               std::abs(r.report.potx - (changed ? kStickHigh : kStickLow)) <= kStickTolerance;
+    case Input::Trackball:
+        return r.type == RecordType::VelocitySample && std::abs(r.sample.x - (changed ? kSpin : 0)) <= kSpin / 4;
+    }
+    return false;
+}
+
+void Bench::inputs(double t, Inputs &in)
+{
+    if (state_ == State::Start) {
+        startProbe(t);
+        in.kind = ControllerKind::Joystick;
+    }
+    const Probe &p = *probes_[probe_];
+    if (p.kind == Input::Trackball) in.kind = ControllerKind::Trackball;
+
+    if (state_ == State::Idle && t >= next_) {
+        changed_ = true;
+        changedAt_ = t;
+        state_ = State::Changed;
+    } else if ((state_ == State::Changed || state_ == State::Reverted) && t - changedAt_ > kTimeout) {
+        if (state_ == State::Changed) ++lost_[probe_];
+        changed_ = false;
+        state_ = State::Idle;
+        schedule(t);
+    }
+    apply(in, changed_);
+}
+
+int Bench::command(double t)
+{
+    if (pending_.empty() || t < sendAt_) return -1;
+    int c = static_cast<uint8_t>(pending_[0]);
+    pending_.erase(0, 1);
+    sendAt_ = t + kByteSeconds;
+    return c;
+}
+
+void Bench::record(double t, const Record &r)
+{
+    if (state_ == State::Changed && shows(r, true)) {
+        latency_[probe_].push_back(t - changedAt_);
+        changed_ = false;
+        changedAt_ = t;
+        state_ = State::Reverted;
+    } else if (state_ == State::Reverted && shows(r, false)) {
+        state_ = State::Idle;
+        if (++trial_ < trials_) {
+            schedule(t);
+        } else if (probe_ + 1 < probes_.size()) {
+            ++probe_;
+            startProbe(t);
+        } else {
+            state_ = State::Done;
+            simulator->stop();
+        }
+    }
+}
+
+double percentile(const std::vector<double> &sorted, double p)
+{
+    if (sorted.empty()) return 0;
+    size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+    return sorted[std::max<size_t>(rank, 1) - 1];
+}
+
+int usage()
+{
+    std::fprintf(stderr, "usage: latencybench [-n trials] [-s seed] [-m text|events|matrix|velocity] [--csv file]\n");
+    return 1;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    int trials = 200;
+    uint32_t seed = 5200;
+    const char *mode = nullptr, *csvPath = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        bool more = i + 1 < argc;
+        if (a == "-n" && more) trials = std::atoi(argv[++i]);
+        else if (a == "-s" && more) seed = std::strtoul(argv[++i], nullptr, 10);
+        else if (a == "-m" && more) mode = argv[++i];
+        else if (a == "--csv" && more) csvPath = argv[++i];
+        else return usage();
+    }
+
+    std::vector<const Probe *> probes;
+    for (const Probe &p : kProbes)
+        if (!mode || std::string(mode) == p.mode) probes.push_back(&p);
+    if (probes.empty() || trials < 1) return usage();
+
+    Bench bench(probes, trials, seed);
+    Decoder decoder;
+    SimConfig config;
+    Simulator simulator(config, bench, [&](double t, uint8_t byte) {
+        char c = static_cast<char>(byte);
+        decoder.feed(&c, 1, [&](const Record &r) { bench.record(t, r); });
+    });
+    bench.simulator = &simulator;
+
+    double limit = 0;
+    for (const Probe *p : probes) limit += kSettle + trials * (2 * kTimeout + p->window + 0.05);
+    simulator.run(limit);
+
+    FILE *csv = nullptr;
+    if (csvPath && !(csv = std::fopen(csvPath, "w"))) {
+        std::perror(csvPath);
+        return 1;
+    }
+    if (csv) std::fprintf(csv, "mode,input,trial,latency_ms\n");
+
+    std::printf("%-9s %-10s %6s %5s %9s %9s %9s %9s\n", "mode", "input", "trials", "lost", "p50 ms", "p99 ms",
+                "max ms", "mean ms");
+    for (size_t i = 0; i < probes.size(); ++i) {
+        std::vector<double> v = bench.latency()[i];
+        if (csv)
+            for (size_t j = 0; j < v.size(); ++j)
+                std::fprintf(csv, "%s,%s,%zu,%.3f\n", probes[i]->mode, probes[i]->input, j, v[j] * 1e3);
+        std::sort(v.begin(), v.end());
+        double mean = 0;
+        for (double x : v) mean += x;
+        if (!v.empty()) mean /= v.size();
+        std::printf("%-9s %-10s %6zu %5d %9.1f %9.1f %9.1f %9.1f\n", probes[i]->mode, probes[i]->input, v.size(),
+                    bench.lost()[i], percentile(v, 0.50) * 1e3, percentile(v, 0.99) * 1e3,
+                    (v.empty() ? 0 : v.back()) * 1e3, mean * 1e3);
+    }
+    if (csv) std::fclose(csv);
+    std::fprintf(stderr, "latencybench: %.1f virtual s\n", simulator.now());
+    return 0;
+}
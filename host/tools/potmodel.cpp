@@ -0,0 +1,182 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   potmodel - expected readings from the POKEY pot input model
+
+   usage: potmodel [model options] joystick ohms      reading for a pot resistance
+          potmodel [model options] trackball volts    reading for a trackball output voltage
+          potmodel [model options] table              resistance and trackball voltage for each reading
+          potmodel [model options] validate file.csv  compare with bench measurements
+          potmodel mean capture.txt                   mean PotX/PotY of the reports in a capture
+
+   model options:
+     --cav volts      CAV (4.2 to 6V on a 5200, default 5)
+     --vih volts      POKEY ViH (1.9 to 2.6V, default 2.29 as the firmware VRCON)
+     --rtb ohms       trackball output resistance (default 100k, a 3V steady output reads ~mid range)
+     --cap farads     timing capacitor (default 47e-9)
+
+   validate reads lines "j,ohms,reading" (joystick) or "t,volts,reading" 
+   (trackball), readings as observed on the emulator, e.g. with potmodel mean.
+   It prints the prediction for each line, the error and the ViH that best 
+   fits the data, which is how much the board's comparator threshold differs
+   from the nominal one.
+*/
+
+#include "decoder.h"
+#include "potmodel.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+using namespace a5200;
+
+namespace {
+
+struct Bench {
+    char kind;
+    double value;
+    double observed;
+};
+
+double cav = 5.0, rtb = 100e3;
+
+int predict(const PotModel &m, const Bench &b)
+{
+    return b.kind == 'j' ? m.joystick(b.value, cav) : m.trackball(b.value, rtb);
+}
+
+double rmsError(const PotModel &m, const std::vector<Bench> &bench)
+{
+    double sum = 0;
+    for (const Bench &b : bench) {
+        double e = predict(m, b) - b.observed;
+        sum += e * e;
+    }
+    return std::sqrt(sum / bench.size());
+}
+
+int validate(PotModel m, const char *path)
+{
+    FILE *f = std::fopen(path, "r");
+    if (!f) {
+        std::perror(path);
+        return 1;
+    }
+    std::vector<Bench> bench;
+    char kind;
+    double value, observed;
+    char line[256];
+    while (std::fgets(line, sizeof line, f)) {
+        if (std::sscanf(line, " %c,%lf,%lf", &kind, &value, &observed) == 3 && (kind == 'j' || kind == 't'))
+            bench.push_back({kind, value, observed});
+    }
+    std::fclose(f);
+    if (bench.empty()) {
+        std::fprintf(stderr, "potmodel: no measurements in %s\n", path);
+        return 1;
+    }
+
+    std::printf("kind      value  observed  predicted  error\n");
+    for (const Bench &b : bench) {
+        int p = predict(m, b);
+        std::printf("%-4s %10.4g  %8.1f  %9d  %+5.1f\n", b.kind == 'j' ? "joy" : "trk", b.value, b.observed, p,
+                    p - b.observed);
+    }
+    std::printf("rms error %.2f lines at ViH %.3fV\n", rmsError(m, bench), m.vih);
+
+    PotModel best = m;
+    double bestError = rmsError(m, bench);
+    for (double v = 1.5; v <= 3.2; v += 0.005) {
+        PotModel t = m;
+        t.vih = v;
+        double e = rmsError(t, bench);
+        if (e < bestError) {
+            bestError = e;
+            best = t;
+        }
+    }
+    std::printf("best fit ViH %.3fV, rms error %.2f lines\n", best.vih, bestError);
+    return 0;
+}
+
+int mean(const char *path)
+{
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        std::perror(path);
+        return 1;
+    }
+    Decoder decoder;
+    double sx = 0, sy = 0;
+    uint64_t n = 0;
+    char buf[1 << 16];
+    ssize_t len;
+    while ((len = ::read(fd, buf, sizeof buf)) > 0) {
+        decoder.feed(buf, len, [&](const Record &r) {
+            if (r.type != RecordType::Report) return;
+            sx += r.report.potx;
+            sy += r.report.poty;
+            ++n;
+        });
+    }
+    ::close(fd);
+    if (!n) {
+        std::fprintf(stderr, "potmodel: no reports in %s\n", path);
+        return 1;
+    }
+    std::printf("%llu reports, PotX %.2f PotY %.2f\n", (unsigned long long)n, sx / n, sy / n);
+    return 0;
+}
+
+int usage()
+{
+    std::fprintf(stderr, "usage: potmodel [--cav V] [--vih V] [--rtb ohms] [--cap F] joystick ohms | trackball volts |"
+                         " table | validate file.csv\n"
+                         "       potmodel mean capture.txt\n");
+    return 1;
+}
+
+} // namespace
+
+
+int main(int argc, char **argv)
+{
+    PotModel m;
+    int i = 1;
+    for (; i + 1 < argc && argv[i][0] == '-'; i += 2) {
+        std::string a = argv[i];
+        double v = std::atof(argv[i + 1]);
+        if (a == "--cav") cav = v;
+        else if (a == "--vih") m.vih = v;
+        else if (a == "--rtb") rtb = v;
+        else if (a == "--cap") m.timingCap = v;
+        else return usage();
+    }
+    if (i >= argc) return usage();
+    std::string cmd = argv[i];
+
+    if (cmd == "joystick" && i + 1 < argc) {
+        double r = std::atof(argv[i + 1]);
+        std::printf("%d\n", m.joystick(r, cav));
+    } else if (cmd == "trackball" && i + 1 < argc) {
+        double v = std::atof(argv[i + 1]);
+        std::printf("%d\n", m.trackball(v, rtb));
+    } else if (cmd == "table") {
+        std::printf("CAV %.2fV ViH %.3fV trackball R %.0f\nreading   joystick ohms   trackball volts\n", cav, m.vih,
+                    rtb);
+        for (int r = 0; r < m.lines - 1; r += 10)
+            std::printf("%7d   %13.0f   %15.3f\n", r, m.joystickResistance(r, cav), m.trackballVolts(r, rtb));
+    } else if (cmd == "validate" && i + 1 < argc) {
+        return validate(m, argv[i + 1]);
+    } else if (cmd == "mean" && i + 1 < argc) {
+        return mean(argv[i + 1]);
+    } else {
+        return usage();
+    }
+    return 0;
+}
@@ -0,0 +1,215 @@
+/*
+   Atari 5200 Joystick Port Emulator - host tools
+
+   tolerance - Monte Carlo yield of a joystick design over console and component variation
+
+   usage: tolerance [options]
+     --rmin ohms      resistance with the stick at one end of its travel (default 20k)
+     --rmax ohms      resistance at the other end (default 450k)
+     --pot-tol frac   pot tolerance, uniform +-frac (default 0.2)
+     --cap-tol frac   timing capacitor tolerance, uniform +-frac (default 0.1)
+     --cav min:max    console CAV, uniform (default 4.2:6)
+     --vih min:max    POKEY ViH, uniform (default 1.9:2.6)
+     --low n          reading the stick must reach at rmin (default 10)
+     --high n         reading the stick must reach at rmax (default 190)
+     -n samples       default 100000000
+     -j threads       default all cores
+
+   A sample passes when the reading at rmin is <= low and the reading at rmax 
+   is >= high but not saturated (227, which a game cannot tell from no 
+   controller), i.e. the stick covers the whole expected range on that console.
+   Where the input crosses ViH before the first sample the model reads 0; the
+   firmware keeps its previous reading there, which is 0 as the stick moves
+   to rmin (see potmodel.h), so those samples pass at the low end.
+   Each thread draws its samples in blocks of structure-of-arrays and runs the
+   batch pot model over them; per thread histograms are merged at the end.
+*/
+
+#include "potmodel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace a5200;
+
+namespace {
+
+struct Design {
+    double rmin = 20e3, rmax = 450e3;
+    double potTol = 0.2, capTol = 0.1;
+    double cavMin = 4.2, cavMax = 6.0;
+    double vihMin = 1.9, vihMax = 2.6;
+    int low = 10, high = 190;
+};
+
+struct Result {
+    uint64_t samples = 0, passed = 0;
+    uint64_t histMin[256] = {}, histMax[256] = {};
+
+    void add(const Result &o)
+    {
+        samples += o.samples;
+        passed += o.passed;
+        for (int i = 0; i < 256; ++i) {
+            histMin[i] += o.histMin[i];
+            histMax[i] += o.histMax[i];
+        }
+    }
+};
+
+// xoshiro128+, one per thread
+struct Rng {
+    uint32_t s[4];
+
+    explicit Rng(uint64_t seed)
+    {
+        for (uint32_t &x : s) {     // splitmix64 seeding
+            seed += 0x9E3779B97F4A7C15ull;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            x = static_cast<uint32_t>(z ^ (z >> 31)) | 1;
+        }
+    }
+
+    // uniform in [0,1)
+    float next()
+    {
+        uint32_t r = s[0] + s[3];
+        uint32_t t = s[1] << 9;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = (s[3] << 11) | (s[3] >> 21);
+        return (r >> 8) * (1.0f / 16777216.0f);
+    }
+};
+
+void run(const Design &d, const PotModel &m, uint64_t samples, uint64_t seed, Result &res)
+{
+    constexpr size_t kBlock = 4096;
+    std::vector<float> cav(kBlock), vih(kBlock), cap(kBlock), rlo(kBlock), rhi(kBlock);
+    std::vector<uint8_t> lo(kBlock), hi(kBlock);
+    Rng rng(seed);
+
+    const float cavSpan = d.cavMax - d.cavMin, vihSpan = d.vihMax - d.vihMin;
+    while (samples) {
+        size_t n = std::min<uint64_t>(kBlock, samples);
+        for (size_t i = 0; i < n; ++i) {
+            cav[i] = d.cavMin + cavSpan * rng.next();
+            vih[i] = d.vihMin + vihSpan * rng.next();
+            cap[i] = 1.0f + d.capTol * (2.0f * rng.next() - 1.0f);
+            float pot = 1.0f + d.potTol * (2.0f * rng.next() - 1.0f);  // the same pot at both ends
+            rlo[i] = d.rmin * pot;
+            rhi[i] = d.rmax * pot;
+        }
+        potReadings(m, cav.data(), rlo.data(), vih.data(), cap.data(), lo.data(), n);
+        potReadings(m, cav.data(), rhi.data(), vih.data(), cap.data(), hi.data(), n);
+
+        uint64_t passed = 0;
+        for (size_t i = 0; i < n; ++i) {
+            passed += (lo[i] <= d.low) & (hi[i] >= d.high) & (hi[i] < m.lines - 1);
+            ++res.histMin[lo[i]];
+            ++res.histMax[hi[i]];
+        }
+        res.passed += passed;
+        res.samples += n;
+        samples -= n;
+    }
+}
+
+int percentile(const uint64_t *hist, uint64_t total, double p)
+{
+    uint64_t target = static_cast<uint64_t>(p * total), acc = 0;
+    for (int i = 0; i < 256; ++i) {
+        acc += hist[i];
+        if (acc > target) return i;
+    }
+    return 255;
+}
+
+void printDistribution(const char *name, const uint64_t *hist, uint64_t total)
+{
+    std::printf("%s reading: min %d  p1 %d  p50 %d  p99 %d  max %d\n", name, percentile(hist, total, 0),
+                percentile(hist, total, 0.01), percentile(hist, total, 0.5), percentile(hist, total, 0.99),
+                percentile(hist, total, 1.0 - 1e-12));
+    // 10 line bins, bar scaled to the largest
+    uint64_t bins[23] = {}, top = 1;
+    for (int i = 0; i < 228; ++i) bins[i / 10] += hist[i];
+    for (uint64_t b : bins) top = std::max(top, b);
+    for (int b = 0; b < 23; ++b) {
+        if (!bins[b]) continue;
+        std::printf("  %3d-%3d %6.2f%% %s\n", b * 10, std::min(b * 10 + 9, 227), 100.0 * bins[b] / total,
+                    std::string(static_cast<size_t>(40.0 * bins[b] / top), '#').c_str());
+    }
+}
+
+bool range(const char *s, double &lo, double &hi) { return std::sscanf(s, "%lf:%lf", &lo, &hi) == 2 && lo <= hi; }
+
+int usage()
+{
+    std::fprintf(stderr, "usage: tolerance [--rmin ohms] [--rmax ohms] [--pot-tol frac] [--cap-tol frac]\n"
+                         "                 [--cav min:max] [--vih min:max] [--low n] [--high n] [-n samples] [-j threads]\n");
+    return 1;
+}
+
+} // namespace
+
+
+int main(int argc, char **argv)
+{
+    Design d;
+    uint64_t samples = 100000000;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (i + 1 >= argc) return usage();
+        const char *v = argv[++i];
+        if (a == "--rmin") d.rmin = std::atof(v);
+        else if (a == "--rmax") d.rmax = std::atof(v);
+        else if (a == "--pot-tol") d.potTol = std::atof(v);
+        else if (a == "--cap-tol") d.capTol = std::atof(v);
+        else if (a == "--cav") { if (!range(v, d.cavMin, d.cavMax)) return usage(); }
+        else if (a == "--vih") { if (!range(v, d.vihMin, d.vihMax)) return usage(); }
+        else if (a == "--low") d.low = std::atoi(v);
+        else if (a == "--high") d.high = std::atoi(v);
+        else if (a == "-n") samples = std::strtoull(v, nullptr, 10);
+        else if (a == "-j") threads = std::max(1, std::atoi(v));
+        else return usage();
+    }
+
+    PotModel m;
+    std::vector<Result> results(threads);
+    std::vector<std::thread> pool;
+    auto t0 = std::chrono::steady_clock::now();
+    for (unsigned t = 0; t < threads; ++t) {
+        uint64_t share = samples / threads + (t < samples % threads ? 1 : 0);
+        pool.emplace_back(run, std::cref(d), std::cref(m), share, 5200 + t, std::ref(results[t]));
+    }
+    Result total;
+    for (unsigned t = 0; t < threads; ++t) {
+        pool[t].join();
+        total.add(results[t]);
+    }
+    double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    if (!total.samples) return usage();
+
+    std::printf("design: %.0f..%.0f ohms, pot +-%.0f%%, cap +-%.0f%%, CAV %.2f..%.2fV, ViH %.2f..%.2fV\n", d.rmin,
+                d.rmax, 100 * d.potTol, 100 * d.capTol, d.cavMin, d.cavMax, d.vihMin, d.vihMax);
+    std::printf("yield: %.3f%% reach <=%d and >=%d without saturating\n", 100.0 * total.passed / total.samples,
+                d.low, d.high);
+    printDistribution("rmin", total.histMin, total.samples);
+    printDistribution("rmax", total.histMax, total.samples);
+    std::printf("%llu samples in %.2fs, %.1f M samples/s on %u threads\n", (unsigned long long)total.samples, s,
+                total.samples / s / 1e6, threads);
+    return 0;
+}